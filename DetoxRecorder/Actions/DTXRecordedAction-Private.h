@@ -8,6 +8,14 @@
 
 #import "DTXRecordedAction.h"
 
+//Must match the generator in the CLI's RecordingEventLog.swift
+typedef NS_ENUM(uint32_t, DTXRecordedActionVariant) {
+	DTXRecordedActionVariantDefault = 0,
+	DTXRecordedActionVariantTapReturnKey = 1,
+	DTXRecordedActionVariantScrollToVisible = 2,
+	DTXRecordedActionVariantCodeComment = 3,
+};
+
 @interface DTXRecordedAction ()
 
 @property (nonatomic, strong, readwrite) DTXRecordedElement* element;
@@ -21,4 +29,13 @@
 
 - (instancetype)initWithElementView:(UIView*)view allowHierarchyTraversal:(BOOL)allowHierarchyTraversal;
 
+//detoxDescription is memoized; subclasses override this instead, and invalidate when state other than the element or arguments changes.
+- (NSString*)generateDetoxDescription;
+- (void)invalidateDetoxDescription;
+
+//Structure beyond the element and arguments that the description depends on, so it can be regenerated from the event log.
+- (DTXRecordedActionVariant)eventLogVariant;
+- (DTXRecordedElement*)eventLogSecondaryElement;
+- (NSArray*)eventLogSecondaryArgs;
+
 @end
@@ -25,7 +25,7 @@ extern DTXRecordedActionType const DTXRecordedActionTypeSliderAdjust;
 extern DTXRecordedActionType const DTXRecordedActionTypeTakeScreenshot;
 extern DTXRecordedActionType const DTXRecordedActionTypeDeviceShake;
 
-@interface DTXRecordedAction : NSObject
+@interface DTXRecordedAction : NSObject <NSCopying>
 
 @property (nonatomic, strong, readonly) DTXRecordedElement* element;
 
@@ -48,6 +48,8 @@ extern DTXRecordedActionType const DTXRecordedActionTypeDeviceShake;
 
 - (BOOL)updateScrollActionWithScrollView:(UIScrollView*)scrollView fromDeltaOriginOffset:(CGPoint)deltaOriginOffset toNewOffset:(CGPoint)newOffset;
 - (BOOL)enhanceScrollActionWithTargetElement:(DTXRecordedElement*)targetElement;
+/// Splits off the horizontal part of a diagonal scroll as an action of its own, so that each action is a single command.
+- (nullable DTXRecordedAction*)splitSecondaryScrollAction;
 
 + (instancetype)shakeDeviceAction;
 
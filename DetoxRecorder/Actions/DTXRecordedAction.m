@@ -18,7 +18,8 @@
 #import "_DTXAdjustSliderAction.h"
 #import "_DTXShakeDeviceAction.h"
 #import "_DTXCodeCommentAction.h"
-#import "NSString+QuotedStringForJS.h"
+#import "DTXRecorderInstrumentation.h"
+#import "NSMutableString+JSAppending.h"
 
 DTXRecordedActionType const DTXRecordedActionTypeTap = @"tap";
 DTXRecordedActionType const DTXRecordedActionTypeLongPress = @"longPress";
@@ -33,6 +34,9 @@ DTXRecordedActionType const DTXRecordedActionTypeTakeScreenshot = @"takeScreensh
 DTXRecordedActionType const DTXRecordedActionTypeDeviceShake = @"shake";
 
 @implementation DTXRecordedAction
+{
+	NSString* _detoxDescription;
+}
 
 + (instancetype)tapActionWithView:(UIView*)view event:(nullable UIEvent*)event tapGestureRecognizer:(nullable UITapGestureRecognizer*)tgr isFromRN:(BOOL)isFromRN
 {
@@ -132,6 +136,31 @@ DTXRecordedActionType const DTXRecordedActionTypeDeviceShake = @"shake";
 	return self;
 }
 
+- (id)copyWithZone:(NSZone *)zone
+{
+	DTXRecordedAction* rv = [[self.class allocWithZone:zone] init];
+	rv.element = self.element;
+	rv.actionType = self.actionType;
+	rv.actionArgs = self.actionArgs;
+	rv.allowsUpdates = self.allowsUpdates;
+	rv.cancelled = self.cancelled;
+	rv->_detoxDescription = _detoxDescription;
+	
+	return rv;
+}
+
+- (void)setElement:(DTXRecordedElement *)element
+{
+	_element = element;
+	[self invalidateDetoxDescription];
+}
+
+- (void)setActionArgs:(NSArray *)actionArgs
+{
+	_actionArgs = actionArgs;
+	[self invalidateDetoxDescription];
+}
+
 - (BOOL)updateScrollActionWithScrollView:(UIScrollView*)scrollView fromDeltaOriginOffset:(CGPoint)deltaOriginOffset toNewOffset:(CGPoint)newOffset
 {
 	[self doesNotRecognizeSelector:_cmd];
@@ -146,35 +175,117 @@ DTXRecordedActionType const DTXRecordedActionTypeDeviceShake = @"shake";
 	return NO;
 }
 
-static NSDictionary* _DTXDeepDiveOnDictionary(NSDictionary* d)
+- (DTXRecordedAction*)splitSecondaryScrollAction
 {
-	NSMutableDictionary* rv = [NSMutableDictionary new];
+	return nil;
+}
+
+static NSString* _DTXJSNumberDescription(NSNumber* number)
+{
+	double value = DTXDoubleWithMaxFractionLength(number.doubleValue, 3);
+	if(value == 0)
+	{
+		//Also covers negative zero
+		return @"0";
+	}
 	
-	[d enumerateKeysAndObjectsUsingBlock:^(id  _Nonnull key, id  _Nonnull obj, BOOL * _Nonnull stop) {
-		if([obj isKindOfClass:NSNumber.class])
-		{
-			//Turn to decimal number to preserve accuracy when printing using NSJSONSerialization 🤦‍♂️
-			rv[key] = [NSDecimalNumber decimalNumberWithString:[NSString stringWithFormat:@"%lf", DTXDoubleWithMaxFractionLength([obj doubleValue], 3)]];
-			
-			return;
-		}
-		
-		if([obj isKindOfClass:NSDictionary.class])
-		{
-			rv[key] = _DTXDeepDiveOnDictionary(obj);
-			
-			return;
-		}
+	char buffer[64];
+	int length = snprintf(buffer, sizeof(buffer), "%.3f", value);
+	if(length <= 0 || (size_t)length >= sizeof(buffer))
+	{
+		return number.description;
+	}
+	
+	//Trailing fraction zeros, and a dangling decimal point, are dropped.
+	while(buffer[length - 1] == '0')
+	{
+		length--;
+	}
+	if(buffer[length - 1] == '.')
+	{
+		length--;
+	}
+	
+	return [[NSString alloc] initWithBytes:buffer length:length encoding:NSASCIIStringEncoding];
+}
+
+static void _DTXAppendJSValueDescription(NSMutableString* rv, id obj)
+{
+	if([obj isKindOfClass:NSNumber.class])
+	{
+		[rv appendString:_DTXJSNumberDescription(obj)];
+	}
+	else if([obj isKindOfClass:NSString.class])
+	{
+		[rv dtx_appendQuotedStringForJS:obj];
+	}
+	else if([obj isKindOfClass:NSDictionary.class])
+	{
+		[rv appendString:@"{"];
+		//Sorted to keep the output stable between runs
+		NSArray* keys = [[obj allKeys] sortedArrayUsingSelector:@selector(compare:)];
+		[keys enumerateObjectsUsingBlock:^(id  _Nonnull key, NSUInteger idx, BOOL * _Nonnull stop) {
+			if(idx > 0)
+			{
+				[rv appendString:@","];
+			}
+			[rv dtx_appendQuotedStringForJS:[key description]];
+			[rv appendString:@":"];
+			_DTXAppendJSValueDescription(rv, obj[key]);
+		}];
+		[rv appendString:@"}"];
+	}
+	else if([obj isKindOfClass:NSArray.class])
+	{
+		[rv appendString:@"["];
+		[obj enumerateObjectsUsingBlock:^(id  _Nonnull value, NSUInteger idx, BOOL * _Nonnull stop) {
+			if(idx > 0)
+			{
+				[rv appendString:@","];
+			}
+			_DTXAppendJSValueDescription(rv, value);
+		}];
+		[rv appendString:@"]"];
+	}
+	else
+	{
+		[rv appendString:[obj description]];
+	}
+}
+
+- (void)invalidateDetoxDescription
+{
+	_detoxDescription = nil;
+}
+
+- (NSString*)detoxDescription
+{
+	if(_detoxDescription == nil)
+	{
+		DTX_SIGNPOST_INTERVAL("Detox Description");
 		
-		rv[key] = obj;
-	}];
+		_detoxDescription = [self generateDetoxDescription];
+	}
 	
+	return _detoxDescription;
+}
+
+//Text arguments dominate; the rest is a rough allowance for punctuation and numbers.
+static NSUInteger _DTXEstimatedJSArgumentsLength(NSArray* args)
+{
+	NSUInteger rv = 0;
+	for(id obj in args)
+	{
+		rv += [obj isKindOfClass:NSString.class] ? [obj length] + 4 : 16;
+	}
 	return rv;
 }
 
-- (NSString*)detoxDescription;
+- (NSString*)generateDetoxDescription
 {
-	NSMutableString* rv = @"await ".mutableCopy;
+	//Written into a single buffer, sized up front, rather than grown by every append.
+	NSMutableString* rv = [NSMutableString stringWithCapacity:16 + self.element.detoxDescription.length + self.actionType.length + _DTXEstimatedJSArgumentsLength(self.actionArgs)];
+	[rv appendString:@"await "];
 	if(self.element != nil)
 	{
 		[rv appendString:self.element.detoxDescription];
@@ -184,36 +295,38 @@ static NSDictionary* _DTXDeepDiveOnDictionary(NSDictionary* d)
 		[rv appendString:@"device"];
 	}
 	
-	[rv appendFormat:@".%@(", self.actionType];
+	[rv appendString:@"."];
+	[rv appendString:self.actionType];
+	[rv appendString:@"("];
 	
-	NSArray* arguments = [self.actionArgs dtx_mapObjectsUsingBlock:^id _Nonnull(id _Nonnull obj, NSUInteger idx) {
-		if([obj isKindOfClass:NSNumber.class])
+	[self.actionArgs enumerateObjectsUsingBlock:^(id  _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
+		if(idx > 0)
 		{
-			return [NSDecimalNumber decimalNumberWithString:[NSString stringWithFormat:@"%lf", DTXDoubleWithMaxFractionLength([obj doubleValue], 3)]];
+			[rv appendString:@", "];
 		}
-		if([obj isKindOfClass:NSString.class])
-		{
-			return [obj dtx_quotedStringRepresentationForJS];
-		}
-		else if([obj isKindOfClass:NSDictionary.class])
-		{
-			NSDictionary* fixed = _DTXDeepDiveOnDictionary(obj);
-			
-			return [[NSString alloc] initWithData:[NSJSONSerialization dataWithJSONObject:fixed options:0 error:NULL] encoding:NSUTF8StringEncoding];
-		}
-		
-		return [obj description];
+		_DTXAppendJSValueDescription(rv, obj);
 	}];
-	if(arguments.count > 0)
-	{
-		[rv appendString:[arguments componentsJoinedByString:@", "]];
-	}
 	
 	[rv appendString:@");"];
 	
 	return rv;
 }
 
+- (DTXRecordedActionVariant)eventLogVariant
+{
+	return DTXRecordedActionVariantDefault;
+}
+
+- (DTXRecordedElement*)eventLogSecondaryElement
+{
+	return nil;
+}
+
+- (NSArray*)eventLogSecondaryArgs
+{
+	return nil;
+}
+
 - (NSString *)description
 {
 	return self.detoxDescription;
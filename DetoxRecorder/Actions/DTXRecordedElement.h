@@ -43,6 +43,10 @@ extern DTXRecordedElementMatcherType const DTXRecordedElementMatcherTypeByText;
 
 - (NSString*)detoxDescription;
 
+/// Every matcher considered while resolving the element, including those that were not chosen, the index each would require (NSNotFound if unique),
+/// and the number of views it matched at the time. A by.type candidate's count is of views also matching the element's text or label.
+- (void)enumerateMatcherCandidatesUsingBlock:(void (NS_NOESCAPE ^)(DTXRecordedElementMatcherType matcherType, NSString* value, NSInteger atIndex, NSUInteger matchCount))block;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -8,7 +8,11 @@
 
 #import "DTXRecordedElement.h"
 #import "UIView+RecorderUtils.h"
-#import "NSString+QuotedStringForJS.h"
+#import "DTXViewHierarchySnapshot.h"
+#import "UIView+HierarchyMutationTracking.h"
+#import "NSMutableString+JSAppending.h"
+#import "DTXRecorderInstrumentation.h"
+#import "DTXReactNativeViewRegistry.h"
 
 DTXRecordedElementMatcherType const DTXRecordedElementMatcherTypeById = @"by.id";
 DTXRecordedElementMatcherType const DTXRecordedElementMatcherTypeByType = @"by.type";
@@ -23,21 +27,46 @@ DTXRecordedElementMatcherType const DTXRecordedElementMatcherTypeByText = @"by.t
 @end
 
 @implementation DTXRecordedElementMatcher
+{
+	NSString* _detoxDescription;
+}
 
 - (NSString*)detoxDescription;
 {
-	NSMutableString* rv = [NSMutableString new];
-	[rv appendFormat:@"%@(", self.matcherType];
+	//Matchers do not change once their element has been created
+	if(_detoxDescription != nil)
+	{
+		return _detoxDescription;
+	}
 	
-	[rv appendString:[[self.matcherArgs dtx_mapObjectsUsingBlock:^id _Nonnull(id  _Nonnull obj, NSUInteger idx) {
-		if([obj isKindOfClass:NSString.class])
+	NSUInteger capacity = self.matcherType.length + 2;
+	for(id obj in self.matcherArgs)
+	{
+		capacity += [obj description].length + 4;
+	}
+	
+	NSMutableString* rv = [NSMutableString stringWithCapacity:capacity];
+	[rv appendString:self.matcherType];
+	[rv appendString:@"("];
+	
+	[self.matcherArgs enumerateObjectsUsingBlock:^(id  _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
+		if(idx > 0)
 		{
-			return [obj dtx_quotedStringRepresentationForJS];
+			[rv appendString:@", "];
 		}
 		
-		return [obj description];
-	}] componentsJoinedByString:@", "]];
+		if([obj isKindOfClass:NSString.class])
+		{
+			[rv dtx_appendQuotedStringForJS:obj];
+		}
+		else
+		{
+			[rv appendString:[obj description]];
+		}
+	}];
 	[rv appendString:@")"];
+	
+	_detoxDescription = rv;
 	return rv;
 }
 
@@ -85,8 +114,7 @@ static void _DTXDeepMacherDescription(NSArray<DTXRecordedElementMatcher*>* match
 @property (nonatomic, readwrite) DTXRecordedElement* ancestorElement;
 
 @property (nonatomic, strong) Class viewClass;
-@property (nonatomic, strong) NSString* chainDescription;
-@property (nonatomic, strong) NSArray<NSString*>* superviewChain;
+@property (nonatomic) uintptr_t viewIdentifier;
 
 @end
 
@@ -117,22 +145,35 @@ static NSString* _DTXBestEffortAccessibilityIdentifierForView(UIView* view, UIAc
 	return currView.accessibilityIdentifier;
 }
 
-#define IDX_IF_NEEDED if(found.count > 1) { *idx = [found indexOfObject:view]; } else { *idx = NSNotFound; }
+#define IDX_IF_NEEDED *count = found.count; if(found.count > 1) { *idx = [UIView dtxrec_coordinateIndexOfView:view inViews:found]; } else { *idx = NSNotFound; }
 
 //static NSPredicate* _DTXAncestorPredicateForElement(DTXRecordedElement* element)
 //{
 //
 //}
 
-static NSString* DTXBestEffortAccessibilityIdentifierForView(UIView* view, UIAccessibilityTraits allowedLookupTraits, NSInteger* idx, DTXRecordedElement* ancestorElement)
+static NSString* DTXBestEffortAccessibilityIdentifierForView(UIView* view, UIAccessibilityTraits allowedLookupTraits, NSInteger* idx, NSUInteger* count, DTXRecordedElement* ancestorElement, DTXViewHierarchySnapshot* snapshot)
 {
+	//For React Native views, the registry replaces both the superview walk and the hierarchy search.
+	UIView* testIDView = [DTXReactNativeViewRegistry.currentRegistry testIDViewForView:view allowedLookupTraits:allowedLookupTraits];
+	if(testIDView != nil)
+	{
+		NSString* testID = testIDView.accessibilityIdentifier;
+		if(testID.length > 0)
+		{
+			NSArray* found = [DTXReactNativeViewRegistry.currentRegistry viewsWithTestID:testID];
+			*count = found.count;
+			*idx = found.count > 1 ? [UIView dtxrec_coordinateIndexOfView:testIDView inViews:found] : NSNotFound;
+		}
+		
+		return testID;
+	}
+	
 	NSString* identifier = _DTXBestEffortAccessibilityIdentifierForView(view, allowedLookupTraits);
 	
 	if(identifier.length > 0)
 	{
-		NSPredicate* predicate = [NSPredicate predicateWithFormat:@"accessibilityIdentifier == %@", identifier];
-		
-		NSArray* found = [UIView dtxrec_findViewsInAllWindowsPassingPredicate:predicate];
+		NSArray* found = [snapshot viewsWithAccessibilityIdentifier:identifier];
 		IDX_IF_NEEDED;
 	}
 	
@@ -150,72 +191,166 @@ static NSMutableString* _DTXBestEffortAccessibilityLabelForView(UIView* view)
 	return [view accessibilityLabel].mutableCopy;
 }
 
-static NSMutableString* DTXBestEffortTextForView(UIView* view, NSInteger* idx, DTXRecordedElement* ancestorElement)
+static NSMutableString* DTXBestEffortTextForView(UIView* view, NSInteger* idx, NSUInteger* count, DTXRecordedElement* ancestorElement, DTXViewHierarchySnapshot* snapshot)
 {
-	NSMutableString* text = [view valueForKey:@"text"];
+	NSMutableString* text = [view text];
 	
 	if(text.length > 0)
 	{
-		NSArray* found = [UIView dtxrec_findViewsInAllWindowsPassingPredicate:[NSPredicate predicateWithFormat:@"text == %@", text]];
+		NSArray* found = [snapshot viewsWithText:text];
 		IDX_IF_NEEDED;
 	}
 	
 	return text;
 }
 
-static NSMutableString* DTXBestEffortAccessibilityLabelForView(UIView* view, NSInteger* idx, DTXRecordedElement* ancestorElement)
+static NSMutableString* DTXBestEffortAccessibilityLabelForView(UIView* view, NSInteger* idx, NSUInteger* count, DTXRecordedElement* ancestorElement, DTXViewHierarchySnapshot* snapshot)
 {
 	NSMutableString* label = _DTXBestEffortAccessibilityLabelForView(view);
 	
 	if(label.length > 0)
 	{
-		NSArray* found = [UIView dtxrec_findViewsInAllWindowsPassingPredicate:[NSPredicate predicateWithFormat:@"accessibilityLabel == %@", label]];
+		NSArray* found = [snapshot viewsWithAccessibilityLabel:label];
 		IDX_IF_NEEDED;
 	}
 	
 	return label;
 }
 
-static NSMutableString* DTXBestEffortByClassForView(UIView* view, NSString* text, NSString* label, NSInteger* idx, DTXRecordedElement* ancestorElement)
+static NSMutableString* DTXBestEffortByClassForView(UIView* view, NSString* text, NSString* label, NSInteger* idx, NSUInteger* count, DTXRecordedElement* ancestorElement, DTXViewHierarchySnapshot* snapshot)
 {
 	NSMutableString* rv = NSStringFromClass(view.class).mutableCopy;
 	
-	NSPredicate* predicate = [NSPredicate predicateWithFormat:@"self isKindOfClass: %@", view.class];
-	if(text.length > 0)
+	NSArray* found = [snapshot viewsOfKindOfClass:view.class text:text accessibilityLabel:label];
+	IDX_IF_NEEDED;
+	
+	return rv;
+}
+
+DTX_ALWAYS_INLINE
+static BOOL _DTXCandidateValuesEqual(NSString* cached, NSString* current)
+{
+	if(cached.length == 0 || current.length == 0)
 	{
-		predicate = [NSCompoundPredicate andPredicateWithSubpredicates:@[predicate, [NSPredicate predicateWithFormat:@"text == %@", text]]];
+		return cached.length == current.length;
 	}
-	else if(label.length > 0)
+	
+	return [cached isEqualToString:current];
+}
+
+DTX_ALWAYS_INLINE
+static uintptr_t DTXGetViewIdentifier(UIView* view)
+{
+	return (uintptr_t)(__bridge void*)view;
+}
+
+DTX_ALWAYS_INLINE
+static NSUInteger DTXViewIdentifierHash(uintptr_t identifier)
+{
+	//Views are at least 16-byte aligned
+	return (NSUInteger)((identifier >> 4) * 0x9E3779B97F4A7C15ull);
+}
+
+@implementation DTXRecordedElement
+{
+	//Open-addressing set of the identifiers of the view and all its superviews
+	uintptr_t* _superviewChain;
+	NSUInteger _superviewChainMask;
+	NSString* _detoxDescription;
+	
+	//By id, text, label and type, in that order
+	NSString* _candidateValues[4];
+	NSInteger _candidateIndices[4];
+	NSUInteger _candidateMatchCounts[4];
+}
+
+- (void)dealloc
+{
+	free(_superviewChain);
+}
+
+- (void)_setSuperviewChainForView:(UIView*)view
+{
+	NSUInteger depth = 0;
+	for(UIView* currView = view; currView != nil; currView = currView.superview)
 	{
-		predicate = [NSCompoundPredicate andPredicateWithSubpredicates:@[predicate, [NSPredicate predicateWithFormat:@"accessibilityLabel == %@", label]]];
+		depth++;
 	}
 	
-	NSArray* found = [UIView dtxrec_findViewsInAllWindowsPassingPredicate:predicate];
-	IDX_IF_NEEDED;
+	NSUInteger capacity = 8;
+	while(capacity < depth * 2)
+	{
+		capacity <<= 1;
+	}
 	
-	return rv;
+	_superviewChain = calloc(capacity, sizeof(uintptr_t));
+	_superviewChainMask = capacity - 1;
+	
+	for(UIView* currView = view; currView != nil; currView = currView.superview)
+	{
+		uintptr_t identifier = DTXGetViewIdentifier(currView);
+		NSUInteger idx = DTXViewIdentifierHash(identifier) & _superviewChainMask;
+		while(_superviewChain[idx] != 0 && _superviewChain[idx] != identifier)
+		{
+			idx = (idx + 1) & _superviewChainMask;
+		}
+		_superviewChain[idx] = identifier;
+	}
 }
 
-static inline NSMutableString* DTXGetViewChainDescription(UIView* view)
+- (BOOL)_superviewChainContainsIdentifier:(uintptr_t)identifier
 {
-	return [NSMutableString stringWithFormat:@"%p", view];
+	if(_superviewChain == NULL || identifier == 0)
+	{
+		return NO;
+	}
+	
+	NSUInteger idx = DTXViewIdentifierHash(identifier) & _superviewChainMask;
+	while(_superviewChain[idx] != 0)
+	{
+		if(_superviewChain[idx] == identifier)
+		{
+			return YES;
+		}
+		idx = (idx + 1) & _superviewChainMask;
+	}
+	
+	return NO;
 }
 
-static NSMutableArray<NSMutableString*>* DTXGetSuperviewChain(UIView* view)
+//Resolved elements are reused until the hierarchy mutates
+static NSMapTable<UIView*, DTXRecordedElement*>* _elementCache[2];
+static NSUInteger _elementCacheGeneration;
+
++ (instancetype)elementWithView:(UIView*)view allowHierarchyTraversal:(BOOL)allowTraversal
 {
-	NSMutableArray* rv = [NSMutableArray new];
-	UIView* currView = view;
-	while(currView != nil)
+	NSUInteger generation = UIView.dtxrec_hierarchyGeneration;
+	if(_elementCache[0] == nil || _elementCacheGeneration != generation)
 	{
-		[rv addObject:DTXGetViewChainDescription(currView)];
-		currView = currView.superview;
+		_elementCache[0] = [NSMapTable weakToStrongObjectsMapTable];
+		_elementCache[1] = [NSMapTable weakToStrongObjectsMapTable];
+		_elementCacheGeneration = generation;
+	}
+	
+	NSMapTable<UIView*, DTXRecordedElement*>* cache = _elementCache[allowTraversal ? 1 : 0];
+	DTXRecordedElement* rv = [cache objectForKey:view];
+	if(rv != nil && [rv _candidatesStillMatchView:view allowHierarchyTraversal:allowTraversal])
+	{
+		return rv;
 	}
+	
+	DTX_SIGNPOST_INTERVAL("Element Resolution");
+	
+	rv = [self _elementWithView:view allowHierarchyTraversal:allowTraversal snapshot:[DTXViewHierarchySnapshot snapshotForResolvingView:view]];
+	if(rv != nil)
+	{
+		[cache setObject:rv forKey:view];
+	}
+	
 	return rv;
 }
 
-@implementation DTXRecordedElement
-
-+ (instancetype)elementWithView:(UIView*)view allowHierarchyTraversal:(BOOL)allowTraversal
++ (instancetype)_elementWithView:(UIView*)view allowHierarchyTraversal:(BOOL)allowTraversal snapshot:(DTXViewHierarchySnapshot*)snapshot
 {
 	DTXRecordedElement* rv = [DTXRecordedElement new];
 	
@@ -230,29 +365,33 @@ static NSMutableArray<NSMutableString*>* DTXGetSuperviewChain(UIView* view)
 			segmentControl = (id)segmentControl.superview;
 		}
 		
-		ancestorElement = [self elementWithView:segmentControl allowHierarchyTraversal:NO];
+		ancestorElement = [self _elementWithView:segmentControl allowHierarchyTraversal:NO snapshot:snapshot];
 	}
 	else if([view.superview isKindOfClass:UITableViewCell.class])
 	{
-		ancestorElement = [self elementWithView:view.superview allowHierarchyTraversal:NO];
+		ancestorElement = [self _elementWithView:view.superview allowHierarchyTraversal:NO snapshot:snapshot];
 	}
 	
 	NSInteger byIdIdx = NSNotFound;
-	NSString* byId = DTXBestEffortAccessibilityIdentifierForView(view, allowedLookupTraits, &byIdIdx, ancestorElement);
+	NSUInteger byIdCount = 0;
+	NSString* byId = DTXBestEffortAccessibilityIdentifierForView(view, allowedLookupTraits, &byIdIdx, &byIdCount, ancestorElement, snapshot);
 	
 	NSInteger byTextIdx = NSNotFound;
-	NSString* byText = DTXBestEffortTextForView(view, &byTextIdx, ancestorElement);
+	NSUInteger byTextCount = 0;
+	NSString* byText = DTXBestEffortTextForView(view, &byTextIdx, &byTextCount, ancestorElement, snapshot);
 	
 	NSInteger byLabelIdx = NSNotFound;
-	NSString* byLabel = DTXBestEffortAccessibilityLabelForView(view, &byLabelIdx, ancestorElement);
+	NSUInteger byLabelCount = 0;
+	NSString* byLabel = DTXBestEffortAccessibilityLabelForView(view, &byLabelIdx, &byLabelCount, ancestorElement, snapshot);
 	
 	NSInteger byTypeIdx = NSNotFound;
+	NSUInteger byTypeCount = 0;
 	NSString* byType = nil;
 	BOOL enforceByType = [view isKindOfClass:NSClassFromString(@"_UIButtonBarButton")];
 	
 	if(byId.length == 0 && (byLabel.length == 0 || byText.length == 0 || enforceByType == YES))
 	{
-		byType = DTXBestEffortByClassForView(view, byText, byLabel, &byTypeIdx, ancestorElement);
+		byType = DTXBestEffortByClassForView(view, byText, byLabel, &byTypeIdx, &byTypeCount, ancestorElement, snapshot);
 	}
 	
 	if(byId.length == 0 && byLabel.length == 0 && byType.length == 0 && byText.length == 0)
@@ -336,50 +475,107 @@ static NSMutableArray<NSMutableString*>* DTXGetSuperviewChain(UIView* view)
 		rv.matchers = matchers;
 	}
 	
+	rv->_candidateValues[0] = byId;
+	rv->_candidateIndices[0] = byIdIdx;
+	rv->_candidateMatchCounts[0] = byIdCount;
+	rv->_candidateValues[1] = byText;
+	rv->_candidateIndices[1] = byTextIdx;
+	rv->_candidateMatchCounts[1] = byTextCount;
+	rv->_candidateValues[2] = byLabel;
+	rv->_candidateIndices[2] = byLabelIdx;
+	rv->_candidateMatchCounts[2] = byLabelCount;
+	rv->_candidateValues[3] = byType;
+	rv->_candidateIndices[3] = byTypeIdx;
+	rv->_candidateMatchCounts[3] = byTypeCount;
+	
 	rv.viewClass = view.class;
-	rv.chainDescription = DTXGetViewChainDescription(view);
-	rv.superviewChain = DTXGetSuperviewChain(view);
+	rv.viewIdentifier = DTXGetViewIdentifier(view);
+	[rv _setSuperviewChainForView:view];
 	rv.ancestorElement = ancestorElement;
 	
+	//Elements are immutable from here on, and may be shared with the recorder queue, so the description is computed eagerly.
+	rv->_detoxDescription = [rv _generateDetoxDescription];
+	
 	return rv;
 }
 
+//Not every change to what the matchers are built from bumps the hierarchy generation, so cached elements are checked cheaply before being reused.
+- (BOOL)_candidatesStillMatchView:(UIView*)view allowHierarchyTraversal:(BOOL)allowTraversal
+{
+	if(view.class != self.viewClass)
+	{
+		return NO;
+	}
+	
+	UIAccessibilityTraits allowedLookupTraits = allowTraversal ? UIAccessibilityTraitButton : 0;
+	UIView* testIDView = [DTXReactNativeViewRegistry.currentRegistry testIDViewForView:view allowedLookupTraits:allowedLookupTraits];
+	NSString* byId = testIDView != nil ? testIDView.accessibilityIdentifier : _DTXBestEffortAccessibilityIdentifierForView(view, allowedLookupTraits);
+	
+	return _DTXCandidateValuesEqual(_candidateValues[0], byId) && _DTXCandidateValuesEqual(_candidateValues[1], [view text]) && _DTXCandidateValuesEqual(_candidateValues[2], _DTXBestEffortAccessibilityLabelForView(view));
+}
+
 - (BOOL)isReferencingView:(UIView*)view;
 {
-	return [DTXGetViewChainDescription(view) isEqualToString:self.chainDescription];
+	return DTXGetViewIdentifier(view) == self.viewIdentifier;
 }
 
 - (BOOL)elementSuperviewChainContainsView:(UIView*)view
 {
-	return [self.superviewChain containsObject:DTXGetViewChainDescription(view)];
+	return [self _superviewChainContainsIdentifier:DTXGetViewIdentifier(view)];
 }
 
 - (BOOL)elementSuperviewChainContainsElement:(DTXRecordedElement*)element;
 {
-	return [self.superviewChain containsObject:element.chainDescription];
+	return [self _superviewChainContainsIdentifier:element.viewIdentifier];
 }
 
 - (BOOL)isEqualToElement:(DTXRecordedElement*)otherElement;
 {
-	return [self.chainDescription isEqualToString:otherElement.chainDescription];
+	return self.viewIdentifier == otherElement.viewIdentifier;
 }
 
 - (NSString *)detoxDescription
 {
-	NSMutableString* rv = @"element(".mutableCopy;
+	return _detoxDescription;
+}
+
+- (void)enumerateMatcherCandidatesUsingBlock:(void (NS_NOESCAPE ^)(DTXRecordedElementMatcherType matcherType, NSString* value, NSInteger atIndex, NSUInteger matchCount))block
+{
+	DTXRecordedElementMatcherType types[] = {DTXRecordedElementMatcherTypeById, DTXRecordedElementMatcherTypeByText, DTXRecordedElementMatcherTypeByLabel, DTXRecordedElementMatcherTypeByType};
 	
-	[rv appendString:[DTXRecordedElementMatcher detoxDescriptionForMatchers:self.matchers]];
+	for(NSUInteger idx = 0; idx < 4; idx++)
+	{
+		if(_candidateValues[idx].length > 0)
+		{
+			block(types[idx], _candidateValues[idx], _candidateIndices[idx], _candidateMatchCounts[idx]);
+		}
+	}
+}
+
+- (NSString*)_generateDetoxDescription
+{
+	NSUInteger capacity = 32 + self.ancestorElement.detoxDescription.length;
+	for(DTXRecordedElementMatcher* matcher in self.matchers)
+	{
+		capacity += matcher.detoxDescription.length + 6;
+	}
 	
+	//Matchers and the ancestor are appended in place, into a buffer sized up front.
+	NSMutableString* rv = [NSMutableString stringWithCapacity:capacity];
+	[rv appendString:@"element("];
+	_DTXDeepMacherDescription(self.matchers, 0, rv);
 	[rv appendString:@")"];
 	
 	if(self.ancestorElement)
 	{
-		[rv appendFormat:@".withAncestor(%@)", self.ancestorElement.detoxDescription];
+		[rv appendString:@".withAncestor("];
+		[rv appendString:self.ancestorElement.detoxDescription];
+		[rv appendString:@")"];
 	}
 	
 	if(self.requiresAtIndex)
 	{
-		[rv appendFormat:@".atIndex(%@)", @(self.atIndex)];
+		[rv appendFormat:@".atIndex(%ld)", (long)self.atIndex];
 	}
 	
 	return rv;
@@ -7,6 +7,7 @@
 //
 
 #import "_DTXCodeCommentAction.h"
+#import "DTXRecordedAction-Private.h"
 
 @implementation _DTXCodeCommentAction
 
@@ -22,9 +23,27 @@
 	return self;
 }
 
-- (NSString *)detoxDescription
+- (id)copyWithZone:(NSZone *)zone
+{
+	_DTXCodeCommentAction* rv = [super copyWithZone:zone];
+	rv->_comment = _comment;
+	
+	return rv;
+}
+
+- (NSString *)generateDetoxDescription
 {
 	return [NSString stringWithFormat:@"//%@", _comment];
 }
 
+- (DTXRecordedActionVariant)eventLogVariant
+{
+	return DTXRecordedActionVariantCodeComment;
+}
+
+- (NSArray*)eventLogSecondaryArgs
+{
+	return _comment != nil ? @[_comment] : nil;
+}
+
 @end
@@ -14,6 +14,11 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (nullable instancetype)initWithView:(UIView*)view text:(NSString*)text;
 
+/// Whether this action replaces the text of the view; return key taps do not.
+- (BOOL)isReplacingTextOfView:(UIView*)view;
+/// Returns NO if the text is unchanged.
+- (BOOL)updateText:(NSString*)text;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -16,28 +16,57 @@
 	
 	if(self)
 	{
-		if(text.length > 0)
-		{
-			self.actionType = DTXRecordedActionTypeReplaceText;
-			self.actionArgs = @[text];
-		}
-		else
-		{
-			self.actionType = DTXRecordedActionTypeClearText;
-		}
+		[self _setText:text];
 	}
 	
 	return self;
 }
 
-- (NSString *)detoxDescription
+- (void)_setText:(NSString*)text
+{
+	if(text.length > 0)
+	{
+		self.actionType = DTXRecordedActionTypeReplaceText;
+		self.actionArgs = @[text];
+	}
+	else
+	{
+		self.actionType = DTXRecordedActionTypeClearText;
+		self.actionArgs = nil;
+	}
+}
+
+- (BOOL)isReplacingTextOfView:(UIView*)view
+{
+	return [self.element isReferencingView:view] && self.eventLogVariant != DTXRecordedActionVariantTapReturnKey;
+}
+
+- (BOOL)updateText:(NSString*)text
+{
+	NSString* currentText = self.actionArgs.firstObject ?: @"";
+	if([currentText isEqualToString:text])
+	{
+		return NO;
+	}
+	
+	[self _setText:text];
+	
+	return YES;
+}
+
+- (NSString *)generateDetoxDescription
 {
 	if([self.actionArgs.firstObject isEqualToString:@"\n"])
 	{
 		return [NSString stringWithFormat:@"await %@.tapReturnKey();", self.element.detoxDescription];
 	}
 	
-	return super.detoxDescription;
+	return super.generateDetoxDescription;
+}
+
+- (DTXRecordedActionVariant)eventLogVariant
+{
+	return [self.actionArgs.firstObject isEqualToString:@"\n"] ? DTXRecordedActionVariantTapReturnKey : DTXRecordedActionVariantDefault;
 }
 
 @end
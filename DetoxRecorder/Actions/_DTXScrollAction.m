@@ -15,6 +15,8 @@
 @property (nonatomic) BOOL isScrollToVisible;
 @property (nonatomic) CGPoint originOffset;
 @property (nonatomic, strong) DTXRecordedElement* targetElement;
+//Horizontal component of a scroll that also moved vertically; split into an action of its own when committed
+@property (nonatomic, copy) NSArray* secondaryActionArgs;
 
 @end
 
@@ -27,21 +29,21 @@ static BOOL DTXUpdateScrollAction(_DTXScrollAction* action, UIScrollView* scroll
 		return NO;
 	}
 	
-	NSString* dir;
-	CGFloat d;
-	//Implicit assumption that no multidirectional scrolls will occur
-	if(dy != 0)
+	NSArray* verticalArgs = dy != 0 ? @[@(ABS(dy)), dy > 0 ? @"down" : @"up"] : nil;
+	NSArray* horizontalArgs = dx != 0 ? @[@(ABS(dx)), dx < 0 ? @"left" : @"right"] : nil;
+	
+	//Vertical movement takes precedence; horizontal movement of the same scroll becomes a second action.
+	if(verticalArgs != nil)
 	{
-		dir = dy > 0 ? @"down" : @"up";
-		d = ABS(dy);
+		action.actionArgs = verticalArgs;
+		action.secondaryActionArgs = horizontalArgs;
 	}
 	else
 	{
-		dir = dx < 0 ? @"left" : @"right";
-		d = ABS(dx);
+		action.actionArgs = horizontalArgs;
+		action.secondaryActionArgs = nil;
 	}
-	
-	action.actionArgs = @[@(ABS(d)), dir];
+	[action invalidateDetoxDescription];
 	
 	return YES;
 }
@@ -72,6 +74,17 @@ static BOOL DTXUpdateScrollAction(_DTXScrollAction* action, UIScrollView* scroll
 	return self;
 }
 
+- (id)copyWithZone:(NSZone *)zone
+{
+	_DTXScrollAction* rv = [super copyWithZone:zone];
+	rv.isScrollToVisible = self.isScrollToVisible;
+	rv.originOffset = self.originOffset;
+	rv.targetElement = self.targetElement;
+	rv.secondaryActionArgs = self.secondaryActionArgs;
+	
+	return rv;
+}
+
 - (BOOL)updateScrollActionWithScrollView:(UIScrollView*)scrollView fromDeltaOriginOffset:(CGPoint)deltaOriginOffset toNewOffset:(CGPoint)newOffset
 {
 	ASSERT_ALLOWS_UPDATES
@@ -94,20 +107,50 @@ static BOOL DTXUpdateScrollAction(_DTXScrollAction* action, UIScrollView* scroll
 	NSMutableArray* args = self.actionArgs.mutableCopy;
 	args[0] = @50;
 	self.actionArgs = args;
-
+	
 	self.targetElement = targetElement;
+	self.secondaryActionArgs = nil;
+	[self invalidateDetoxDescription];
 	
 	return YES;
 }
 
-- (NSString*)detoxDescription;
+- (DTXRecordedAction*)splitSecondaryScrollAction
+{
+	if(self.isScrollToVisible || self.secondaryActionArgs.count != 2)
+	{
+		return nil;
+	}
+	
+	_DTXScrollAction* rv = [self copy];
+	rv.actionArgs = self.secondaryActionArgs;
+	rv.secondaryActionArgs = nil;
+	
+	self.secondaryActionArgs = nil;
+	//The vertical part is followed by the horizontal one, so only the latter may still be enhanced.
+	self.allowsUpdates = NO;
+	
+	return rv;
+}
+
+- (NSString*)generateDetoxDescription;
 {
 	if(self.isScrollToVisible == NO)
 	{
-		return [super detoxDescription];
+		return [super generateDetoxDescription];
 	}
 	
 	return [NSString stringWithFormat:@"await waitFor(%@).toBeVisible().whileElement(%@).scroll(%@, \"%@\");", self.targetElement.detoxDescription, self.element.detoxDescription, self.actionArgs.firstObject, self.actionArgs.lastObject];
 }
 
+- (DTXRecordedActionVariant)eventLogVariant
+{
+	return self.isScrollToVisible ? DTXRecordedActionVariantScrollToVisible : DTXRecordedActionVariantDefault;
+}
+
+- (DTXRecordedElement*)eventLogSecondaryElement
+{
+	return self.isScrollToVisible ? self.targetElement : nil;
+}
+
 @end
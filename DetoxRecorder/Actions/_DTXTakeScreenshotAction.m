@@ -35,4 +35,12 @@ static NSUInteger screenshotCounter = 0;
 	return self;
 }
 
+- (id)copyWithZone:(NSZone *)zone
+{
+	_DTXTakeScreenshotAction* rv = [super copyWithZone:zone];
+	rv->_screenshotName = _screenshotName;
+	
+	return rv;
+}
+
 @end
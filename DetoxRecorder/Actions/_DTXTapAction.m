@@ -16,7 +16,7 @@
 	
 	if(self)
 	{
-		BOOL atPoint = NSUserDefaults.standardUserDefaults.dtxrec_attemptXYRecording && (event != nil || tgr != nil);
+		BOOL atPoint = DTXRecorderSettingsCurrent->attemptXYRecording && (event != nil || tgr != nil);
 		
 		self.actionType = DTXRecordedActionTypeTap;
 		if(atPoint)
@@ -24,6 +24,11 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)interactionRecorderDidAddTestCommand:(NSString*)command;
 - (void)interactionRecorderDidUpdateLastTestCommandWithCommand:(nullable NSString*)command;
 
+/* Recorder overhead */
+
+/// Per-session counters, such as "actions", "updates", "coalescedScrolls", "viewsVisited" and "bytesSent".
+- (void)interactionRecorderDidEndRecordingWithStatistics:(NSDictionary<NSString*, NSNumber*>*)statistics;
+
 @end
 
 @interface DTXUIInteractionRecorder : NSObject
@@ -52,6 +57,8 @@ NS_ASSUME_NONNULL_BEGIN
 + (void)addSliderAdjustEvent:(UISlider*)slider withEvent:(nullable UIEvent*)event;
 
 + (void)addTextChangeEvent:(UIView<UITextInput>*)textInput;
+/// Records the text change with text already known by the caller, rather than reading the whole document.
++ (void)addTextChangeEvent:(UIView<UITextInput>*)textInput text:(NSString*)text;
 + (void)addTextReturnKeyEvent:(UIView<UITextInput>*)textInput;
 
 + (void)addDeviceShake;
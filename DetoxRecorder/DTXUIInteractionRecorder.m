@@ -9,10 +9,25 @@
 #import "DTXUIInteractionRecorder-Private.h"
 #import "DTXCaptureControlWindow.h"
 #import "DTXRecordedAction.h"
+#import "_DTXReplaceTextAction.h"
 #import "DTXAppleInternals.h"
 #import "NSUserDefaults+RecorderUtils.h"
 #import "NSString+SimulatorSafeTildeExpansion.h"
+#import "DTXRecordingWireFormat.h"
+#import "DTXRecordingFileWriter.h"
+#import "DTXRecordingEventLog.h"
+#import "DTXRecordingVideoCapture.h"
+#import "DTXReferenceScreenshotWriter.h"
+#import "UIInputCapture.h"
+#import "DTXVisualizationScheduler.h"
+#import "DTXCaptureHooks.h"
+#import "DTXEventRouter.h"
+#import "DTXRecorderInstrumentation.h"
 #import <DTXSocketConnection/DTXSocketConnection.h>
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <netinet/in.h>
+#import <arpa/inet.h>
 
 DTX_CREATE_LOG(InteractionController)
 
@@ -21,13 +36,70 @@ DTX_CREATE_LOG(InteractionController)
 @interface _DTXVisualizedView : UIView
 
 @property (nonatomic, strong) NSArray<UIImageView*>* imageViews;
+//When NO, image views are laid out by the animation instead
+@property (nonatomic) BOOL fillsImageViews;
+//Changes each time the view is reused, so completions of earlier animations do not recycle it again
+@property (nonatomic) NSUInteger reuseToken;
+//From being dequeued until recycled into the pool
+@property (nonatomic, getter=isActive) BOOL active;
 
 @end
-@implementation _DTXVisualizedView @end
+
+@implementation _DTXVisualizedView
+
+- (void)layoutSubviews
+{
+	[super layoutSubviews];
+	
+	if(self.fillsImageViews == NO)
+	{
+		return;
+	}
+	
+	CGRect bounds = self.bounds;
+	CGPoint center = CGPointMake(CGRectGetMidX(bounds), CGRectGetMidY(bounds));
+	for(UIImageView* imageView in self.imageViews)
+	{
+		//Image views may be transformed, so set bounds and center rather than frame
+		imageView.bounds = bounds;
+		imageView.center = center;
+	}
+}
+
+@end
+
+static NSMutableArray<_DTXVisualizedView*>* _visualizerPool;
+static const NSUInteger DTXVisualizerPoolCapacity = 8;
+
+DTX_ALWAYS_INLINE
+static UIImage* DTXCachedSystemImage(NSString* systemImageName, CGFloat pointSize)
+{
+	static NSCache<NSString*, UIImage*>* cache;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		cache = [NSCache new];
+	});
+	
+	//Sizes are derived from view frames; rounding keeps the number of cached images small.
+	pointSize = round(pointSize);
+	NSString* key = [NSString stringWithFormat:@"%@|%@", systemImageName, @(pointSize)];
+	UIImage* rv = [cache objectForKey:key];
+	if(rv == nil)
+	{
+		rv = [UIImage systemImageNamed:systemImageName withConfiguration:[UIImageSymbolConfiguration configurationWithPointSize:pointSize weight:UIImageSymbolWeightMedium]];
+		if(rv != nil)
+		{
+			[cache setObject:rv forKey:key];
+		}
+	}
+	
+	return rv;
+}
 
 @interface DTXUIInteractionRecorder ()
 
 + (void)netServiceDidResolveAddress:(NSNetService *)sender;
++ (void)_startSessionWithConnection:(DTXSocketConnection*)connection;
 + (void)netService:(NSNetService *)sender didNotResolve:(NSDictionary<NSString *, NSNumber *> *)errorDict;
 + (void)readClosedForSocketConnection:(DTXSocketConnection*)socketConnection;
 + (void)writeClosedForSocketConnection:(DTXSocketConnection*)socketConnection;
@@ -39,21 +111,309 @@ DTX_DIRECT_MEMBERS
 
 static __weak id<DTXUIInteractionRecorderDelegate> delegate;
 static BOOL startedByUser;
-static NSMutableArray<DTXRecordedAction*>* recordedActions;
+//Only the last action can still be updated; earlier actions are reduced to their final description
+static DTXRecordedAction* lastRecordedAction;
+static NSMutableArray<NSString*>* committedCommands;
+static NSUInteger recordedActionCount;
 static DTXCaptureControlWindow* captureControlWindow;
-static UIView* previousTextChangeVisualizer;
+//Only valid while active; recycling clears it
+static __weak _DTXVisualizedView* previousTextChangeVisualizer;
 static dispatch_block_t _appearanceBlock;
 
 //Socket connection based recording
 static NSNetService* _service;
 static DTXSocketConnection* _currentConnection;
 static dispatch_source_t _pingTimer;
+//Pings are only sent once the connection has been idle for this long
+static NSTimeInterval _keepAliveIdleInterval;
+static uint64_t _lastSendTime;
+
+//Formatting, serialization and sending happen here, in recording order
+static dispatch_queue_t _recorderQueue;
+
+//The simulator shares the host's loopback and file system, so the CLI can be reached without Bonjour.
+static BOOL DTXWantsDirectConnection(void)
+{
+	return [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecServiceSocketPath"].length > 0 || [NSUserDefaults.standardUserDefaults integerForKey:@"DTXRecServicePort"] > 0;
+}
+
+//Connects synchronously; a local peer either accepts immediately or is not there at all.
+static DTXSocketConnection* DTXOpenDirectConnection(void)
+{
+	NSString* socketPath = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecServiceSocketPath"];
+	NSInteger port = [NSUserDefaults.standardUserDefaults integerForKey:@"DTXRecServicePort"];
+	
+	int fd = -1;
+	if(socketPath.length > 0)
+	{
+		struct sockaddr_un addr = {0};
+		addr.sun_len = sizeof(addr);
+		addr.sun_family = AF_UNIX;
+		if(strlcpy(addr.sun_path, socketPath.fileSystemRepresentation, sizeof(addr.sun_path)) >= sizeof(addr.sun_path))
+		{
+			dtx_log_error(@"Recording service socket path is too long: %@", socketPath);
+			return nil;
+		}
+		
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	else if(port > 0 && port <= UINT16_MAX)
+	{
+		NSString* host = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecServiceHost"] ?: @"127.0.0.1";
+		
+		struct sockaddr_in addr = {0};
+		addr.sin_len = sizeof(addr);
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons((uint16_t)port);
+		if(inet_pton(AF_INET, host.UTF8String, &addr.sin_addr) != 1)
+		{
+			dtx_log_error(@"Recording service host is not a numeric IPv4 address: %@", host);
+			return nil;
+		}
+		
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if(fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	
+	if(fd < 0)
+	{
+		dtx_log_error(@"Unable to connect directly to the recording service: %s", strerror(errno));
+		return nil;
+	}
+	
+	CFReadStreamRef readStream = NULL;
+	CFWriteStreamRef writeStream = NULL;
+	CFStreamCreatePairWithSocket(kCFAllocatorDefault, fd, &readStream, &writeStream);
+	if(readStream == NULL || writeStream == NULL)
+	{
+		if(readStream != NULL)
+		{
+			CFRelease(readStream);
+		}
+		if(writeStream != NULL)
+		{
+			CFRelease(writeStream);
+		}
+		close(fd);
+		return nil;
+	}
+	
+	CFReadStreamSetProperty(readStream, kCFStreamPropertyShouldCloseNativeSocket, kCFBooleanTrue);
+	CFWriteStreamSetProperty(writeStream, kCFStreamPropertyShouldCloseNativeSocket, kCFBooleanTrue);
+	
+	return [[DTXSocketConnection alloc] initWithInputStream:CFBridgingRelease(readStream) outputStream:CFBridgingRelease(writeStream) delegateQueue:nil];
+}
 
 DTX_ALWAYS_INLINE
-static void DTXSendCommand(NSDictionary* dict)
+static dispatch_queue_t DTXRecorderQueue(void)
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		_recorderQueue = dispatch_queue_create("com.wix.DTXRecorderQueue", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+	});
+	
+	return _recorderQueue;
+}
+
+//In-process recording, streamed to DTXRecTestOutputPath as actions are recorded
+static DTXRecordingFileWriter* _fileWriter;
+
+//Must be called on the recorder queue
+static DTXRecordingFileWriter* DTXFileWriter(void)
+{
+	if(_fileWriter == nil)
+	{
+		NSString* testNamePath = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecTestOutputPath"];
+		NSString* testName = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecTestName"] ?: @"My Recorded Test";
+		
+		_fileWriter = [[DTXRecordingFileWriter alloc] initWithURL:[NSURL fileURLWithPath:testNamePath.dtx_stringByExpandingTildeInPath] testName:testName];
+	}
+	
+	return _fileWriter;
+}
+
+//Structured log of the recorded actions, written alongside the test when DTXRecEventLogPath is set
+static DTXRecordingEventLog* _eventLog;
+
+//Must be called on the recorder queue
+static void DTXOpenEventLog(void)
 {
-	NSData* data = [NSPropertyListSerialization dataWithPropertyList:dict format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+	NSString* eventLogPath = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecEventLogPath"];
+	if(eventLogPath.length == 0)
+	{
+		return;
+	}
 	
+	NSString* testName = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecTestName"] ?: @"My Recorded Test";
+	NSError* error = nil;
+	_eventLog = [[DTXRecordingEventLog alloc] initWithURL:[NSURL fileURLWithPath:eventLogPath.dtx_stringByExpandingTildeInPath] testName:testName error:&error];
+	if(_eventLog == nil)
+	{
+		dtx_log_error(@"Unable to create event log: %@", error);
+	}
+}
+
+//Screen recording of the session, with a chapter per action, when DTXRecVideoPath is set; main thread only
+static DTXRecordingVideoCapture* _videoCapture;
+
+static void DTXStartVideoCaptureIfNeeded(void)
+{
+	NSString* videoPath = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecVideoPath"];
+	if(videoPath.length == 0)
+	{
+		return;
+	}
+	
+	_videoCapture = [[DTXRecordingVideoCapture alloc] initWithURL:[NSURL fileURLWithPath:videoPath.dtx_stringByExpandingTildeInPath]];
+	[_videoCapture start];
+}
+
+//Reference images for screenshot actions, written to DTXRecScreenshotsPath, or next to DTXRecTestOutputPath when DTXRecCaptureScreenshots is set; main thread only
+static DTXReferenceScreenshotWriter* _referenceScreenshotWriter;
+
+static void DTXOpenReferenceScreenshotWriterIfNeeded(void)
+{
+	NSUserDefaults* defaults = NSUserDefaults.standardUserDefaults;
+	NSString* screenshotsPath = [defaults stringForKey:@"DTXRecScreenshotsPath"];
+	NSString* testOutputPath = [defaults stringForKey:@"DTXRecTestOutputPath"];
+	
+	NSURL* directoryURL = nil;
+	if(screenshotsPath.length > 0)
+	{
+		directoryURL = [NSURL fileURLWithPath:screenshotsPath.dtx_stringByExpandingTildeInPath isDirectory:YES];
+	}
+	else if([defaults boolForKey:@"DTXRecCaptureScreenshots"] && testOutputPath.length > 0)
+	{
+		directoryURL = [[[NSURL fileURLWithPath:testOutputPath.dtx_stringByExpandingTildeInPath] URLByDeletingPathExtension] URLByAppendingPathExtension:@"screenshots"];
+	}
+	
+	if(directoryURL == nil)
+	{
+		return;
+	}
+	
+	_referenceScreenshotWriter = [[DTXReferenceScreenshotWriter alloc] initWithDirectoryURL:directoryURL usesHEIC:[[defaults stringForKey:@"DTXRecScreenshotFormat"] isEqualToString:@"heic"]];
+}
+
+//Scroll actions still open for coalescing, at most one per scroll view, in order of creation
+static NSMutableArray<DTXRecordedAction*>* openScrollActions;
+static NSTimer* openScrollActionsTimer;
+static const NSUInteger DTXMaxOpenScrollActions = 4;
+static const NSTimeInterval DTXOpenScrollActionsWindow = 2.0;
+
+static void DTXAddAction(DTXRecordedAction* action);
+
+static void DTXCommitOpenScrollActions(void)
+{
+	[openScrollActionsTimer invalidate];
+	openScrollActionsTimer = nil;
+	
+	NSArray<DTXRecordedAction*>* actions = openScrollActions;
+	openScrollActions = nil;
+	
+	for(DTXRecordedAction* action in actions)
+	{
+		DTXAddAction(action);
+	}
+}
+
+//A non-scroll interaction commits the open scrolls of other elements; one on the scroll view itself keeps its scroll open.
+static void DTXCommitOpenScrollActionsForAction(DTXRecordedAction* action)
+{
+	NSUInteger keptIdx = action.element == nil ? NSNotFound : [openScrollActions indexOfObjectPassingTest:^BOOL(DTXRecordedAction * _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
+		return [obj.element isEqualToElement:action.element];
+	}];
+	
+	if(keptIdx == NSNotFound)
+	{
+		DTXCommitOpenScrollActions();
+		return;
+	}
+	
+	DTXRecordedAction* kept = openScrollActions[keptIdx];
+	[openScrollActions removeObjectAtIndex:keptIdx];
+	
+	//Scrolling to an edge supersedes the open scroll's relative movement, so it is dropped rather than kept.
+	NSMutableArray<DTXRecordedAction*>* remaining = action.actionType == DTXRecordedActionTypeScrollTo ? nil : [NSMutableArray arrayWithObject:kept];
+	NSArray<DTXRecordedAction*>* committed = openScrollActions;
+	openScrollActions = remaining;
+	
+	for(DTXRecordedAction* committedAction in committed)
+	{
+		DTXAddAction(committedAction);
+	}
+	
+	if(openScrollActions.count == 0)
+	{
+		[openScrollActionsTimer invalidate];
+		openScrollActionsTimer = nil;
+	}
+}
+
+//Negotiated with the CLI through launch arguments; otherwise, plist commands are sent
+static BOOL _usesCompactWireFormat;
+static const NSTimeInterval DTXFrameCoalescingInterval = 0.02;
+
+//Commands wait here until the CLI has taken the previous writes, so a slow peer cannot pile up writes in memory.
+@interface _DTXOutboundCommand : NSObject
+
+@property (nonatomic) DTXRecordingCommandType type;
+@property (nonatomic, copy) NSString* command;
+
+@end
+
+@implementation _DTXOutboundCommand
+
+@end
+
+typedef NS_ENUM(NSUInteger, DTXSendOverflowPolicy) {
+	//Ends the recording with an error, the same as a failed write
+	DTXSendOverflowPolicyDisconnect,
+	//Keeps recording and discards the commands that do not fit; the CLI's test will be missing them
+	DTXSendOverflowPolicyDiscard,
+};
+
+static NSMutableArray<_DTXOutboundCommand*>* _outboundCommands;
+static NSUInteger _outboundCommandLimit;
+static DTXSendOverflowPolicy _sendOverflowPolicy;
+static BOOL _sendOverflowed;
+static NSUInteger _outstandingSends;
+static BOOL _outboundFlushScheduled;
+static const NSUInteger DTXMaxOutstandingSends = 2;
+static const NSUInteger DTXDefaultOutboundCommandLimit = 1024;
+
+static void DTXDrainOutboundCommands(BOOL force);
+
+//Must be called on the recorder queue
+static void DTXResetOutboundCommands(NSUInteger limit, DTXSendOverflowPolicy policy)
+{
+	_outboundCommands = [NSMutableArray new];
+	_outboundCommandLimit = limit > 0 ? limit : DTXDefaultOutboundCommandLimit;
+	_sendOverflowPolicy = policy;
+	_sendOverflowed = NO;
+	_outstandingSends = 0;
+	_outboundFlushScheduled = NO;
+}
+
+//Must be called on the recorder queue
+DTX_ALWAYS_INLINE
+static void DTXSendData(NSData* data)
+{
+	DTX_SIGNPOST_INTERVAL("Socket Send");
+	
+	_lastSendTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+	DTXRecorderCounterAdd(DTXRecorderCounterBytesSent, data.length);
+	
+	_outstandingSends += 1;
 	[_currentConnection sendMessage:data completionHandler:^(NSError * _Nullable error) {
 		if(error != nil)
 		{
@@ -61,28 +421,256 @@ static void DTXSendCommand(NSDictionary* dict)
 				[DTXUIInteractionRecorder stopRecording];
 			}];
 		}
+		
+		dispatch_async(DTXRecorderQueue(), ^{
+			_outstandingSends -= 1;
+			if(error == nil)
+			{
+				DTXDrainOutboundCommands(NO);
+			}
+		});
 	}];
 }
 
+//Must be called on the recorder queue
+static void DTXDrainOutboundCommands(BOOL force)
+{
+	if(_currentConnection == nil)
+	{
+		[_outboundCommands removeAllObjects];
+		return;
+	}
+	
+	while(_outboundCommands.count > 0 && (force || _outstandingSends < DTXMaxOutstandingSends))
+	{
+		if(_usesCompactWireFormat)
+		{
+			//Everything that queued up while waiting goes out as a single frame.
+			NSMutableData* frame;
+			{
+				DTX_SIGNPOST_INTERVAL("Serialization");
+				
+				frame = DTXRecordingFrameCreate();
+				for(_DTXOutboundCommand* command in _outboundCommands)
+				{
+					DTXRecordingFrameAppendCommand(frame, command.type, command.command);
+				}
+				[_outboundCommands removeAllObjects];
+			}
+			
+			DTXSendData(frame);
+			
+			continue;
+		}
+		
+		_DTXOutboundCommand* command = _outboundCommands.firstObject;
+		[_outboundCommands removeObjectAtIndex:0];
+		
+		NSData* data;
+		{
+			DTX_SIGNPOST_INTERVAL("Serialization");
+			
+			NSMutableDictionary* dict = [NSMutableDictionary dictionaryWithObject:DTXRecordingCommandTypeName(command.type) forKey:@"type"];
+			dict[@"command"] = command.command;
+			
+			data = [NSPropertyListSerialization dataWithPropertyList:dict format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+		}
+		
+		DTXSendData(data);
+	}
+}
+
+//Must be called on the recorder queue
+//Returns YES if the command was merged into a queued command, which has not been sent yet.
+static BOOL DTXCollapseOutboundCommand(DTXRecordingCommandType type, NSString* command)
+{
+	_DTXOutboundCommand* last = _outboundCommands.lastObject;
+	if(last == nil || (last.type != DTXRecordingCommandTypeAdd && last.type != DTXRecordingCommandTypeUpdate))
+	{
+		return NO;
+	}
+	
+	//Updates and removals always apply to the last action, so only the newest state needs to be sent.
+	if(type == DTXRecordingCommandTypeUpdate)
+	{
+		last.command = command;
+		return YES;
+	}
+	
+	if(type == DTXRecordingCommandTypeRemove)
+	{
+		if(last.type == DTXRecordingCommandTypeAdd)
+		{
+			[_outboundCommands removeLastObject];
+		}
+		else
+		{
+			last.type = DTXRecordingCommandTypeRemove;
+			last.command = nil;
+		}
+		return YES;
+	}
+	
+	return NO;
+}
+
+//Must be called on the recorder queue
+static void DTXSendCommand(DTXRecordingCommandType type, NSString* command)
+{
+	//A keep-alive is pointless while other data is still on its way.
+	if(type == DTXRecordingCommandTypePing && (_outboundCommands.count > 0 || _outstandingSends > 0))
+	{
+		return;
+	}
+	
+	if(DTXCollapseOutboundCommand(type, command))
+	{
+		DTXRecorderCounterAdd(DTXRecorderCounterCollapsedCommands, 1);
+		return;
+	}
+	
+	BOOL endsSession = type == DTXRecordingCommandTypeEnd || type == DTXRecordingCommandTypeSummary;
+	if(endsSession == NO && (_sendOverflowed || _outboundCommands.count >= _outboundCommandLimit))
+	{
+		DTXRecorderCounterAdd(DTXRecorderCounterDroppedCommands, 1);
+		
+		if(_sendOverflowed == NO)
+		{
+			_sendOverflowed = _sendOverflowPolicy == DTXSendOverflowPolicyDisconnect;
+			dtx_log_error(@"The recording service is not keeping up; %lu commands are pending", (unsigned long)_outboundCommands.count);
+			
+			if(_sendOverflowed)
+			{
+				[DTXUIInteractionRecorder _presentError:[NSError errorWithDomain:@"" code:0 userInfo:@{NSLocalizedDescriptionKey: @"The recording service is not responding."}] completionHandler:^{
+					[DTXUIInteractionRecorder stopRecording];
+				}];
+			}
+		}
+		
+		return;
+	}
+	
+	_DTXOutboundCommand* outbound = [_DTXOutboundCommand new];
+	outbound.type = type;
+	outbound.command = command;
+	[_outboundCommands addObject:outbound];
+	
+	if(type == DTXRecordingCommandTypeEnd)
+	{
+		DTXDrainOutboundCommands(YES);
+	}
+	else if(_usesCompactWireFormat == NO)
+	{
+		DTXDrainOutboundCommands(NO);
+	}
+	else if(_outboundFlushScheduled == NO)
+	{
+		_outboundFlushScheduled = YES;
+		
+		//Commands arriving within the window, such as typing updates, share a single frame.
+		dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(DTXFrameCoalescingInterval * NSEC_PER_SEC)), DTXRecorderQueue(), ^{
+			_outboundFlushScheduled = NO;
+			DTXDrainOutboundCommands(NO);
+		});
+	}
+}
+
+//Must be called on the recorder queue
+static void DTXWriteSummary(NSDictionary<NSString*, NSNumber*>* statistics, NSURL* testURL)
+{
+	if(testURL == nil)
+	{
+		return;
+	}
+	
+	NSURL* summaryURL = [[testURL URLByDeletingPathExtension] URLByAppendingPathExtension:@"summary.json"];
+	NSData* data = [NSJSONSerialization dataWithJSONObject:statistics options:NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys error:NULL];
+	NSError* error = nil;
+	if([data writeToURL:summaryURL options:NSDataWritingAtomic error:&error] == NO)
+	{
+		dtx_log_error(@"Unable to write recording summary: %@", error);
+	}
+}
+
+//Committed descriptions are only retained when something needs them once recording ends.
 DTX_ALWAYS_INLINE
+static BOOL DTXNeedsCommittedCommands(void)
+{
+	return [delegate respondsToSelector:@selector(interactionRecorderDidEndRecordingWithTestCommands:)];
+}
+
+static void DTXCommitLastRecordedAction(void)
+{
+	if(lastRecordedAction == nil)
+	{
+		return;
+	}
+	
+	if(DTXNeedsCommittedCommands())
+	{
+		[committedCommands addObject:lastRecordedAction.detoxDescription];
+	}
+	
+	lastRecordedAction = nil;
+}
+
 static void DTXAddAction(DTXRecordedAction* action)
 {
-	[DTXUIInteractionRecorder _enhanceLastScrollEventIfNeededForAction:action];
+	//Keeps a debounced text change ahead of whatever action follows it.
+	[UIInputCapture flushPendingTextChange];
 	
-	[recordedActions addObject:action];
+	if(action.actionType != DTXRecordedActionTypeScroll)
+	{
+		DTXCommitOpenScrollActionsForAction(action);
+	}
+	
+	//Each action is a single command; a diagonal scroll is added as a vertical and a horizontal scroll.
+	DTXRecordedAction* secondaryScrollAction = [action splitSecondaryScrollAction];
+	
+	[DTXUIInteractionRecorder _enhanceLastScrollEventIfNeededForAction:action];
 	
-	DTXSendCommand(@{@"type": @"add", @"command": action.detoxDescription});
+	DTXCommitLastRecordedAction();
+	lastRecordedAction = action;
+	recordedActionCount += 1;
+	DTXRecorderCounterAdd(DTXRecorderCounterActions, 1);
 	
+	//The delegate goes first, so that the snapshot inherits an already generated description.
 	if([delegate respondsToSelector:@selector(interactionRecorderDidAddTestCommand:)])
 	{
 		[delegate interactionRecorderDidAddTestCommand:action.detoxDescription];
 	}
+	
+	//Messaging nil still evaluates the description, so it is only generated here when capturing video.
+	if(_videoCapture != nil)
+	{
+		[_videoCapture addChapterWithTitle:action.detoxDescription];
+	}
+	
+	DTXRecordedAction* snapshot = [action copy];
+	BOOL sendsToConnection = _currentConnection != nil;
+	dispatch_async(DTXRecorderQueue(), ^{
+		[_eventLog appendAction:snapshot operation:DTXRecordingCommandTypeAdd];
+		
+		if(sendsToConnection)
+		{
+			DTXSendCommand(DTXRecordingCommandTypeAdd, snapshot.detoxDescription);
+		}
+		else
+		{
+			[DTXFileWriter() addCommand:snapshot.detoxDescription];
+		}
+	});
+	
+	if(secondaryScrollAction != nil)
+	{
+		DTXAddAction(secondaryScrollAction);
+	}
 }
 
 DTX_ALWAYS_INLINE
 static BOOL DTXUpdateAction(BOOL (^updateBlock)(DTXRecordedAction* action, BOOL* remove))
 {
-	DTXRecordedAction* action = recordedActions.lastObject;
+	DTXRecordedAction* action = lastRecordedAction;
 	
 	if(action == nil)
 	{
@@ -94,19 +682,38 @@ static BOOL DTXUpdateAction(BOOL (^updateBlock)(DTXRecordedAction* action, BOOL*
 	
 	if(remove)
 	{
-		[recordedActions removeLastObject];
+		//The previous action has already been committed, so no action is updatable until the next one is added.
+		lastRecordedAction = nil;
+		recordedActionCount -= 1;
 	}
 	
 	if(rv == YES)
 	{
-		if(remove == NO)
-		{
-			DTXSendCommand(@{@"type": @"update", @"command": action.detoxDescription});
-		}
-		else
-		{
-			DTXSendCommand(@{@"type": @"remove"});
-		}
+		DTXRecorderCounterAdd(DTXRecorderCounterUpdates, 1);
+		
+		DTXRecordedAction* snapshot = remove ? nil : [action copy];
+		BOOL sendsToConnection = _currentConnection != nil;
+		dispatch_async(DTXRecorderQueue(), ^{
+			[_eventLog appendAction:snapshot operation:snapshot != nil ? DTXRecordingCommandTypeUpdate : DTXRecordingCommandTypeRemove];
+			
+			if(sendsToConnection == NO)
+			{
+				[DTXFileWriter() updateLastCommand:snapshot.detoxDescription];
+			}
+			else if(snapshot != nil)
+			{
+				DTXSendCommand(DTXRecordingCommandTypeUpdate, snapshot.detoxDescription);
+			}
+			else
+			{
+				DTXSendCommand(DTXRecordingCommandTypeRemove, nil);
+			}
+		});
+	}
+	
+	if(rv == YES && _videoCapture != nil)
+	{
+		[_videoCapture updateLastChapterTitle:remove ? nil : action.detoxDescription];
 	}
 	
 	if(rv == YES && [delegate respondsToSelector:@selector(interactionRecorderDidUpdateLastTestCommandWithCommand:)])
@@ -170,17 +777,37 @@ static BOOL DTXUpdateAction(BOOL (^updateBlock)(DTXRecordedAction* action, BOOL*
 	
 	startedByUser = byUser;
 	
-	recordedActions = [NSMutableArray new];
+	//Nothing is hooked until recording actually starts.
+	[NSUserDefaults dtxrec_loadSettingsSnapshot];
+	DTXCaptureHooksInstall();
+	DTXRecorderCountersReset();
+	
+	lastRecordedAction = nil;
+	committedCommands = [NSMutableArray new];
+	recordedActionCount = 0;
 	[DTXRecordedAction resetScreenshotCounter];
 	
+	dispatch_async(DTXRecorderQueue(), ^{
+		DTXOpenEventLog();
+	});
+	DTXStartVideoCaptureIfNeeded();
+	DTXOpenReferenceScreenshotWriterIfNeeded();
+	
 	captureControlWindow = [[DTXCaptureControlWindow alloc] initWithFrame:UIScreen.mainScreen.bounds];
 	_appearanceBlock = ^ {
 		[captureControlWindow appear];
 	};
 	
 	NSString* serviceName = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXServiceName"];
-	if(serviceName != nil)
+	DTXSocketConnection* directConnection = DTXWantsDirectConnection() ? DTXOpenDirectConnection() : nil;
+	if(directConnection != nil)
+	{
+		dtx_log_info(@"Connected directly to the recording service");
+		[self _startSessionWithConnection:directConnection];
+	}
+	else if(serviceName != nil)
 	{
+		//Bonjour is the fallback for when no direct address was provided or it could not be reached.
 		_service = [[NSNetService alloc] initWithDomain:@"local" type:@"_detoxrecorder._tcp" name:serviceName];
 		[_service scheduleInRunLoop:NSRunLoop.currentRunLoop forMode:NSDefaultRunLoopMode];
 		_service.delegate = (id)self;
@@ -188,6 +815,11 @@ static BOOL DTXUpdateAction(BOOL (^updateBlock)(DTXRecordedAction* action, BOOL*
 	}
 	else
 	{
+		//Creates the output file up front, so that even an empty recording survives a crash.
+		dispatch_async(DTXRecorderQueue(), ^{
+			DTXFileWriter();
+		});
+		
 		_appearanceBlock();
 		_appearanceBlock = nil;
 	}
@@ -211,10 +843,12 @@ static BOOL DTXUpdateAction(BOOL (^updateBlock)(DTXRecordedAction* action, BOOL*
 	}
 }
 
-#define IGNORE_IF_WAS_ERROR(x) if(fileError == nil) { x; if(fileError != nil) { dtx_log_error(@"Error writing to output file: %@", fileError.localizedDescription); } }
-
 + (void)stopRecording
 {
+	[UIInputCapture flushPendingTextChange];
+	DTXCommitOpenScrollActions();
+	[DTXVisualizationScheduler cancelPendingVisualizations];
+	
 	if(_pingTimer != nil)
 	{
 		dispatch_cancel(_pingTimer);
@@ -222,97 +856,99 @@ static BOOL DTXUpdateAction(BOOL (^updateBlock)(DTXRecordedAction* action, BOOL*
 	_pingTimer = nil;
 	
 	__block NSError* fileError = nil;
-	BOOL delayExit = NO;
 	
-	NSFileHandle* file = nil;
-	if(_currentConnection == nil)
-	{
-		NSString* testNamePath = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecTestOutputPath"];
-		NSString* testName = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecTestName"] ?: @"My Recorded Test";
-	
-		NSURL* testOutputURL = [NSURL fileURLWithPath:testNamePath.dtx_stringByExpandingTildeInPath];
-		NSURL* directoryURL;
-		
-		if(testOutputURL.hasDirectoryPath)
-		{
-			directoryURL = testOutputURL;
-			testOutputURL = [testOutputURL URLByAppendingPathComponent:@"recorder_test.js" isDirectory:NO];
-		} else {
-			directoryURL = [testOutputURL URLByDeletingLastPathComponent];
-		}
-		
-		IGNORE_IF_WAS_ERROR([NSFileManager.defaultManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:&fileError]);
-		
-		if(testOutputURL != nil)
-		{
-			IGNORE_IF_WAS_ERROR([@"" writeToURL:testOutputURL atomically:YES encoding:NSUTF8StringEncoding error:&fileError]);
-			IGNORE_IF_WAS_ERROR(file = [NSFileHandle fileHandleForWritingToURL:testOutputURL error:&fileError]);
-		}
-		
-		NSString* str = [NSString stringWithFormat:@"describe('Recorded suite', () => {\n\tit('%@', async () => {\n", testName];
-		IGNORE_IF_WAS_ERROR([file writeData:[str dataUsingEncoding:NSUTF8StringEncoding]]);
-	}
+	DTXCommitLastRecordedAction();
 	
-	NSMutableArray<NSString*>* detoxCommands = nil;
 	if([delegate respondsToSelector:@selector(interactionRecorderDidEndRecordingWithTestCommands:)])
 	{
-		detoxCommands = [NSMutableArray new];
+		[delegate interactionRecorderDidEndRecordingWithTestCommands:committedCommands];
 	}
 	
-	[recordedActions enumerateObjectsUsingBlock:^(DTXRecordedAction * _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
-		NSString* detoxDescription = obj.detoxDescription;
-		
-		if(_currentConnection == nil)
-		{
-			NSString* str = [NSString stringWithFormat:@"\t\t%@\n", detoxDescription];
-			IGNORE_IF_WAS_ERROR([file writeData:[str dataUsingEncoding:NSUTF8StringEncoding] error:&fileError]);
-		}
-		
-		[detoxCommands addObject:detoxDescription];
-	}];
+	dispatch_async(DTXRecorderQueue(), ^{
+		[_eventLog close];
+		_eventLog = nil;
+	});
 	
-	if(detoxCommands != nil)
+	__block NSDictionary<NSString*, NSNumber*>* statistics = nil;
+	if(_currentConnection == nil)
 	{
-		[delegate interactionRecorderDidEndRecordingWithTestCommands:detoxCommands];
+		//Everything has already been written; this only waits for the last writes and closes the file.
+		dispatch_sync(DTXRecorderQueue(), ^{
+			NSError* error = nil;
+			[DTXFileWriter() closeAndReturnError:&error];
+			fileError = error;
+			
+			statistics = DTXRecorderCountersSnapshot();
+			DTXWriteSummary(statistics, DTXFileWriter().URL);
+			_fileWriter = nil;
+		});
 	}
-	
-	if(_currentConnection == nil)
+	else
 	{
-		IGNORE_IF_WAS_ERROR([file writeData:[@"\t})\n});" dataUsingEncoding:NSUTF8StringEncoding] error:&fileError]);
-		IGNORE_IF_WAS_ERROR([file closeAndReturnError:&fileError]);
+		//Drains all pending commands before ending the session.
+		dispatch_sync(DTXRecorderQueue(), ^{
+			statistics = DTXRecorderCountersSnapshot();
+			if([NSUserDefaults.standardUserDefaults boolForKey:@"DTXRecWritesSummary"])
+			{
+				//The CLI writes the summary next to the test file.
+				NSData* data = [NSJSONSerialization dataWithJSONObject:statistics options:NSJSONWritingSortedKeys error:NULL];
+				DTXSendCommand(DTXRecordingCommandTypeSummary, [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]);
+			}
+			DTXSendCommand(DTXRecordingCommandTypeEnd, nil);
+			[_currentConnection closeRead];
+			[_currentConnection closeWrite];
+			_currentConnection = nil;
+		});
 	}
 	
-	if(_currentConnection != nil)
+	committedCommands = nil;
+	recordedActionCount = 0;
+	
+	dtx_log_info(@"Recording statistics: %@", statistics);
+	if([delegate respondsToSelector:@selector(interactionRecorderDidEndRecordingWithStatistics:)])
 	{
-		DTXSendCommand(@{@"type": @"end"});
-		[_currentConnection closeRead];
-		[_currentConnection closeWrite];
-		_currentConnection = nil;
+		[delegate interactionRecorderDidEndRecordingWithStatistics:statistics];
 	}
 	
-	recordedActions = nil;
-	
 	dispatch_block_t UICleanupBlock = ^ {
 		captureControlWindow.hidden = YES;
 		captureControlWindow = nil;
 		
+		DTXCaptureHooksRemove();
+		
 		[self _exitIfNeeded];
 	};
 	
-	if(fileError != nil)
-	{
-		delayExit = YES;
-		[self _presentError:fileError completionHandler:UICleanupBlock];
-	}
+	dispatch_block_t finishBlock = ^ {
+		if(fileError != nil)
+		{
+			[self _presentError:fileError completionHandler:UICleanupBlock];
+		}
+		else
+		{
+			UICleanupBlock();
+		}
+	};
 	
-	if(delayExit == NO)
+	//The app may exit once cleaned up, so pending images have to be written first.
+	[_referenceScreenshotWriter waitUntilFinished];
+	_referenceScreenshotWriter = nil;
+	
+	if(_videoCapture == nil)
 	{
-		UICleanupBlock();
+		finishBlock();
+		return;
 	}
+	
+	//The app may exit once cleaned up, so the movie has to be finished first.
+	DTXRecordingVideoCapture* videoCapture = _videoCapture;
+	_videoCapture = nil;
+	[videoCapture stopWithCompletionHandler:^{
+		dispatch_async(dispatch_get_main_queue(), finishBlock);
+	}];
 }
 
-static NSTimeInterval lastRecordedEventTimestamp;
-#define IGNORE_IF_FROM_LAST_EVENT if(event != nil && event.timestamp == lastRecordedEventTimestamp) { return; } else { lastRecordedEventTimestamp = event.timestamp; }
+#define IGNORE_IF_FROM_LAST_EVENT if(event != nil && DTXEventRouterShouldRecordEvent(event) == NO) { return; }
 
 + (_DTXVisualizedView*)_visualizerViewForView:(UIView*)view action:(DTXRecordedAction*)action systemImageNames:(NSArray<NSString*>*)systemImageNames applyConstraints:(BOOL)applyConstraints
 {
@@ -354,12 +990,14 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 
 + (_DTXVisualizedView*)_visualizerViewForView:(UIView*)view action:(DTXRecordedAction*)action systemImageNames:(NSArray<NSString*>*)systemImageNames imageViewTransforms:(NSArray<NSValue* /*CGAffineTransform*/>*)transforms applyConstraints:(BOOL)applyConstraints
 {
-	if(NSUserDefaults.standardUserDefaults.dtxrec_disableVisualizations)
+	if(DTXRecorderSettingsCurrent->disableVisualizations)
 	{
 		return nil;
 	}
 	
-	_DTXVisualizedView* visualizer = [_DTXVisualizedView new];
+	DTX_SIGNPOST_INTERVAL("Visualizer Construction");
+	
+	_DTXVisualizedView* visualizer = [self _dequeueVisualizerView];
 	
 	UIColor* color;
 	
@@ -410,18 +1048,19 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 	visualizer.layer.cornerRadius = MIN(8, MIN(visualizer.frame.size.width, visualizer.frame.size.height) / 2);
 	visualizer.layer.borderWidth = 2.0;
 	visualizer.layer.borderColor = color.CGColor;
+	visualizer.fillsImageViews = applyConstraints;
 	[captureControlWindow.rootViewController.view addSubview:visualizer];
 	
+	NSArray<UIImageView*>* reusableImageViews = visualizer.imageViews;
 	NSMutableArray<UIImageView*>* imageViews = [NSMutableArray new];
 	[systemImageNames enumerateObjectsUsingBlock:^(NSString * _Nonnull systemImageName, NSUInteger idx, BOOL * _Nonnull stop) {
 		CGFloat minImageSize = MIN(30, MIN(CGRectGetWidth(frame) * 0.75, CGRectGetHeight(frame) * 0.75));
 		
-		UIImage* image = [UIImage systemImageNamed:systemImageName withConfiguration:[UIImageSymbolConfiguration configurationWithPointSize:MAX(minImageSize, MIN(CGRectGetWidth(frame) * 0.45, CGRectGetHeight(frame) * 0.45)) weight:UIImageSymbolWeightMedium]];
-		UIImageView* imageView = [[UIImageView alloc] initWithImage:image];
-		if(applyConstraints)
-		{
-			imageView.translatesAutoresizingMaskIntoConstraints = NO;
-		}
+		UIImage* image = DTXCachedSystemImage(systemImageName, MAX(minImageSize, MIN(CGRectGetWidth(frame) * 0.45, CGRectGetHeight(frame) * 0.45)));
+		UIImageView* imageView = idx < reusableImageViews.count ? reusableImageViews[idx] : [UIImageView new];
+		imageView.transform = CGAffineTransformIdentity;
+		imageView.image = image;
+		imageView.frame = (CGRect){CGPointZero, image.size};
 		imageView.tintColor = UIColor.whiteColor;
 		imageView.transform = transforms[idx].CGAffineTransformValue;
 		
@@ -436,27 +1075,85 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 		
 		[visualizer addSubview:imageView];
 		
-		if(applyConstraints)
-		{
-			[NSLayoutConstraint activateConstraints:@[
-				[imageView.topAnchor constraintEqualToAnchor:visualizer.topAnchor],
-				[imageView.bottomAnchor constraintEqualToAnchor:visualizer.bottomAnchor],
-				[imageView.leadingAnchor constraintEqualToAnchor:visualizer.leadingAnchor],
-				[imageView.trailingAnchor constraintEqualToAnchor:visualizer.trailingAnchor],
-			]];
-		}
-		
 		[imageViews addObject:imageView];
 	}];
 	
-	if(imageViews.count > 0)
+	for(NSUInteger idx = imageViews.count; idx < reusableImageViews.count; idx++)
 	{
-		visualizer.imageViews = imageViews;
+		[reusableImageViews[idx] removeFromSuperview];
 	}
 	
+	visualizer.imageViews = imageViews.count > 0 ? imageViews : nil;
+	[visualizer setNeedsLayout];
+	
 	return visualizer;
 }
 
++ (_DTXVisualizedView*)_dequeueVisualizerView
+{
+	_DTXVisualizedView* rv = _visualizerPool.lastObject;
+	if(rv == nil)
+	{
+		rv = [_DTXVisualizedView new];
+	}
+	else
+	{
+		[_visualizerPool removeLastObject];
+		[rv.layer removeAllAnimations];
+		rv.hidden = NO;
+		rv.transform = CGAffineTransformIdentity;
+		rv.clipsToBounds = NO;
+	}
+	
+	rv.reuseToken += 1;
+	rv.active = YES;
+	[DTXVisualizationScheduler visualizationDidBegin];
+	//Ends once the visualizer is recycled; a visualizer is only ever in one animation at a time.
+	os_signpost_interval_begin(DTXRecorderSignpostLog(), os_signpost_id_make_with_pointer(DTXRecorderSignpostLog(), (__bridge void*)rv), "Visualizer Animation");
+	
+	return rv;
+}
+
++ (void (^)(BOOL finished))_recycleCompletionForVisualizerView:(UIView*)view
+{
+	if([view isKindOfClass:_DTXVisualizedView.class] == NO)
+	{
+		return ^ (BOOL finished) {
+			[view removeFromSuperview];
+		};
+	}
+	
+	_DTXVisualizedView* visualizer = (id)view;
+	NSUInteger reuseToken = visualizer.reuseToken;
+	
+	return ^ (BOOL finished) {
+		if(visualizer.reuseToken != reuseToken || [_visualizerPool containsObject:visualizer])
+		{
+			return;
+		}
+		
+		[visualizer removeFromSuperview];
+		visualizer.active = NO;
+		[DTXVisualizationScheduler visualizationDidEnd];
+		os_signpost_interval_end(DTXRecorderSignpostLog(), os_signpost_id_make_with_pointer(DTXRecorderSignpostLog(), (__bridge void*)visualizer), "Visualizer Animation");
+		
+		if(visualizer == previousTextChangeVisualizer)
+		{
+			previousTextChangeVisualizer = nil;
+		}
+		
+		if(_visualizerPool == nil)
+		{
+			_visualizerPool = [NSMutableArray new];
+		}
+		
+		if(_visualizerPool.count < DTXVisualizerPoolCapacity)
+		{
+			[_visualizerPool addObject:visualizer];
+		}
+	};
+}
+
 + (void)_blinkVisualizerView:(UIView*)view
 {
 	static const CGFloat initialAlpha = 1.0;
@@ -474,9 +1171,7 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 		[UIView addKeyframeWithRelativeStartTime:2.0 / 3.0 relativeDuration:1.0 animations:^{
 			view.alpha = 0.0;
 		}];
-	} completion:^(BOOL finished) {
-		[view removeFromSuperview];
-	}];
+	} completion:[self _recycleCompletionForVisualizerView:view]];
 }
 
 + (void)_flashVisualizerView:(UIView*)view
@@ -487,9 +1182,7 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 	}];
 	[UIView animateWithDuration:0.3 delay:0.0 options:0 animations:^{
 		view.alpha = 0.0;
-	} completion:^(BOOL finished) {
-		[view removeFromSuperview];
-	}];
+	} completion:[self _recycleCompletionForVisualizerView:view]];
 }
 
 + (void)_slowFlashVisualizerView:(UIView*)view
@@ -500,9 +1193,7 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 	}];
 	[UIView animateWithDuration:0.8 delay:0.0 options:0 animations:^{
 		view.alpha = 0.0;
-	} completion:^(BOOL finished) {
-		[view removeFromSuperview];
-	}];
+	} completion:[self _recycleCompletionForVisualizerView:view]];
 }
 
 + (void)_animateScrollVisualizerView:(_DTXVisualizedView*)view direction:(CGPoint)dir
@@ -547,16 +1238,12 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 			view.alpha = 0.0;
 			[view layoutIfNeeded];
 		}];
-	} completion:^(BOOL finished) {
-		[view removeFromSuperview];
-	}];
+	} completion:[self _recycleCompletionForVisualizerView:view]];
 }
 
 + (void)_systemDeleteVisualizerView:(UIView*)view
 {
-	[UIView performSystemAnimation:UISystemAnimationDelete onViews:@[view] options:UIViewAnimationOptionBeginFromCurrentState animations:nil completion:^(BOOL finished) {
-		[view removeFromSuperview];
-	}];
+	[UIView performSystemAnimation:UISystemAnimationDelete onViews:@[view] options:UIViewAnimationOptionBeginFromCurrentState animations:nil completion:[self _recycleCompletionForVisualizerView:view]];
 }
 
 + (void)_visualizeTapAtView:(UIView*)view withAction:(DTXRecordedAction*)action
@@ -601,7 +1288,9 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 		DTXAddAction(action);
 //		NSLog(@"📣 Tapped control: %@", control.class);
 		
-		[self _visualizeTapAtView:view withAction:action];
+		[DTXVisualizationScheduler scheduleVisualizationForView:view block:^{
+			[self _visualizeTapAtView:view withAction:action];
+		}];
 	}
 }
 
@@ -637,7 +1326,7 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 		return;
 	}
 	
-	[self addLongPressWithView:touch.view duration:NSUserDefaults.standardUserDefaults.dtxrec_rnLongPressDelay withEvent:event];
+	[self addLongPressWithView:touch.view duration:DTXRecorderSettingsCurrent->rnLongPressDelay withEvent:event];
 }
 
 + (void)addLongPressWithView:(UIView*)view duration:(NSTimeInterval)duration withEvent:(UIEvent*)event
@@ -649,7 +1338,9 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 	{
 		DTXAddAction(action);
 		
-		[self _visualizeLongPressAtView:view withAction:action];
+		[DTXVisualizationScheduler scheduleVisualizationForView:view block:^{
+			[self _visualizeLongPressAtView:view withAction:action];
+		}];
 	}
 }
 
@@ -667,7 +1358,7 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 			return NO;
 		}
 		
-		if(NSUserDefaults.standardUserDefaults.dtxrec_convertScrollEventsToWaitfor == NO)
+		if(DTXRecorderSettingsCurrent->convertScrollEventsToWaitfor == NO)
 		{
 			return NO;
 		}
@@ -678,27 +1369,56 @@ static void _traverseElementMatchersAndFill(DTXRecordedElement* element, BOOL* a
 
 + (BOOL)_coalesceScrollViewEvent:(UIScrollView*)scrollView fromDeltaOriginOffset:(CGPoint)deltaOriginOffset toNewOffset:(CGPoint)newOffset
 {
-	return DTXUpdateAction(^BOOL(DTXRecordedAction *prevAction, BOOL* remove) {
-		if(NSUserDefaults.standardUserDefaults.dtxrec_coalesceScrollEvents == NO)
-		{
-			return NO;
-		}
-		
-		if(prevAction.allowsUpdates == NO || prevAction.actionType != DTXRecordedActionTypeScroll || [prevAction.element isReferencingView:scrollView] == NO)
-		{
-			return NO;
-		}
-		
-		if([prevAction updateScrollActionWithScrollView:scrollView fromDeltaOriginOffset:deltaOriginOffset toNewOffset:newOffset] == NO)
-		{
-			//The coalescing operation resulted in zero change, so remove the entire scroll action.
-			*remove = YES;
-			
-			return YES;
-		}
-		
-		return YES;
-	});
+	NSUInteger idx = [openScrollActions indexOfObjectPassingTest:^BOOL(DTXRecordedAction * _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
+		return [obj.element isReferencingView:scrollView];
+	}];
+	
+	if(idx == NSNotFound)
+	{
+		return NO;
+	}
+	
+	DTXRecorderCounterAdd(DTXRecorderCounterCoalescedScrolls, 1);
+	
+	DTXRecordedAction* openAction = openScrollActions[idx];
+	if([openAction updateScrollActionWithScrollView:scrollView fromDeltaOriginOffset:deltaOriginOffset toNewOffset:newOffset] == NO)
+	{
+		//The coalescing operation resulted in zero change, so drop the entire scroll action.
+		[openScrollActions removeObjectAtIndex:idx];
+	}
+	
+	//A continuous scroll of the same view keeps its action open for as long as it goes on.
+	[self _restartOpenScrollActionsTimer];
+	
+	return YES;
+}
+
++ (void)_restartOpenScrollActionsTimer
+{
+	//Once scrolling settles, open actions are committed so that the output stays current.
+	[openScrollActionsTimer invalidate];
+	openScrollActionsTimer = [NSTimer scheduledTimerWithTimeInterval:DTXOpenScrollActionsWindow repeats:NO block:^(NSTimer * _Nonnull timer) {
+		DTXCommitOpenScrollActions();
+	}];
+}
+
++ (void)_openScrollAction:(DTXRecordedAction*)action
+{
+	if(openScrollActions == nil)
+	{
+		openScrollActions = [NSMutableArray new];
+	}
+	
+	[openScrollActions addObject:action];
+	
+	if(openScrollActions.count > DTXMaxOpenScrollActions)
+	{
+		DTXRecordedAction* oldest = openScrollActions.firstObject;
+		[openScrollActions removeObjectAtIndex:0];
+		DTXAddAction(oldest);
+	}
+	
+	[self _restartOpenScrollActionsTimer];
 }
 
 + (void)addScrollEvent:(UIScrollView*)scrollView fromOriginOffset:(CGPoint)originOffset withEvent:(UIEvent *)event
@@ -768,19 +1488,32 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	
 	if(action.isCancelled)
 	{
-		[self _visualizeScrollCancelOfView:scrollView action:action];
+		[DTXVisualizationScheduler scheduleVisualizationForView:scrollView block:^{
+			[self _visualizeScrollCancelOfView:scrollView action:action];
+		}];
 		
 		return;
 	}
 	
-	[self _visualizeScrollOfView:scrollView action:action];
+	[DTXVisualizationScheduler scheduleVisualizationForView:scrollView block:^{
+		[self _visualizeScrollOfView:scrollView action:action];
+	}];
+	
+	if(DTXRecorderSettingsCurrent->coalesceScrollEvents == NO)
+	{
+		DTXAddAction(action);
+		return;
+	}
+	
+	//Keeps a debounced text change ahead of the scroll, which may stay open for a while.
+	[UIInputCapture flushPendingTextChange];
 	
 	if([self _coalesceScrollViewEvent:scrollView fromDeltaOriginOffset:originOffset toNewOffset:newOffset] == YES)
 	{
 		return;
 	}
 	
-	DTXAddAction(action);
+	[self _openScrollAction:action];
 }
 
 + (void)addDatePickerDateChangeEvent:(UIDatePicker*)datePicker withEvent:(UIEvent*)event
@@ -792,7 +1525,9 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	{
 		DTXAddAction(action);
 		
-		[self _visualizeDatePickerChangeDate:datePicker withAction:action];
+		[DTXVisualizationScheduler scheduleVisualizationForView:datePicker block:^{
+			[self _visualizeDatePickerChangeDate:datePicker withAction:action];
+		}];
 	}
 }
 
@@ -819,7 +1554,9 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	{
 		DTXAddAction(action);
 
-		[self _visualizePickerValueChangeAtView:pickerView component:component withAction:action];
+		[DTXVisualizationScheduler scheduleVisualizationForView:pickerView block:^{
+			[self _visualizePickerValueChangeAtView:pickerView component:component withAction:action];
+		}];
 	}
 }
 
@@ -839,7 +1576,9 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	{
 		DTXAddAction(action);
 
-		[self _visualizeSliderAdjust:slider withAction:action];
+		[DTXVisualizationScheduler scheduleVisualizationForView:slider block:^{
+			[self _visualizeSliderAdjust:slider withAction:action];
+		}];
 	}
 }
 
@@ -849,30 +1588,39 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	
 	DTXRecordedAction* action = [DTXRecordedAction scrollToTopActionWithView:scrollView event:event];
 	dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)([[scrollView valueForKeyPath:@"animation.duration"] doubleValue] * 0.5 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
-		[self _visualizeScrollToTopOfView:scrollView action:action];
+		[DTXVisualizationScheduler scheduleVisualizationForView:scrollView block:^{
+			[self _visualizeScrollToTopOfView:scrollView action:action];
+		}];
 	});
 	
 	DTXAddAction(action);
 }
 
-+ (void)_visualizeTextChangeOfView:(UIView*)view action:(DTXRecordedAction*)action
++ (void)_flashTextChangeVisualizerForView:(UIView*)view action:(DTXRecordedAction*)action systemImageName:(NSString*)systemImageName
 {
-	if(previousTextChangeVisualizer == nil || previousTextChangeVisualizer.superview == nil)
+	_DTXVisualizedView* visualizer = previousTextChangeVisualizer;
+	if(visualizer.isActive && visualizer.superview != nil)
+	{
+		//The flash below replaces the running one, so only its completion may recycle the visualizer.
+		visualizer.reuseToken += 1;
+	}
+	else
 	{
-		previousTextChangeVisualizer = [self _visualizerViewForView:view action:action systemImageName:@"text.cursor"];
+		visualizer = [self _visualizerViewForView:view action:action systemImageName:systemImageName];
+		previousTextChangeVisualizer = visualizer;
 	}
 	
-	[self _flashVisualizerView:previousTextChangeVisualizer];
+	[self _flashVisualizerView:visualizer];
+}
+
++ (void)_visualizeTextChangeOfView:(UIView*)view action:(DTXRecordedAction*)action
+{
+	[self _flashTextChangeVisualizerForView:view action:action systemImageName:@"text.cursor"];
 }
 
 + (void)_visualizeReturnTapInView:(UIView*)view action:(DTXRecordedAction*)action
 {
-	if(previousTextChangeVisualizer == nil || previousTextChangeVisualizer.superview == nil)
-	{
-		previousTextChangeVisualizer = [self _visualizerViewForView:view action:action systemImageName:@"return"];
-	}
-	
-	[self _flashVisualizerView:previousTextChangeVisualizer];
+	[self _flashTextChangeVisualizerForView:view action:action systemImageName:@"return"];
 }
 
 + (void)addTextChangeEvent:(UIView<UITextInput>*)textInput
@@ -880,6 +1628,41 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	IGNORE_RECORDING_WINDOW(textInput)
 	
 	NSString* text = [textInput textInRange:[textInput textRangeFromPosition:textInput.beginningOfDocument toPosition:textInput.endOfDocument]];
+	[self addTextChangeEvent:textInput text:text];
+}
+
++ (void)addTextChangeEvent:(UIView<UITextInput>*)textInput text:(NSString*)text
+{
+	IGNORE_RECORDING_WINDOW(textInput)
+	
+	//Successive typing pauses in the same field replace the last recorded text, rather than adding an action each.
+	__block BOOL isSameField = NO;
+	__block DTXRecordedAction* updatedAction = nil;
+	BOOL updated = DTXUpdateAction(^BOOL(DTXRecordedAction *action, BOOL *remove) {
+		if([action isKindOfClass:_DTXReplaceTextAction.class] == NO)
+		{
+			return NO;
+		}
+		
+		_DTXReplaceTextAction* replaceTextAction = (id)action;
+		isSameField = [replaceTextAction isReplacingTextOfView:textInput];
+		updatedAction = action;
+		return isSameField && [replaceTextAction updateText:text];
+	});
+	
+	if(isSameField)
+	{
+		if(updated)
+		{
+			//The scheduler runs the block later, when the last recorded action may be another one.
+			[DTXVisualizationScheduler scheduleVisualizationForView:textInput block:^{
+				[self _visualizeTextChangeOfView:textInput action:updatedAction];
+			}];
+		}
+		
+		return;
+	}
+	
 	DTXRecordedAction* action = [DTXRecordedAction replaceTextActionWithView:textInput text:text event:nil];
 	if(action == nil)
 	{
@@ -887,7 +1670,9 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	}
 	
 	DTXAddAction(action);
-	[self _visualizeTextChangeOfView:textInput action:action];
+	[DTXVisualizationScheduler scheduleVisualizationForView:textInput block:^{
+		[self _visualizeTextChangeOfView:textInput action:action];
+	}];
 }
 
 + (void)addTextReturnKeyEvent:(UIView<UITextInput>*)textInput
@@ -901,7 +1686,9 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	}
 	
 	DTXAddAction(action);
-	[self _visualizeReturnTapInView:textInput action:action];
+	[DTXVisualizationScheduler scheduleVisualizationForView:textInput block:^{
+		[self _visualizeReturnTapInView:textInput action:action];
+	}];
 }
 
 + (void)addDeviceShake
@@ -917,7 +1704,27 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 
 + (void)addTakeScreenshotWithName:(NSString*)screenshotName
 {
-	DTXAddAction([DTXRecordedAction takeScreenshotActionWithName:screenshotName]);
+	DTXRecordedAction* action = [DTXRecordedAction takeScreenshotActionWithName:screenshotName];
+	DTXAddAction(action);
+	
+	//Captured before the flash is shown; it is drawn in the capture control window, which is never included.
+	if(_referenceScreenshotWriter != nil)
+	{
+		//The keyboard of the screenshot name prompt is not part of the app's state.
+		BOOL isPrompting = captureControlWindow.rootViewController.presentedViewController != nil;
+		NSArray<UIWindow*>* windows = [UIWindow.dtxrec_allKeyWindowSceneWindows filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(UIWindow* window, NSDictionary* bindings) {
+			if(window == captureControlWindow)
+			{
+				return NO;
+			}
+			
+			NSString* className = NSStringFromClass(window.class);
+			return isPrompting == NO || ([className hasSuffix:@"KeyboardWindow"] == NO && [className isEqualToString:@"UITextEffectsWindow"] == NO);
+		}]];
+		
+		[_referenceScreenshotWriter captureWindows:windows name:action.actionArgs.firstObject];
+	}
+	
 	[captureControlWindow visualizeTakeScreenshotWithName:screenshotName];
 }
 
@@ -929,7 +1736,7 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 
 + (void)_sendPing
 {
-	DTXSendCommand(@{@"type": @"ping"});
+	DTXSendCommand(DTXRecordingCommandTypePing, nil);
 }
 
 + (BOOL)_hasRecordedActions
@@ -941,7 +1748,7 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 	}
 #endif
 	
-	return recordedActions.count > 0;
+	return recordedActionCount > 0 || openScrollActions.count > 0;
 }
 
 #pragma mark NSNetServiceDelegate
@@ -957,16 +1764,42 @@ static inline CGPoint DTXDirectionOfScroll(DTXRecordedAction* action)
 {
 	dtx_log_info(@"Resolved recording service: %@", sender);
 	
-	_currentConnection = [[DTXSocketConnection alloc] initWithHostName:sender.hostName port:sender.port delegateQueue:nil];
+	[self _startSessionWithConnection:[[DTXSocketConnection alloc] initWithHostName:sender.hostName port:sender.port delegateQueue:nil]];
+}
+
++ (void)_startSessionWithConnection:(DTXSocketConnection*)connection
+{
+	_usesCompactWireFormat = [NSUserDefaults.standardUserDefaults integerForKey:@"DTXRecWireFormatVersion"] >= DTXRecordingWireFormatVersion;
+	
+	NSUInteger outboundCommandLimit = MAX([NSUserDefaults.standardUserDefaults integerForKey:@"DTXRecSendQueueLimit"], 0);
+	DTXSendOverflowPolicy overflowPolicy = [[NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecSendOverflowPolicy"] isEqualToString:@"discard"] ? DTXSendOverflowPolicyDiscard : DTXSendOverflowPolicyDisconnect;
+	dispatch_async(DTXRecorderQueue(), ^{
+		DTXResetOutboundCommands(outboundCommandLimit, overflowPolicy);
+	});
+	
+	_currentConnection = connection;
 	_currentConnection.delegate = (id)self;
 	[_currentConnection open];
 	
-	__block dispatch_source_t pingTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _currentConnection.delegateQueue);
+	__block dispatch_source_t pingTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, DTXRecorderQueue());
 	_pingTimer = pingTimer;
-	int64_t interval = 0.25 * NSEC_PER_SEC;
-	dispatch_source_set_timer(_pingTimer, dispatch_time(DISPATCH_TIME_NOW, 0), interval, 0);
+	_keepAliveIdleInterval = [NSUserDefaults.standardUserDefaults doubleForKey:@"DTXRecKeepAliveInterval"];
+	if(_keepAliveIdleInterval <= 0)
+	{
+		_keepAliveIdleInterval = 1.0;
+	}
+	
+	int64_t interval = _keepAliveIdleInterval * NSEC_PER_SEC;
+	//Generous leeway lets the system coalesce the wakeups with other timers.
+	dispatch_source_set_timer(_pingTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 4);
 	
 	dispatch_source_set_event_handler(_pingTimer, ^ {
+		//Real traffic already proves the peer is alive; a failed send still ends the recording.
+		if(clock_gettime_nsec_np(CLOCK_UPTIME_RAW) < _lastSendTime + interval)
+		{
+			return;
+		}
+		
 		[DTXUIInteractionRecorder _sendPing];
 	});
 	
@@ -0,0 +1,25 @@
+//
+//  DTXVisualizationScheduler.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Runs recorder overlays on display frames, so that bursts of events never cost the app under test its frame rate.
+@interface DTXVisualizationScheduler : NSObject
+
+/// Schedules an overlay for the next frame. A pending overlay for the same view is replaced.
++ (void)scheduleVisualizationForView:(nullable UIView*)view block:(dispatch_block_t)block;
++ (void)cancelPendingVisualizations;
+
++ (void)visualizationDidBegin;
++ (void)visualizationDidEnd;
+
+@end
+
+NS_ASSUME_NONNULL_END
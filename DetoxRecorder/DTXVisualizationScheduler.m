@@ -0,0 +1,151 @@
+//
+//  DTXVisualizationScheduler.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXVisualizationScheduler.h"
+
+@interface _DTXPendingVisualization : NSObject
+
+@property (nonatomic, weak) UIView* view;
+@property (nonatomic, copy) dispatch_block_t block;
+
+@end
+@implementation _DTXPendingVisualization @end
+
+@interface DTXVisualizationScheduler ()
+
++ (void)_displayLinkDidFire:(CADisplayLink*)displayLink;
+
+@end
+
+static const NSUInteger DTXMaxConcurrentVisualizations = 6;
+//Frames taking longer than this multiple of the expected duration drop pending overlays
+static const CFTimeInterval DTXFrameBudgetMultiplier = 1.5;
+
+static CADisplayLink* _displayLink;
+static CFTimeInterval _lastFrameTimestamp;
+static NSMutableArray<_DTXPendingVisualization*>* _pendingVisualizations;
+static NSUInteger _activeVisualizations;
+
+//The display link only runs while an overlay can be dequeued, so a full set of active overlays never wakes the app every frame.
+DTX_ALWAYS_INLINE
+static BOOL _DTXCanDequeueVisualization(void)
+{
+	return _pendingVisualizations.count > 0 && _activeVisualizations < DTXMaxConcurrentVisualizations;
+}
+
+static void _DTXUpdateDisplayLink(void)
+{
+	if(_DTXCanDequeueVisualization() == NO)
+	{
+		_displayLink.paused = YES;
+		return;
+	}
+	
+	if(_displayLink == nil)
+	{
+		_displayLink = [CADisplayLink displayLinkWithTarget:DTXVisualizationScheduler.class selector:@selector(_displayLinkDidFire:)];
+		_displayLink.paused = YES;
+		[_displayLink addToRunLoop:NSRunLoop.mainRunLoop forMode:NSRunLoopCommonModes];
+	}
+	
+	if(_displayLink.paused)
+	{
+		_lastFrameTimestamp = 0;
+		_displayLink.paused = NO;
+	}
+}
+
+DTX_DIRECT_MEMBERS
+@implementation DTXVisualizationScheduler
+
++ (void)scheduleVisualizationForView:(UIView*)view block:(dispatch_block_t)block
+{
+	if(DTXRecorderSettingsCurrent->disableVisualizations)
+	{
+		return;
+	}
+	
+	if(_pendingVisualizations == nil)
+	{
+		_pendingVisualizations = [NSMutableArray new];
+	}
+	
+	if(view != nil)
+	{
+		//A newer event for the same view supersedes its pending overlay
+		NSUInteger idx = [_pendingVisualizations indexOfObjectPassingTest:^BOOL(_DTXPendingVisualization * _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
+			return obj.view == view;
+		}];
+		if(idx != NSNotFound)
+		{
+			[_pendingVisualizations removeObjectAtIndex:idx];
+		}
+	}
+	
+	_DTXPendingVisualization* pending = [_DTXPendingVisualization new];
+	pending.view = view;
+	pending.block = block;
+	[_pendingVisualizations addObject:pending];
+	
+	//Overlays that cannot run soon are stale by the time they would
+	if(_pendingVisualizations.count > DTXMaxConcurrentVisualizations)
+	{
+		[_pendingVisualizations removeObjectAtIndex:0];
+	}
+	
+	_DTXUpdateDisplayLink();
+}
+
++ (void)cancelPendingVisualizations
+{
+	[_pendingVisualizations removeAllObjects];
+	_displayLink.paused = YES;
+}
+
++ (void)visualizationDidBegin
+{
+	_activeVisualizations++;
+}
+
++ (void)visualizationDidEnd
+{
+	if(_activeVisualizations > 0)
+	{
+		_activeVisualizations--;
+	}
+	
+	//A freed slot may be what pending overlays were waiting for.
+	_DTXUpdateDisplayLink();
+}
+
++ (void)_displayLinkDidFire:(CADisplayLink*)displayLink
+{
+	CFTimeInterval expectedFrameDuration = displayLink.targetTimestamp - displayLink.timestamp;
+	CFTimeInterval frameDuration = _lastFrameTimestamp > 0 ? displayLink.timestamp - _lastFrameTimestamp : 0;
+	_lastFrameTimestamp = displayLink.timestamp;
+	
+	if(expectedFrameDuration > 0 && frameDuration > expectedFrameDuration * DTXFrameBudgetMultiplier)
+	{
+		//The app is already missing frames; do not add to its load.
+		[self cancelPendingVisualizations];
+		return;
+	}
+	
+	//One overlay per frame keeps its setup cost within budget
+	if(_DTXCanDequeueVisualization())
+	{
+		_DTXPendingVisualization* pending = _pendingVisualizations.firstObject;
+		[_pendingVisualizations removeObjectAtIndex:0];
+		
+		pending.block();
+	}
+	
+	_DTXUpdateDisplayLink();
+}
+
+@end
@@ -0,0 +1,192 @@
+//
+//  ActionFolding.swift
+//  DetoxRecorderCLI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+import Foundation
+
+/// Shortens recorded tests by folding repeated actions, without changing what the test does or in which order:
+/// consecutive repeats of a short sequence become a `for` loop, and longer sequences recurring anywhere in the test
+/// become async helper functions, declared in the suite and awaited in place.
+/// Statements are compared as written, so only identical commands are ever folded.
+struct ActionFolding {
+	/// Longest sequence considered for loops; bounded, so loop detection stays linear in the number of actions.
+	static let maxLoopPeriod = 8
+	/// Helpers are only extracted for sequences within this range.
+	static let maxHelperLength = 16
+	static let minHelperLength = 3
+	/// Bounds the number of extraction passes; a test needing more helpers than this is rarely made shorter by them.
+	static let maxHelpers = 32
+	
+	fileprivate(set) var helpers: [(name: String, body: [String])] = []
+	/// Each statement is one or more unindented lines.
+	fileprivate(set) var statements: [String]
+	
+	init(actions: [String]) {
+		//Actions may span several lines.
+		let normalized = actions.map { action in
+			action.components(separatedBy: "\n").map { $0.trimmingCharacters(in: CharacterSet(charactersIn: "\t")) }.joined(separator: "\n")
+		}
+		
+		statements = ActionFolding.foldingLoops(normalized)
+		extractHelpers()
+	}
+	
+	fileprivate static func indented(_ statement: String, depth: Int) -> String {
+		let indentation = String(repeating: "\t", count: depth)
+		return statement.components(separatedBy: "\n").map { indentation + $0 }.joined(separator: "\n")
+	}
+	
+	fileprivate static func foldingLoops(_ statements: [String]) -> [String] {
+		var rv: [String] = []
+		var idx = 0
+		while idx < statements.count {
+			var best: (period: Int, count: Int, saving: Int) = (0, 0, 0)
+			
+			let maxPeriod = min(maxLoopPeriod, (statements.count - idx) / 2)
+			if maxPeriod >= 1 {
+				for period in 1...maxPeriod {
+					var count = 1
+					while idx + (count + 1) * period <= statements.count && statements[(idx + count * period)..<(idx + (count + 1) * period)].elementsEqual(statements[idx..<(idx + period)]) {
+						count += 1
+					}
+					
+					//The loop's opening and closing lines are the cost of folding.
+					let saving = period * (count - 1) - 2
+					if count >= 2 && saving > best.saving {
+						best = (period, count, saving)
+					}
+				}
+			}
+			
+			guard best.saving > 0 else {
+				rv.append(statements[idx])
+				idx += 1
+				continue
+			}
+			
+			let body = statements[idx..<(idx + best.period)].map { indented($0, depth: 1) }.joined(separator: "\n")
+			rv.append("for (let i = 0; i < \(best.count); i++) {\n\(body)\n}")
+			idx += best.period * best.count
+		}
+		
+		return rv
+	}
+	
+	/// Non-overlapping occurrences of the sequence of `length` statements starting at each of `starts`, in order.
+	fileprivate func occurrences(_ starts: [Int], length: Int) -> [Int] {
+		var rv: [Int] = []
+		for start in starts where rv.last.map({ start >= $0 + length }) ?? true {
+			rv.append(start)
+		}
+		return rv
+	}
+	
+	/// Start indices of the windows of `length` symbols, grouped by content. Windows are hashed in a single rolling pass;
+	/// windows sharing a hash are compared, so collisions never group different sequences.
+	fileprivate static func windowGroups(_ symbols: [Int], length: Int) -> [[Int]] {
+		let base: UInt64 = 1_000_003
+		var highPower: UInt64 = 1
+		for _ in 1..<length {
+			highPower = highPower &* base
+		}
+		
+		var buckets: [UInt64: [[Int]]] = [:]
+		var hash: UInt64 = 0
+		for idx in 0..<symbols.count {
+			if idx >= length {
+				hash = hash &- UInt64(symbols[idx - length]) &* highPower
+			}
+			hash = hash &* base &+ UInt64(symbols[idx])
+			
+			let start = idx - length + 1
+			guard start >= 0 else {
+				continue
+			}
+			
+			var groups = buckets[hash, default: []]
+			if let groupIdx = groups.firstIndex(where: { symbols[$0[0]..<($0[0] + length)].elementsEqual(symbols[start..<(start + length)]) }) {
+				groups[groupIdx].append(start)
+			} else {
+				groups.append([start])
+			}
+			buckets[hash] = groups
+		}
+		
+		return buckets.values.flatMap { $0 }
+	}
+	
+	/// Each pass over the statements is expected linear time, and there are at most `maxHelperLength - minHelperLength + 1 + maxHelpers`
+	/// passes, so extraction is O(n) for a bounded number of helpers.
+	fileprivate mutating func extractHelpers() {
+		//Statements are compared as interned symbols, so windows hash and compare without touching the strings.
+		var symbolIds: [String: Int] = [:]
+		func symbol(_ statement: String) -> Int {
+			if let id = symbolIds[statement] {
+				return id
+			}
+			let id = symbolIds.count
+			symbolIds[statement] = id
+			return id
+		}
+		var symbols = statements.map { symbol($0) }
+		
+		for length in stride(from: ActionFolding.maxHelperLength, through: ActionFolding.minHelperLength, by: -1) {
+			while helpers.count < ActionFolding.maxHelpers && statements.count >= length * 2 {
+				var best: (starts: [Int], occurrences: [Int], saving: Int)? = nil
+				for starts in ActionFolding.windowGroups(symbols, length: length) where starts.count >= 2 {
+					let occurrences = self.occurrences(starts, length: length)
+					//Each occurrence shrinks to one call; the helper adds its body, its declaration lines and a blank line.
+					let saving = (length - 1) * occurrences.count - (length + 3)
+					guard saving > 0 else {
+						continue
+					}
+					
+					//Group order is arbitrary; ties go to the earliest sequence, so output is stable.
+					if best == nil || saving > best!.saving || (saving == best!.saving && occurrences[0] < best!.occurrences[0]) {
+						best = (starts, occurrences, saving)
+					}
+				}
+				
+				guard let helper = best else {
+					break
+				}
+				
+				let name = "recordedSteps\(helpers.count + 1)"
+				let body = Array(statements[helper.occurrences[0]..<(helper.occurrences[0] + length)])
+				helpers.append((name, body))
+				let call = "await \(name)();"
+				let callSymbol = symbol(call)
+				for start in helper.occurrences.reversed() {
+					statements.replaceSubrange(start..<(start + length), with: [call])
+					symbols.replaceSubrange(start..<(start + length), with: [callSymbol])
+				}
+			}
+		}
+	}
+	
+	/// The same suite layout as RecordingHandler writes, with helpers declared ahead of the test.
+	func generateTest(testName: String) -> String {
+		var rv = "describe('Recorded suite', () => {\n"
+		for helper in helpers {
+			rv += "\tasync function \(helper.name)() {\n"
+			rv += helper.body.map { ActionFolding.indented($0, depth: 2) + "\n" }.joined()
+			rv += "\t}\n\t\n"
+		}
+		rv += "\tit('\(testName)', async () => {\n"
+		rv += statements.map { ActionFolding.indented($0, depth: 2) + "\n" }.joined()
+		rv += "\t})\n});"
+		
+		return rv
+	}
+}
+
+extension RecordingEventLog {
+	/// Like `generateTest(testName:)`, with repeated actions folded.
+	func generateCompactTest(testName: String? = nil) -> String {
+		return ActionFolding(actions: actions.map { actionDescription($0) }).generateTest(testName: testName ?? self.testName)
+	}
+}
@@ -0,0 +1,112 @@
+//
+//  CLICache.swift
+//  DetoxRecorderCLI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+import Foundation
+
+/// Startup results that stay valid across runs, each stored with a stamp of the state it was derived from.
+struct CLICache {
+	fileprivate static let cacheDirectoryUrl: URL = {
+		let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first!
+		return caches.appendingPathComponent("com.wix.DetoxRecorderCLI", isDirectory: true)
+	}()
+	
+	fileprivate static let detoxConfigUrl = cacheDirectoryUrl.appendingPathComponent("DetoxConfig.plist", isDirectory: false)
+	fileprivate static let simulatorQueriesUrl = cacheDirectoryUrl.appendingPathComponent("SimulatorQueries.plist", isDirectory: false)
+	
+	fileprivate static let lock = NSLock()
+	
+	fileprivate static func fileStamp(_ url: URL) -> String? {
+		guard let attributes = try? FileManager.default.attributesOfItem(atPath: url.path),
+			  let modificationDate = attributes[.modificationDate] as? Date,
+			  let size = attributes[.size] as? NSNumber else {
+			return nil
+		}
+		
+		return "\(modificationDate.timeIntervalSince1970)|\(size)"
+	}
+	
+	fileprivate static func read(_ url: URL) -> [String: Any] {
+		lock.lock()
+		defer {
+			lock.unlock()
+		}
+		
+		return (NSDictionary(contentsOf: url) as? [String: Any]) ?? [:]
+	}
+	
+	fileprivate static func write(_ url: URL, _ update: (inout [String: Any]) -> Void) {
+		lock.lock()
+		defer {
+			lock.unlock()
+		}
+		
+		var cache = (NSDictionary(contentsOf: url) as? [String: Any]) ?? [:]
+		update(&cache)
+		try? FileManager.default.createDirectory(at: cacheDirectoryUrl, withIntermediateDirectories: true, attributes: nil)
+		(cache as NSDictionary).write(to: url, atomically: true)
+	}
+	
+	// MARK: Detox config
+	
+	/// In monorepos, package.json can be large; only its “detox” object is kept, as JSON, since it may contain nulls that property lists cannot hold.
+	static func cachedDetoxConfig(packageJsonUrl: URL) -> [String: Any]? {
+		let path = packageJsonUrl.standardized.path
+		guard let stamp = fileStamp(packageJsonUrl),
+			  let entry = read(detoxConfigUrl)[path] as? [String: Any],
+			  entry["stamp"] as? String == stamp,
+			  let data = entry["detox"] as? Data else {
+			return nil
+		}
+		
+		return (try? JSONSerialization.jsonObject(with: data, options: [])) as? [String: Any]
+	}
+	
+	static func storeDetoxConfig(_ detox: [String: Any], packageJsonUrl: URL) {
+		guard let stamp = fileStamp(packageJsonUrl), let data = try? JSONSerialization.data(withJSONObject: detox, options: []) else {
+			return
+		}
+		
+		write(detoxConfigUrl) { cache in
+			cache[packageJsonUrl.standardized.path] = ["stamp": stamp, "detox": data]
+		}
+	}
+	
+	// MARK: Simulator queries
+	
+	/// CoreSimulator rewrites the device set whenever a simulator is created, deleted or renamed, which is all that can change a query's result.
+	fileprivate static var deviceSetStamp: String? {
+		let devicesUrl = FileManager.default.homeDirectoryForCurrentUser.appendingPathComponent("Library/Developer/CoreSimulator/Devices", isDirectory: true)
+		guard let deviceSetStamp = fileStamp(devicesUrl.appendingPathComponent("device_set.plist")), let devicesStamp = fileStamp(devicesUrl) else {
+			return nil
+		}
+		
+		return "\(deviceSetStamp)|\(devicesStamp)"
+	}
+	
+	static func cachedSimulatorId(query: [String]) -> String? {
+		let cache = read(simulatorQueriesUrl)
+		guard let stamp = deviceSetStamp, cache["stamp"] as? String == stamp, let queries = cache["queries"] as? [String: String] else {
+			return nil
+		}
+		
+		return queries[query.joined(separator: " ")]
+	}
+	
+	static func storeSimulatorId(_ simulatorId: String, query: [String]) {
+		guard let stamp = deviceSetStamp else {
+			return
+		}
+		
+		write(simulatorQueriesUrl) { cache in
+			var queries = cache["stamp"] as? String == stamp ? (cache["queries"] as? [String: String]) ?? [:] : [:]
+			queries[query.joined(separator: " ")] = simulatorId
+			cache["stamp"] = stamp
+			cache["queries"] = queries
+		}
+	}
+}
@@ -0,0 +1,83 @@
+//
+//  LoopbackListener.swift
+//  DetoxRecorderCLI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+import Foundation
+
+/// Accepts recorder connections on the loopback interface, which simulators share with the host, so recording does not depend on Bonjour resolution.
+class LoopbackListener {
+	let port: UInt16
+	fileprivate let acceptSource: DispatchSourceRead
+	
+	/// Hands each accepted connection over as a pair of streams.
+	convenience init(acceptHandler: @escaping (InputStream, OutputStream) -> Void) throws {
+		try self.init(port: 0) { clientFd in
+			var readStream: Unmanaged<CFReadStream>? = nil
+			var writeStream: Unmanaged<CFWriteStream>? = nil
+			CFStreamCreatePairWithSocket(kCFAllocatorDefault, clientFd, &readStream, &writeStream)
+			guard let inputStream = readStream?.takeRetainedValue(), let outputStream = writeStream?.takeRetainedValue() else {
+				close(clientFd)
+				return
+			}
+			
+			CFReadStreamSetProperty(inputStream, CFStreamPropertyKey(kCFStreamPropertyShouldCloseNativeSocket), kCFBooleanTrue)
+			CFWriteStreamSetProperty(outputStream, CFStreamPropertyKey(kCFStreamPropertyShouldCloseNativeSocket), kCFBooleanTrue)
+			
+			acceptHandler(inputStream, outputStream)
+		}
+	}
+	
+	/// Listens on `port`, or on any available port when 0, and hands each accepted socket over; the handler owns the socket.
+	init(port requestedPort: UInt16, socketHandler: @escaping (Int32) -> Void) throws {
+		let fd = socket(AF_INET, SOCK_STREAM, 0)
+		guard fd >= 0 else {
+			throw "Unable to create a loopback socket: \(String(cString: strerror(errno)))"
+		}
+		
+		var reuse: Int32 = 1
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, socklen_t(MemoryLayout<Int32>.size))
+		
+		var addr = sockaddr_in()
+		addr.sin_len = UInt8(MemoryLayout<sockaddr_in>.size)
+		addr.sin_family = sa_family_t(AF_INET)
+		addr.sin_port = requestedPort.bigEndian
+		addr.sin_addr.s_addr = inet_addr("127.0.0.1")
+		var addrLength = socklen_t(MemoryLayout<sockaddr_in>.size)
+		
+		let bound = withUnsafeMutablePointer(to: &addr) {
+			$0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+				bind(fd, $0, addrLength) == 0 && getsockname(fd, $0, &addrLength) == 0
+			}
+		}
+		
+		guard bound, listen(fd, SOMAXCONN) == 0 else {
+			let message = String(cString: strerror(errno))
+			close(fd)
+			throw "Unable to listen on the loopback interface: \(message)"
+		}
+		
+		port = UInt16(bigEndian: addr.sin_port)
+		
+		acceptSource = DispatchSource.makeReadSource(fileDescriptor: fd, queue: .main)
+		acceptSource.setEventHandler {
+			let clientFd = accept(fd, nil, nil)
+			guard clientFd >= 0 else {
+				return
+			}
+			
+			socketHandler(clientFd)
+		}
+		acceptSource.setCancelHandler {
+			close(fd)
+		}
+		acceptSource.resume()
+	}
+	
+	deinit {
+		acceptSource.cancel()
+	}
+}
@@ -0,0 +1,280 @@
+//
+//  MachOInspector.swift
+//  DetoxRecorderCLI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+import Foundation
+
+/// Reads just enough of a Mach-O executable to tell whether Detox Recorder is already part of it,
+/// either as a linked framework or as defined symbols, stopping at the first match.
+struct MachOInspector {
+	fileprivate static let fatMagic: UInt32 = 0xcafebabe
+	fileprivate static let fatMagic64: UInt32 = 0xcafebabf
+	fileprivate static let machMagic64: UInt32 = 0xfeedfacf
+	
+	fileprivate static let loadCommandSymtab: UInt32 = 0x2
+	fileprivate static let loadCommandLoadDylib: UInt32 = 0xc
+	fileprivate static let loadCommandUUID: UInt32 = 0x1b
+	fileprivate static let loadCommandLazyLoadDylib: UInt32 = 0x20
+	fileprivate static let loadCommandLoadWeakDylib: UInt32 = 0x80000018
+	fileprivate static let loadCommandReexportDylib: UInt32 = 0x8000001f
+	
+	fileprivate static let symbolTypeMask: UInt8 = 0x0e
+	fileprivate static let symbolTypeUndefined: UInt8 = 0x0
+	fileprivate static let symbolTypeStab: UInt8 = 0xe0
+	
+	fileprivate static let linkedFrameworkMarker = Array("DetoxRecorder".utf8)
+	fileprivate static let symbolMarker = Array("DTXUIInteractionRecorder".utf8)
+	
+	struct Image {
+		let offset: Int
+		let uuid: UUID?
+		fileprivate let loadCommandsRange: Range<Int>
+		fileprivate let loadCommandCount: Int
+	}
+	
+	let data: Data
+	let images: [Image]
+	
+	init(url: URL) throws {
+		let data = try Data(contentsOf: url, options: .alwaysMapped)
+		
+		var imageOffsets: [Int] = []
+		let magic = data.readUInt32(at: 0, bigEndian: true)
+		if magic == MachOInspector.fatMagic || magic == MachOInspector.fatMagic64 {
+			//Fat headers are big endian
+			let is64 = magic == MachOInspector.fatMagic64
+			let count = Int(data.readUInt32(at: 4, bigEndian: true))
+			let archSize = is64 ? 32 : 20
+			for idx in 0..<count {
+				let archOffset = 8 + idx * archSize
+				let offset = is64 ? Int(data.readUInt64(at: archOffset + 8, bigEndian: true)) : Int(data.readUInt32(at: archOffset + 8, bigEndian: true))
+				imageOffsets.append(offset)
+			}
+		} else {
+			imageOffsets.append(0)
+		}
+		
+		images = try imageOffsets.map { offset in
+			guard data.readUInt32(at: offset) == MachOInspector.machMagic64 else {
+				throw "Unsupported Mach-O image"
+			}
+			
+			let commandCount = Int(data.readUInt32(at: offset + 16))
+			let commandsSize = Int(data.readUInt32(at: offset + 20))
+			//mach_header_64 is 32 bytes
+			let commandsStart = offset + 32
+			guard commandsStart + commandsSize <= data.count else {
+				throw "Truncated Mach-O image"
+			}
+			
+			let range = commandsStart..<(commandsStart + commandsSize)
+			var uuid: UUID? = nil
+			MachOInspector.enumerateLoadCommands(in: data, range: range, count: commandCount) { command, commandOffset, commandSize in
+				//uuid_command is 24 bytes
+				guard command == MachOInspector.loadCommandUUID, commandSize >= 24 else {
+					return false
+				}
+				
+				uuid = data.subdata(in: (commandOffset + 8)..<(commandOffset + 24)).withUnsafeBytes { UUID(uuid: $0.load(as: uuid_t.self)) }
+				return true
+			}
+			
+			return Image(offset: offset, uuid: uuid, loadCommandsRange: range, loadCommandCount: commandCount)
+		}
+		self.data = data
+	}
+	
+	/// Identifies the exact build, combining the UUIDs of all slices.
+	var buildIdentifier: String {
+		return images.map { $0.uuid?.uuidString ?? "" }.joined(separator: ",")
+	}
+	
+	/// Commands are only passed to `block` when they fit within `range`; enumeration stops at the first command that does not,
+	/// as there is no way to find the next one.
+	fileprivate static func enumerateLoadCommands(in data: Data, range: Range<Int>, count: Int, _ block: (_ command: UInt32, _ offset: Int, _ size: Int) -> Bool) {
+		var offset = range.lowerBound
+		for _ in 0..<count {
+			guard offset + 8 <= range.upperBound else {
+				return
+			}
+			
+			let command = data.readUInt32(at: offset)
+			let size = Int(data.readUInt32(at: offset + 4))
+			guard size >= 8, offset + size <= range.upperBound else {
+				return
+			}
+			
+			if block(command, offset, size) {
+				return
+			}
+			offset += size
+		}
+	}
+	
+	func containsDetoxRecorder() -> Bool {
+		for image in images {
+			var found = false
+			var symtabOffset: Int? = nil
+			MachOInspector.enumerateLoadCommands(in: data, range: image.loadCommandsRange, count: image.loadCommandCount) { command, offset, size in
+				switch command {
+				case MachOInspector.loadCommandLoadDylib, MachOInspector.loadCommandLoadWeakDylib, MachOInspector.loadCommandReexportDylib, MachOInspector.loadCommandLazyLoadDylib:
+					//dylib_command is 24 bytes; the name must lie within the command, which was already checked to be within the data.
+					guard size >= 24 else {
+						break
+					}
+					let nameOffset = Int(data.readUInt32(at: offset + 8))
+					guard nameOffset >= 24, nameOffset < size else {
+						break
+					}
+					found = data.range(of: Data(MachOInspector.linkedFrameworkMarker), in: (offset + nameOffset)..<(offset + size)) != nil
+				case MachOInspector.loadCommandSymtab:
+					//symtab_command is 24 bytes
+					if size >= 24 {
+						symtabOffset = offset
+					}
+				default:
+					break
+				}
+				return found
+			}
+			
+			if found || (symtabOffset != nil && containsDefinedRecorderSymbol(image: image, symtabCommandOffset: symtabOffset!)) {
+				return true
+			}
+		}
+		
+		return false
+	}
+	
+	/// Equivalent to searching `nm -U` output: only defined, non-debug symbols are considered.
+	fileprivate func containsDefinedRecorderSymbol(image: Image, symtabCommandOffset: Int) -> Bool {
+		let symbolsOffset = image.offset + Int(data.readUInt32(at: symtabCommandOffset + 8))
+		let symbolCount = Int(data.readUInt32(at: symtabCommandOffset + 12))
+		let stringsOffset = image.offset + Int(data.readUInt32(at: symtabCommandOffset + 16))
+		let stringsSize = Int(data.readUInt32(at: symtabCommandOffset + 20))
+		//nlist_64 is 16 bytes
+		guard symbolsOffset + symbolCount * 16 <= data.count, stringsOffset + stringsSize <= data.count else {
+			return false
+		}
+		
+		let marker = MachOInspector.symbolMarker
+		return data.withUnsafeBytes { (buffer: UnsafeRawBufferPointer) -> Bool in
+			let bytes = buffer.bindMemory(to: UInt8.self)
+			for idx in 0..<symbolCount {
+				let entry = symbolsOffset + idx * 16
+				let type = bytes[entry + 4]
+				guard type & MachOInspector.symbolTypeStab == 0, type & MachOInspector.symbolTypeMask != MachOInspector.symbolTypeUndefined else {
+					continue
+				}
+				
+				let stringIndex = Int(UInt32(bytes[entry]) | UInt32(bytes[entry + 1]) << 8 | UInt32(bytes[entry + 2]) << 16 | UInt32(bytes[entry + 3]) << 24)
+				guard stringIndex < stringsSize else {
+					continue
+				}
+				
+				var start = stringsOffset + stringIndex
+				let stringsEnd = stringsOffset + stringsSize
+				
+				//Symbol names are NUL terminated; look for the marker anywhere inside the name.
+				var matched = 0
+				while start < stringsEnd && bytes[start] != 0 {
+					if bytes[start] == marker[matched] {
+						matched += 1
+						if matched == marker.count {
+							return true
+						}
+					} else {
+						matched = bytes[start] == marker[0] ? 1 : 0
+					}
+					start += 1
+				}
+			}
+			
+			return false
+		}
+	}
+}
+
+extension Data {
+	func readUInt16(at offset: Int) -> UInt16 {
+		guard offset >= 0, offset + 2 <= count else {
+			return 0
+		}
+		
+		return withUnsafeBytes { buffer in
+			var value: UInt16 = 0
+			memcpy(&value, buffer.baseAddress! + offset, 2)
+			return UInt16(littleEndian: value)
+		}
+	}
+	
+	func readUInt32(at offset: Int, bigEndian: Bool = false) -> UInt32 {
+		guard offset >= 0, offset + 4 <= count else {
+			return 0
+		}
+		
+		return withUnsafeBytes { buffer in
+			var value: UInt32 = 0
+			memcpy(&value, buffer.baseAddress! + offset, 4)
+			return bigEndian ? UInt32(bigEndian: value) : UInt32(littleEndian: value)
+		}
+	}
+	
+	func readUInt64(at offset: Int, bigEndian: Bool = false) -> UInt64 {
+		guard offset >= 0, offset + 8 <= count else {
+			return 0
+		}
+		
+		return withUnsafeBytes { buffer in
+			var value: UInt64 = 0
+			memcpy(&value, buffer.baseAddress! + offset, 8)
+			return bigEndian ? UInt64(bigEndian: value) : UInt64(littleEndian: value)
+		}
+	}
+}
+
+/// Remembers detection results across runs, so repeated recordings of the same build skip inspection entirely.
+struct FrameworkInjectionCache {
+	fileprivate static let cacheUrl: URL = {
+		let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first!
+		return caches.appendingPathComponent("com.wix.DetoxRecorderCLI", isDirectory: true).appendingPathComponent("FrameworkInjection.plist", isDirectory: false)
+	}()
+	
+	//Parallel recordings may inspect at the same time.
+	fileprivate static let lock = NSLock()
+	
+	static func cachedContainsDetoxRecorder(_ url: URL) -> Bool? {
+		let path = url.standardized.path
+		guard let inspector = try? MachOInspector(url: url),
+			  let modificationDate = try? FileManager.default.attributesOfItem(atPath: path)[.modificationDate] as? Date else {
+			return nil
+		}
+		
+		let key = "\(path)|\(modificationDate.timeIntervalSince1970)|\(inspector.buildIdentifier)"
+		
+		lock.lock()
+		defer {
+			lock.unlock()
+		}
+		
+		var cache = (NSDictionary(contentsOf: cacheUrl) as? [String: Bool]) ?? [:]
+		if let cached = cache[key] {
+			log.info("Using cached framework injection detection result for \(path)")
+			return cached
+		}
+		
+		let rv = inspector.containsDetoxRecorder()
+		
+		//Only the latest result per executable path is kept.
+		cache = cache.filter { $0.key.hasPrefix("\(path)|") == false }
+		cache[key] = rv
+		try? FileManager.default.createDirectory(at: cacheUrl.deletingLastPathComponent(), withIntermediateDirectories: true, attributes: nil)
+		(cache as NSDictionary).write(to: cacheUrl, atomically: true)
+		
+		return rv
+	}
+}
@@ -0,0 +1,103 @@
+//
+//  MatcherRanking.swift
+//  DetoxRecorderCLI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+import Foundation
+
+/// Re-chooses element matchers after recording, using how ambiguous each candidate was on every screen it was seen on.
+/// While recording, matchers are picked greedily per event (id, then text, then label, then type); here, a candidate that is
+/// unique wherever it appears is preferred, which removes most `atIndex` calls.
+/// Elements with ancestors were matched within their ancestor, so they are ranked among those, and keep their ancestor,
+/// which is itself ranked as an element.
+struct MatcherRanking {
+	fileprivate struct Key: Hashable {
+		let type: String
+		let value: String
+		let withinAncestor: Bool
+	}
+	
+	fileprivate struct Statistics {
+		var occurrences = 0
+		var uniqueOccurrences = 0
+		
+		var stability: Double {
+			return occurrences > 0 ? Double(uniqueOccurrences) / Double(occurrences) : 0
+		}
+	}
+	
+	//The order used while recording breaks ties.
+	fileprivate static let precedence = ["by.id": 0, "by.text": 1, "by.label": 2]
+	
+	fileprivate var statistics: [Key: Statistics] = [:]
+	
+	init(eventLog: RecordingEventLog) {
+		//Every element record is a separate resolution, usually on a different screen.
+		for element in eventLog.elements.values {
+			for candidate in element.candidates where MatcherRanking.isRankable(candidate) {
+				let key = Key(type: candidate.type, value: candidate.value, withinAncestor: element.ancestor != nil)
+				statistics[key, default: Statistics()].occurrences += 1
+				if MatcherRanking.isUnique(candidate) {
+					statistics[key, default: Statistics()].uniqueOccurrences += 1
+				}
+			}
+		}
+	}
+	
+	/// By type candidates count views that also match the element's text or label, so they cannot stand alone.
+	fileprivate static func isRankable(_ candidate: RecordingEventLog.Matcher) -> Bool {
+		return candidate.matchCount != nil && precedence[candidate.type] != nil
+	}
+	
+	fileprivate static func isUnique(_ candidate: RecordingEventLog.Matcher) -> Bool {
+		return candidate.matchCount! <= 1
+	}
+	
+	fileprivate func stability(_ type: String, _ value: String, withinAncestor: Bool) -> Double {
+		return statistics[Key(type: type, value: value, withinAncestor: withinAncestor)]?.stability ?? 0
+	}
+	
+	func rankedElement(_ element: RecordingEventLog.Element) -> RecordingEventLog.Element {
+		//Forced type matchers (such as for bar buttons) are kept as recorded.
+		guard let recorded = element.matchers.first, MatcherRanking.precedence[recorded.type] != nil else {
+			return element
+		}
+		
+		let withinAncestor = element.ancestor != nil
+		let best = element.candidates.filter { MatcherRanking.isRankable($0) && MatcherRanking.isUnique($0) }.min { lhs, rhs in
+			let lhsStability = stability(lhs.type, lhs.value, withinAncestor: withinAncestor)
+			let rhsStability = stability(rhs.type, rhs.value, withinAncestor: withinAncestor)
+			if lhsStability != rhsStability {
+				return lhsStability > rhsStability
+			}
+			
+			return MatcherRanking.precedence[lhs.type]! < MatcherRanking.precedence[rhs.type]!
+		}
+		
+		guard let best = best else {
+			return element
+		}
+		
+		//An already unique matcher is only replaced by one that is unique more often across the session.
+		if element.atIndex == nil && stability(best.type, best.value, withinAncestor: withinAncestor) <= stability(recorded.type, recorded.value, withinAncestor: withinAncestor) {
+			return element
+		}
+		
+		let matcher = RecordingEventLog.Matcher(type: best.type, value: best.value, atIndex: nil, matchCount: nil)
+		return RecordingEventLog.Element(matchers: [matcher], candidates: element.candidates, ancestor: element.ancestor, atIndex: nil)
+	}
+}
+
+extension RecordingEventLog {
+	/// A copy of the log whose elements use the matchers chosen by ranking the whole session.
+	func rankingMatchers() -> RecordingEventLog {
+		let ranking = MatcherRanking(eventLog: self)
+		
+		var rv = self
+		rv.elements = elements.mapValues { ranking.rankedElement($0) }
+		return rv
+	}
+}
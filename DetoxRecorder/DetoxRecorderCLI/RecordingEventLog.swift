@@ -0,0 +1,312 @@
+//
+//  RecordingEventLog.swift
+//  DetoxRecorderCLI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+import Foundation
+
+/// Reads the binary event log written by the framework's DTXRecordingEventLog, and regenerates Detox tests from it offline.
+/// The format is documented in DTXRecordingEventLog.h.
+struct RecordingEventLog {
+	fileprivate static let magic = Array("DTXEVLOG".utf8)
+	//Version 3 added the Detox versions to the session.
+	fileprivate static let supportedVersion: UInt32 = 3
+	fileprivate static let headerSize = 24
+	
+	fileprivate enum RecordKind: UInt16 {
+		case session = 1
+		case string = 2
+		case element = 3
+		case action = 4
+	}
+	
+	fileprivate enum Operation: UInt32 {
+		case add = 1
+		case update = 2
+		case remove = 3
+	}
+	
+	/// Must match DTXRecordedActionVariant
+	enum Variant: UInt32 {
+		case `default` = 0
+		case tapReturnKey = 1
+		case scrollToVisible = 2
+		case codeComment = 3
+	}
+	
+	struct Matcher {
+		let type: String
+		let value: String
+		/// The index required to disambiguate the matched view, if any.
+		let atIndex: Int?
+		/// The number of views the candidate matched when recorded; `nil` for chosen matchers and version 1 logs.
+		let matchCount: Int?
+	}
+	
+	struct Element {
+		/// The matchers chosen while recording.
+		let matchers: [Matcher]
+		/// Every matcher considered while recording, including those not chosen.
+		let candidates: [Matcher]
+		let ancestor: UInt32?
+		let atIndex: Int?
+	}
+	
+	struct Action {
+		let variant: Variant
+		let actionType: String
+		let element: UInt32?
+		let args: [Any]
+		let secondaryElement: UInt32?
+		let secondaryArgs: [Any]
+		let date: Date
+	}
+	
+	fileprivate static let matcherTypes = [1: "by.id", 2: "by.type", 3: "by.label", 4: "by.text"]
+	
+	let testName: String
+	/// The Detox version the test was recorded for; empty for logs before version 3.
+	let detoxVersionCompatibility: String
+	/// The Detox versions the recorder supported, any of which the test can be generated for; empty for logs before version 3.
+	let supportedDetoxVersions: [String]
+	/// The Detox version tests are generated for; the recorded one, unless targeting another.
+	fileprivate(set) var detoxVersion: String
+	let startDate: Date
+	/// Replaced by matcher ranking before generating.
+	var elements: [UInt32: Element]
+	/// The recorded actions, with updates and removals already applied.
+	let actions: [Action]
+	
+	init(url: URL) throws {
+		let data = try Data(contentsOf: url, options: .alwaysMapped)
+		
+		guard data.count >= RecordingEventLog.headerSize, Array(data.prefix(8)) == RecordingEventLog.magic else {
+			throw "Not a Detox Recorder event log"
+		}
+		
+		let version = data.readUInt32(at: 8)
+		guard version <= RecordingEventLog.supportedVersion else {
+			throw "The event log was written by a newer version of Detox Recorder"
+		}
+		//Version 2 added match counts to matcher entries.
+		let matcherEntrySize = version >= 2 ? 16 : 12
+		
+		//Only records covered by the header's length are complete.
+		let end = min(data.count, RecordingEventLog.headerSize + Int(data.readUInt64(at: 16)))
+		
+		var strings: [UInt32: String] = [:]
+		var elements: [UInt32: Element] = [:]
+		var actions: [Action] = []
+		var testName = "My Recorded Test"
+		var detoxVersionCompatibility = ""
+		var supportedDetoxVersions: [String] = []
+		var startDate = Date(timeIntervalSince1970: 0)
+		
+		func optionalId(_ value: UInt32) -> UInt32? {
+			return value != 0 ? value : nil
+		}
+		
+		func optionalIndex(_ value: UInt32) -> Int? {
+			let index = Int32(bitPattern: value)
+			return index >= 0 ? Int(index) : nil
+		}
+		
+		func args(_ stringId: UInt32) throws -> [Any] {
+			guard stringId != 0, let string = strings[stringId] else {
+				return []
+			}
+			
+			guard let rv = try JSONSerialization.jsonObject(with: string.data(using: .utf8)!, options: []) as? [Any] else {
+				throw "Malformed action arguments"
+			}
+			
+			return rv
+		}
+		
+		var offset = RecordingEventLog.headerSize
+		while offset + 8 <= end {
+			let kind = data.readUInt16(at: offset)
+			let length = Int(data.readUInt32(at: offset + 4))
+			let payload = offset + 8
+			guard payload + length <= end else {
+				break
+			}
+			
+			switch RecordKind(rawValue: kind) {
+			case .session:
+				testName = strings[data.readUInt32(at: payload)] ?? testName
+				detoxVersionCompatibility = strings[data.readUInt32(at: payload + 4)] ?? detoxVersionCompatibility
+				if length >= 24 {
+					supportedDetoxVersions = try args(data.readUInt32(at: payload + 16)).compactMap { $0 as? String }
+				}
+				startDate = Date(timeIntervalSince1970: Double(bitPattern: data.readUInt64(at: payload + 8)))
+			case .string:
+				let id = data.readUInt32(at: payload)
+				strings[id] = String(decoding: data.subdata(in: (payload + 4)..<(payload + length)), as: UTF8.self)
+			case .element:
+				let id = data.readUInt32(at: payload)
+				let matcherCount = Int(data.readUInt16(at: payload + 12))
+				let candidateCount = Int(data.readUInt16(at: payload + 14))
+				
+				let entries: [Matcher] = (0..<(matcherCount + candidateCount)).compactMap { idx in
+					let entry = payload + 16 + idx * matcherEntrySize
+					guard let type = RecordingEventLog.matcherTypes[Int(data.readUInt32(at: entry))], let value = strings[data.readUInt32(at: entry + 4)] else {
+						return nil
+					}
+					let matchCount = idx >= matcherCount && matcherEntrySize >= 16 ? Int(data.readUInt32(at: entry + 12)) : nil
+					return Matcher(type: type, value: value, atIndex: optionalIndex(data.readUInt32(at: entry + 8)), matchCount: matchCount)
+				}
+				
+				elements[id] = Element(matchers: Array(entries.prefix(matcherCount)), candidates: Array(entries.dropFirst(matcherCount)), ancestor: optionalId(data.readUInt32(at: payload + 4)), atIndex: optionalIndex(data.readUInt32(at: payload + 8)))
+			case .action:
+				guard let operation = Operation(rawValue: data.readUInt32(at: payload)) else {
+					break
+				}
+				
+				if operation == .remove {
+					_ = actions.popLast()
+					break
+				}
+				
+				let action = Action(variant: Variant(rawValue: data.readUInt32(at: payload + 4)) ?? .default,
+									actionType: strings[data.readUInt32(at: payload + 8)] ?? "",
+									element: optionalId(data.readUInt32(at: payload + 12)),
+									args: try args(data.readUInt32(at: payload + 16)),
+									secondaryElement: optionalId(data.readUInt32(at: payload + 20)),
+									secondaryArgs: try args(data.readUInt32(at: payload + 24)),
+									date: Date(timeIntervalSince1970: Double(bitPattern: data.readUInt64(at: payload + 32))))
+				
+				if operation == .update && actions.isEmpty == false {
+					actions[actions.count - 1] = action
+				} else {
+					actions.append(action)
+				}
+			case .none:
+				//Unknown records are skipped, so older CLIs can read logs with additional record kinds.
+				break
+			}
+			
+			offset = payload + ((length + 7) & ~7)
+		}
+		
+		self.testName = testName
+		self.detoxVersionCompatibility = detoxVersionCompatibility
+		self.supportedDetoxVersions = supportedDetoxVersions
+		self.detoxVersion = detoxVersionCompatibility
+		self.startDate = startDate
+		self.elements = elements
+		self.actions = actions
+	}
+	
+	//MARK: Generation
+	
+	/// Equivalent to dtx_quotedStringRepresentationForJS
+	fileprivate static func quoted(_ string: String) -> String {
+		let data = try! JSONSerialization.data(withJSONObject: string, options: [.fragmentsAllowed])
+		return String(decoding: data, as: UTF8.self)
+	}
+	
+	/// Numbers are rounded to three fraction digits, dropping trailing zeros, as the framework does.
+	fileprivate static func numberDescription(_ number: NSNumber) -> String {
+		let value = (number.doubleValue * 1000).rounded() / 1000
+		if value == 0 {
+			return "0"
+		}
+		
+		var rv = String(format: "%.3f", value)
+		while rv.hasSuffix("0") {
+			rv.removeLast()
+		}
+		if rv.hasSuffix(".") {
+			rv.removeLast()
+		}
+		
+		return rv
+	}
+	
+	fileprivate static func valueDescription(_ value: Any) -> String {
+		switch value {
+		case let number as NSNumber:
+			return numberDescription(number)
+		case let string as String:
+			return quoted(string)
+		case let dictionary as [String: Any]:
+			return "{" + dictionary.keys.sorted().map { "\(quoted($0)):\(valueDescription(dictionary[$0]!))" }.joined(separator: ",") + "}"
+		case let array as [Any]:
+			return "[" + array.map { valueDescription($0) }.joined(separator: ",") + "]"
+		default:
+			return "\(value)"
+		}
+	}
+	
+	func elementDescription(_ id: UInt32) -> String {
+		guard let element = elements[id] else {
+			return "element(by.id(\"\"))"
+		}
+		
+		func matcherDescription(_ matcher: Matcher) -> String {
+			return "\(matcher.type)(\(RecordingEventLog.quoted(matcher.value)))"
+		}
+		
+		//Nested the same way as detoxDescriptionForMatchers:
+		var rv = "element("
+		for (idx, matcher) in element.matchers.enumerated() {
+			rv += idx > 0 ? ".and(\(matcherDescription(matcher))" : matcherDescription(matcher)
+		}
+		rv += String(repeating: ")", count: max(element.matchers.count - 1, 0))
+		rv += ")"
+		
+		if let ancestor = element.ancestor {
+			rv += ".withAncestor(\(elementDescription(ancestor)))"
+		}
+		
+		if let atIndex = element.atIndex {
+			rv += ".atIndex(\(atIndex))"
+		}
+		
+		return rv
+	}
+	
+	/// Mirrors the framework's generateDetoxDescription implementations. All supported Detox versions currently share
+	/// this syntax; differences between versions branch on `detoxVersion`.
+	func actionDescription(_ action: Action) -> String {
+		let target = action.element.map { elementDescription($0) } ?? "device"
+		
+		switch action.variant {
+		case .codeComment:
+			return "//\(action.secondaryArgs.first ?? "")"
+		case .tapReturnKey:
+			return "await \(target).tapReturnKey();"
+		case .scrollToVisible:
+			let scrollTarget = action.secondaryElement.map { elementDescription($0) } ?? "device"
+			return "await waitFor(\(scrollTarget)).toBeVisible().whileElement(\(target)).scroll(\(action.args.first ?? ""), \"\(action.args.last ?? "")\");"
+		case .default:
+			return "await \(target).\(action.actionType)(\(action.args.map { RecordingEventLog.valueDescription($0) }.joined(separator: ", ")));"
+		}
+	}
+	
+	/// A copy of the log that generates tests for another of the supported Detox versions.
+	func targetingDetoxVersion(_ detoxVersion: String) throws -> RecordingEventLog {
+		guard detoxVersion == detoxVersionCompatibility || supportedDetoxVersions.contains(detoxVersion) else {
+			throw "Detox \(detoxVersion) is not supported by the recorder that wrote the event log; supported versions are \(supportedDetoxVersions.joined(separator: ", "))"
+		}
+		
+		var rv = self
+		rv.detoxVersion = detoxVersion
+		return rv
+	}
+	
+	/// The same output as a live recording, as written by RecordingHandler.
+	func generateTest(testName: String? = nil) -> String {
+		var rv = "describe('Recorded suite', () => {\n\tit('\(testName ?? self.testName)', async () => {\n"
+		for action in actions {
+			rv += "\t\t\(actionDescription(action))\n"
+		}
+		rv += "\t})\n});"
+		
+		return rv
+	}
+}
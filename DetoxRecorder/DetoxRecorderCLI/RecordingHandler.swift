@@ -10,22 +10,111 @@ import Foundation
 import DTXSocketConnection
 
 class RecordingHandler: NSObject, NetServiceDelegate, DTXSocketConnectionDelegate {
+	/// Compact frame version; must match DTXRecordingWireFormat in the recorder framework.
+	static let wireFormatVersion: UInt8 = 1
+	fileprivate static let plistMagic = "bplist".data(using: .utf8)!
+	fileprivate static let commandTypes: [UInt8: String] = [1: "add", 2: "update", 3: "remove", 4: "end", 5: "ping", 6: "summary"]
+	
 	fileprivate var socketConnection: DTXSocketConnection! = nil
 	let serviceName = UUID().uuidString
 	fileprivate	let netService: NetService
+	/// Lets the recorder connect directly; the Bonjour service is kept as a fallback.
+	fileprivate var loopbackListener: LoopbackListener? = nil
+	var loopbackPort: UInt16? {
+		return loopbackListener?.port
+	}
+	
+	fileprivate(set) var currentFileUrl: URL! = nil
+	fileprivate var currentFile: FileHandle? = nil
+	let fileOutro = "\t})\n});".data(using: .utf8)!
+	
+	/// End of the committed actions already written to disk.
+	var committedFileOffset: UInt64 = 0
+	/// Committed actions not yet written to disk.
+	var pendingData = Data()
+	/// Only the last action can still be updated or removed, so it is kept in memory until the next one arrives.
+	var lastAction: String? = nil
+	var needsCheckpoint = false
+	
+	/// When set, the finished test file is rewritten with repeated actions folded into loops and helpers (see ActionFolding).
+	var compactsOutput = false
+	/// Every committed action of the current recording, kept only when compacting.
+	fileprivate var committedActions: [String] = []
+	fileprivate var currentTestName: String = ""
 	
-	let currentFileUrl: URL
-	let currentFile: FileHandle
-	var currentFileOffset: UInt64 = 0
-	var previousFileOffset: UInt64 = 0
-	let fileOutro: Data
+	static let checkpointInterval: DispatchTimeInterval = .seconds(1)
+	static let pendingDataFlushThreshold = 64 * 1024
+	fileprivate let fileLock = NSLock()
+	fileprivate var checkpointTimer: DispatchSourceTimer! = nil
 	
 	fileprivate var awaitingCompletionHandler: ((RecordingHandler) -> Void)?
 	
-	init(recordingUrl: URL, testName: String, completionHandler: @escaping (RecordingHandler) -> Void) {
+	/// When set, the recording service stays published after a recording ends, and this is called instead of exiting.
+	var recordingFinishedHandler: ((RecordingHandler) -> Void)?
+	
+	/// Shared by all targets; receives every decoded command, in order.
+	fileprivate let streamServer: RecordingStreamServer?
+	fileprivate var streamRecordingName: String {
+		return currentFileUrl.lastPathComponent
+	}
+	
+	init(recordingUrl: URL, testName: String, streamServer: RecordingStreamServer? = nil, completionHandler: @escaping (RecordingHandler) -> Void) {
 		awaitingCompletionHandler = completionHandler
+		self.streamServer = streamServer
 		netService = NetService(domain: "local", type: "_detoxrecorder._tcp", name: serviceName, port: 0)
 		
+		super.init()
+		
+		openRecordingFile(recordingUrl: recordingUrl, testName: testName)
+		
+		checkpointTimer = DispatchSource.makeTimerSource(queue: .global(qos: .utility))
+		checkpointTimer.schedule(deadline: .now() + RecordingHandler.checkpointInterval, repeating: RecordingHandler.checkpointInterval, leeway: .milliseconds(250))
+		checkpointTimer.setEventHandler { [weak self] in
+			guard let self = self else {
+				return
+			}
+			
+			do {
+				try self.checkpoint()
+			} catch {
+				self.exitWithError("Error writing to output test file: \(error.localizedDescription)")
+			}
+		}
+		checkpointTimer.resume()
+		
+		do {
+			loopbackListener = try LoopbackListener { [weak self] inputStream, outputStream in
+				self?.acceptConnection(inputStream: inputStream, outputStream: outputStream)
+			}
+		} catch {
+			log.info("Loopback connections unavailable: \(error.localizedDescription)")
+		}
+		
+		netService.delegate = self
+		netService.schedule(in: .current, forMode: .default)
+		netService.publish(options: .listenForConnections)
+		
+		if loopbackListener != nil {
+			//The recorder can connect right away, so there is no need to wait for mDNS.
+			DispatchQueue.main.async {
+				self.notifyServiceReady()
+			}
+		}
+	}
+	
+	fileprivate func notifyServiceReady() {
+		awaitingCompletionHandler?(self)
+		awaitingCompletionHandler = nil
+	}
+	
+	fileprivate func acceptConnection(inputStream: InputStream, outputStream: OutputStream) {
+		socketConnection = DTXSocketConnection(inputStream: inputStream, outputStream: outputStream, delegateQueue: nil)
+		socketConnection.delegate = self
+		socketConnection.open()
+		startReceiving(socketConnection)
+	}
+	
+	fileprivate func openRecordingFile(recordingUrl: URL, testName: String) {
 		do {
 			let directoryUrl: URL
 			if recordingUrl.hasDirectoryPath {
@@ -39,145 +128,375 @@ class RecordingHandler: NSObject, NetServiceDelegate, DTXSocketConnectionDelegat
 			try FileManager.default.createDirectory(at: directoryUrl, withIntermediateDirectories: true, attributes: nil)
 			
 			try "".write(to: currentFileUrl, atomically: true, encoding: .utf8)
-			currentFile = try FileHandle(forWritingTo: currentFileUrl)
+			let file = try FileHandle(forWritingTo: currentFileUrl)
 			let intro = "describe('Recorded suite', () => {\n\tit('\(testName)', async () => {\n".data(using: .utf8)!
-			fileOutro = "\t})\n});".data(using: .utf8)!
 			
-			try currentFile.write(contentsOf: intro)
-			try currentFile.write(contentsOf: fileOutro)
+			try file.write(contentsOf: intro)
+			try file.write(contentsOf: fileOutro)
+			
+			fileLock.lock()
+			currentFile = file
+			committedFileOffset = UInt64(intro.count)
+			pendingData.removeAll(keepingCapacity: true)
+			lastAction = nil
+			needsCheckpoint = false
+			committedActions.removeAll()
+			currentTestName = testName
+			fileLock.unlock()
 			
-			try currentFile.seek(toOffset: UInt64(intro.count))
-			previousFileOffset = UInt64(intro.count)
-			currentFileOffset = UInt64(intro.count)
+			streamServer?.beginRecording(streamRecordingName)
 		} catch {
-			LNUsagePrintMessageAndExit(prependMessage: "Unable to open output test file for writing: \(error.localizedDescription)", logLevel: .error)
+			exitWithError("Unable to open output test file for writing: \(error.localizedDescription)")
 		}
+	}
+	
+	/// Starts writing a new test file, reusing the published recording service.
+	func startNextRecording(recordingUrl: URL, testName: String) {
+		openRecordingFile(recordingUrl: recordingUrl, testName: testName)
+	}
+	
+	fileprivate func closeRecordingFile() throws {
+		try finalCheckpoint()
 		
-		super.init()
+		fileLock.lock()
+		defer {
+			fileLock.unlock()
+		}
 		
-		netService.delegate = self
-		netService.schedule(in: .current, forMode: .default)
-		netService.publish(options: .listenForConnections)
+		try currentFile?.close()
+		currentFile = nil
 	}
 	
-	fileprivate func truncateFile() throws {
-		try currentFile.truncate(atOffset: currentFileOffset)
+	/// Ends the current recording, either exiting or, when a `recordingFinishedHandler` is set, keeping the service warm for the next one.
+	fileprivate func finishRecording(_ socketConnection: DTXSocketConnection?) {
+		guard let recordingFinishedHandler = recordingFinishedHandler else {
+			printFinishAndExit()
+		}
+		
+		//Both the end command and the socket closing end a recording; only the first counts.
+		guard currentFile != nil, socketConnection == nil || socketConnection === self.socketConnection else {
+			return
+		}
+		
+		do {
+			try closeRecordingFile()
+		} catch {
+			exitWithError("Error writing to output test file: \(error.localizedDescription)")
+		}
+		
+		self.socketConnection = nil
+		streamServer?.endRecording(streamRecordingName)
+		
+		LNUsagePrintMessage(prependMessage: "Finished recording to \(currentFileUrl.path)", logLevel: .stdOut)
+		
+		recordingFinishedHandler(self)
 	}
 	
+	fileprivate func actionLine(_ action: String) -> Data {
+		return "\t\t\(action)\n".data(using: .utf8)!
+	}
 	
-	fileprivate func writeActionToFile(_ action: String) throws {
-		try truncateFile()
+	/// Must be called with `fileLock` held.
+	fileprivate func flushPendingData() throws {
+		guard pendingData.count > 0, let currentFile = currentFile else {
+			return
+		}
 		
-		let data = "\t\t\(action)\n".data(using: .utf8)!
-		try currentFile.write(contentsOf: data)
+		try currentFile.seek(toOffset: committedFileOffset)
+		try currentFile.write(contentsOf: pendingData)
+		committedFileOffset += UInt64(pendingData.count)
+		pendingData.removeAll(keepingCapacity: true)
+	}
+	
+	/// Writes the pending actions, the last action and the outro, leaving a complete test file on disk.
+	fileprivate func checkpoint() throws {
+		fileLock.lock()
+		defer {
+			fileLock.unlock()
+		}
+		
+		guard needsCheckpoint else {
+			return
+		}
 		
-		previousFileOffset = currentFileOffset
-		currentFileOffset += UInt64(data.count)
+		guard let currentFile = currentFile else {
+			return
+		}
+		
+		try flushPendingData()
+		try currentFile.seek(toOffset: committedFileOffset)
+		
+		var tail = Data()
+		if let lastAction = lastAction {
+			tail.append(actionLine(lastAction))
+		}
+		tail.append(fileOutro)
+		
+		try currentFile.write(contentsOf: tail)
+		try currentFile.truncate(atOffset: committedFileOffset + UInt64(tail.count))
+		
+		needsCheckpoint = false
 	}
 	
-	fileprivate func writeOutroToFile() throws {
-		try currentFile.truncate(atOffset: currentFileOffset)
-		try currentFile.write(contentsOf: fileOutro)
+	/// The last checkpoint of a recording; only then is the whole test known, so this is where it is compacted.
+	fileprivate func finalCheckpoint() throws {
+		try checkpoint()
+		
+		guard compactsOutput else {
+			return
+		}
+		
+		fileLock.lock()
+		defer {
+			fileLock.unlock()
+		}
+		
+		guard let currentFile = currentFile else {
+			return
+		}
+		
+		let folding = ActionFolding(actions: committedActions + (lastAction.map { [$0] } ?? []))
+		let data = folding.generateTest(testName: currentTestName).data(using: .utf8)!
+		
+		try currentFile.seek(toOffset: 0)
+		try currentFile.write(contentsOf: data)
+		try currentFile.truncate(atOffset: UInt64(data.count))
 	}
 	
 	fileprivate func addAction(_ action: String) throws {
 		log.info("Adding recorded action: \(action)")
-		try writeActionToFile(action)
-		try writeOutroToFile()
+		
+		fileLock.lock()
+		defer {
+			fileLock.unlock()
+		}
+		
+		if let lastAction = lastAction {
+			pendingData.append(actionLine(lastAction))
+			if compactsOutput {
+				committedActions.append(lastAction)
+			}
+		}
+		lastAction = action
+		needsCheckpoint = true
+		
+		if pendingData.count >= RecordingHandler.pendingDataFlushThreshold {
+			try flushPendingData()
+		}
 	}
 	
 	fileprivate func updateAction(_ action: String?) throws {
-		try currentFile.seek(toOffset: previousFileOffset)
-		currentFileOffset = previousFileOffset
-		
 		if let action = action {
 			log.info("Updating last recorded action to: \(action)")
-			try writeActionToFile(action)
 		} else {
 			log.info("Removing last recorded action")
-			try truncateFile()
 		}
 		
-		try writeOutroToFile()
+		fileLock.lock()
+		defer {
+			fileLock.unlock()
+		}
+		
+		lastAction = action
+		needsCheckpoint = true
+	}
+	
+	/// Writes the final checkpoint of the current recording without exiting, for when several recordings end together.
+	func finish(_ leadingNewLine: Bool = false) {
+		checkpointTimer.cancel()
+		guard currentFile != nil else {
+			return
+		}
+		
+		do {
+			try finalCheckpoint()
+		} catch {
+			exitWithError("Error writing to output test file: \(error.localizedDescription)")
+		}
+		
+		LNUsagePrintMessage(prependMessage: "\(leadingNewLine ? "\n" : "")Finished recording to \(currentFileUrl.path)", logLevel: .stdOut)
+	}
+	
+	/// Recorder statistics are written next to the test file, e.g. “RecordedTest.summary.json”.
+	fileprivate func writeSummary(_ statistics: String) throws {
+		let summaryUrl = currentFileUrl.deletingPathExtension().appendingPathExtension("summary.json")
+		log.info("Writing recording summary to \(summaryUrl.path)")
+		try statistics.write(to: summaryUrl, atomically: true, encoding: .utf8)
 	}
 	
 	func printFinishAndExit(_ leadingNewLine: Bool = false) -> Never {
+		checkpointTimer.cancel()
+		do {
+			try finalCheckpoint()
+		} catch {
+			exitWithError("Error writing to output test file: \(error.localizedDescription)")
+		}
+		
+		streamServer?.waitUntilDelivered()
+		
 		LNUsagePrintMessageAndExit(prependMessage: "\(leadingNewLine ? "\n" : "")Finished recording to \(currentFileUrl.path)", logLevel: .stdOut)
 	}
 	
-	fileprivate func startReceiving() {
+	/// Writes the final checkpoint, so actions received so far are not lost, before exiting with an error.
+	fileprivate func exitWithError(_ message: String) -> Never {
+		checkpointTimer?.cancel()
+		//The checkpoint may be what failed; there is nothing more to save then.
+		try? finalCheckpoint()
+		
+		LNUsagePrintMessageAndExit(prependMessage: message, logLevel: .error)
+	}
+	
+	fileprivate func startReceiving(_ socketConnection: DTXSocketConnection) {
 		socketConnection.receive { [weak self] data, error in
-			guard let self = self else {
+			//A finished recording's connection may still deliver data; it no longer belongs to any file.
+			guard let self = self, socketConnection === self.socketConnection else {
 				return
 			}
 			
 			guard let data = data else {
-				LNUsagePrintMessageAndExit(prependMessage: "Error reading recording command: \(error!.localizedDescription)", logLevel: .error)
+				self.exitWithError("Error reading recording command: \(error!.localizedDescription)")
 			}
 			
-			let command = try! PropertyListSerialization.propertyList(from: data, options: [], format: nil) as! [String: AnyObject]
-			let actionType = command["type"] as! String
+			let commands: [(type: String, command: String?)]
+			do {
+				commands = try RecordingHandler.decodeCommands(data)
+			} catch {
+				self.exitWithError("Error reading recording command: \(error.localizedDescription)")
+			}
 			
 			do {
-				switch(actionType) {
-				case "add":
-					let detoxCommand = command["command"] as! String
-					try self.addAction(detoxCommand)
-					break
-				case "update":
-					let detoxCommand = command["command"] as! String
-					try self.updateAction(detoxCommand)
-					break
-				case "remove":
-					try self.updateAction(nil)
-					break
-				case "end":
-					self.printFinishAndExit()
-					break
-				case "ping":
-					//Ignore
-					break
-				default:
-					throw "Got unknown command type: \(actionType)"
+				for (actionType, detoxCommand) in commands {
+					try self.handleCommand(actionType, detoxCommand: detoxCommand)
 				}
 			} catch {
-				LNUsagePrintMessageAndExit(prependMessage: "Error writing command to output test file: \(error.localizedDescription)", logLevel: .error)
+				self.exitWithError("Error writing command to output test file: \(error.localizedDescription)")
 			}
 			
-			self.startReceiving()
+			if socketConnection === self.socketConnection {
+				self.startReceiving(socketConnection)
+			}
+		}
+	}
+	
+	fileprivate func handleCommand(_ actionType: String, detoxCommand: String?) throws {
+		streamServer?.publish(recording: streamRecordingName, type: actionType, command: detoxCommand)
+		
+		switch(actionType) {
+		case "add":
+			guard let detoxCommand = detoxCommand else {
+				throw "Missing command for “add”"
+			}
+			try self.addAction(detoxCommand)
+			break
+		case "update":
+			guard let detoxCommand = detoxCommand else {
+				throw "Missing command for “update”"
+			}
+			try self.updateAction(detoxCommand)
+			break
+		case "remove":
+			try self.updateAction(nil)
+			break
+		case "end":
+			streamServer?.endRecording(streamRecordingName)
+			self.finishRecording(nil)
+			break
+		case "ping":
+			//Ignore
+			break
+		case "summary":
+			guard let detoxCommand = detoxCommand else {
+				throw "Missing statistics for “summary”"
+			}
+			try self.writeSummary(detoxCommand)
+			break
+		default:
+			throw "Got unknown command type: \(actionType)"
 		}
 	}
 	
+	/// Decodes either a legacy binary plist command, or a compact frame of one or more commands.
+	fileprivate static func decodeCommands(_ data: Data) throws -> [(type: String, command: String?)] {
+		if data.starts(with: plistMagic) {
+			guard let command = try PropertyListSerialization.propertyList(from: data, options: [], format: nil) as? [String: AnyObject], let actionType = command["type"] as? String else {
+				throw "Malformed recording command"
+			}
+			
+			return [(actionType, command["command"] as? String)]
+		}
+		
+		let bytes = [UInt8](data)
+		guard let version = bytes.first, version == wireFormatVersion else {
+			throw "Unsupported recording frame version"
+		}
+		
+		var rv: [(type: String, command: String?)] = []
+		var idx = 1
+		while idx < bytes.count {
+			guard let actionType = commandTypes[bytes[idx]] else {
+				throw "Got unknown command type: \(bytes[idx])"
+			}
+			idx += 1
+			
+			var length = 0
+			var shift = 0
+			while true {
+				guard idx < bytes.count, shift < 64 else {
+					throw "Truncated recording frame"
+				}
+				let byte = bytes[idx]
+				idx += 1
+				length |= Int(byte & 0x7F) << shift
+				shift += 7
+				if byte & 0x80 == 0 {
+					break
+				}
+			}
+			
+			guard length >= 0, idx + length <= bytes.count else {
+				throw "Truncated recording frame"
+			}
+			
+			let command = length > 0 ? String(decoding: bytes[idx..<(idx + length)], as: UTF8.self) : nil
+			idx += length
+			
+			rv.append((actionType, command))
+		}
+		
+		return rv
+	}
+	
 	// MARK: DTXSocketConnectionDelegate
 	
 	func readClosed(for socketConnection: DTXSocketConnection) {
 		log.info("Socket connection closed for reading.")
 		
-		printFinishAndExit()
+		finishRecording(socketConnection)
 	}
 	
 	func writeClosed(for socketConnection: DTXSocketConnection) {
 		log.info("Socket connection closed for writing.")
 		
-		printFinishAndExit()
+		finishRecording(socketConnection)
 	}
 	
 	// MARK: NSNetServiceDelegate
 	
 	func netService(_ sender: NetService, didAcceptConnectionWith inputStream: InputStream, outputStream: OutputStream) {
-		socketConnection = DTXSocketConnection(inputStream: inputStream, outputStream: outputStream, delegateQueue: nil)
-		socketConnection.delegate = self
-		socketConnection.open()
-		startReceiving()
+		acceptConnection(inputStream: inputStream, outputStream: outputStream)
 	}
 	
 	func netServiceDidPublish(_ sender: NetService) {
 		log.info("Published recording service: \(sender)")
-		awaitingCompletionHandler?(self)
-		awaitingCompletionHandler = nil
+		notifyServiceReady()
 	}
 	
 	func netService(_ sender: NetService, didNotPublish errorDict: [String : NSNumber]) {
-		LNUsagePrintMessageAndExit(prependMessage: "Failed stating a recording service.", logLevel: .error)
+		guard loopbackListener == nil else {
+			log.info("Failed publishing the recording service; relying on the loopback connection: \(errorDict)")
+			return
+		}
+		
+		exitWithError("Failed stating a recording service.")
 	}
 }
@@ -0,0 +1,264 @@
+//
+//  RecordingStreamServer.swift
+//  DetoxRecorderCLI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+import Foundation
+
+/// Streams the recorded actions of every recording to any number of local subscribers, such as IDE panels or dashboards.
+///
+/// Subscribers connect to the loopback port and send a single line, either “live” or “final”. Both then receive newline
+/// delimited JSON events, each with an `event` and a `recording` (the output file name):
+/// - live: `begin`, `add`, `update` (with `command`), `remove` and `end`, as the recorder sends them
+/// - final: `begin`, `commit` (with `command`, once an action can no longer change) and `end`
+/// Late subscribers first receive the `begin` and the most recent events already sent for the current recordings.
+class RecordingStreamServer {
+	enum Mode: String {
+		case live
+		case final
+	}
+	
+	fileprivate class Subscriber {
+		let channel: DispatchIO
+		var mode: Mode? = nil
+		var greeting = Data()
+		var pendingBytes = 0
+		
+		init(channel: DispatchIO) {
+			self.channel = channel
+		}
+	}
+	
+	/// The replayed events of a recording: its `begin`, followed by a ring of the most recent events.
+	fileprivate struct History {
+		let begin: DispatchData
+		private var events: [DispatchData] = []
+		private var oldest = 0
+		
+		init(begin: DispatchData) {
+			self.begin = begin
+		}
+		
+		mutating func append(_ data: DispatchData) {
+			guard events.count == RecordingStreamServer.maxHistoryEventsPerRecording else {
+				events.append(data)
+				return
+			}
+			
+			events[oldest] = data
+			oldest = (oldest + 1) % events.count
+		}
+		
+		func forEach(_ body: (DispatchData) -> Void) {
+			body(begin)
+			events[oldest...].forEach(body)
+			events[..<oldest].forEach(body)
+		}
+	}
+	
+	/// Subscribers that fall this far behind are disconnected, rather than buffering without bound.
+	static let maxPendingBytesPerSubscriber = 4 * 1024 * 1024
+	/// Long recordings only replay their most recent events to late subscribers.
+	static let maxHistoryEventsPerRecording = 1024
+	/// Subscribers that send this much without a mode line are disconnected.
+	static let maxGreetingLength = 64
+	
+	fileprivate let queue = DispatchQueue(label: "com.wix.DetoxRecorderCLI.stream", qos: .utility)
+	fileprivate var listener: LoopbackListener! = nil
+	fileprivate var subscribers: [ObjectIdentifier: Subscriber] = [:]
+	fileprivate let pendingWrites = DispatchGroup()
+	
+	/// Events of the current recordings, replayed to every new subscriber of the mode.
+	/// Live history holds a single `add` per committed action, not the updates the action went through.
+	fileprivate var history: [Mode: [String: History]] = [.live: [:], .final: [:]]
+	/// The uncommitted last action of each recording; it is only encoded as a commit once it becomes final.
+	fileprivate var lastActions: [String: String] = [:]
+	
+	var port: UInt16 {
+		return listener.port
+	}
+	
+	init(port: UInt16) throws {
+		listener = try LoopbackListener(port: port) { [weak self] fd in
+			self?.accept(fd)
+		}
+	}
+	
+	fileprivate func accept(_ fd: Int32) {
+		//Writing to a subscriber that has gone away must fail, not raise SIGPIPE.
+		var noSigPipe: Int32 = 1
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, socklen_t(MemoryLayout<Int32>.size))
+		
+		let channel = DispatchIO(type: .stream, fileDescriptor: fd, queue: queue) { _ in
+			close(fd)
+		}
+		channel.setLimit(lowWater: 1)
+		
+		queue.async {
+			let subscriber = Subscriber(channel: channel)
+			self.subscribers[ObjectIdentifier(subscriber)] = subscriber
+			self.readGreeting(subscriber)
+		}
+	}
+	
+	fileprivate func readGreeting(_ subscriber: Subscriber) {
+		//Reading on until the subscriber closes its end is how a disconnect is noticed; anything after the greeting is discarded.
+		subscriber.channel.read(offset: 0, length: Int.max, queue: queue) { [weak self] done, data, error in
+			guard let self = self else {
+				return
+			}
+			
+			if subscriber.mode == nil, let data = data, data.isEmpty == false {
+				subscriber.greeting.append(contentsOf: data)
+				
+				if let newLine = subscriber.greeting.firstIndex(of: UInt8(ascii: "\n")) {
+					let line = String(decoding: subscriber.greeting[..<newLine], as: UTF8.self).trimmingCharacters(in: .whitespaces)
+					guard let mode = Mode(rawValue: line) else {
+						self.disconnect(subscriber)
+						return
+					}
+					
+					subscriber.mode = mode
+					subscriber.greeting = Data()
+					log.info("Stream subscriber connected in \(mode.rawValue) mode")
+					self.replay(to: subscriber)
+				} else if subscriber.greeting.count >= RecordingStreamServer.maxGreetingLength {
+					self.disconnect(subscriber)
+					return
+				}
+			}
+			
+			//The read only completes at end of file or on error.
+			if done {
+				self.disconnect(subscriber)
+			}
+		}
+	}
+	
+	fileprivate func disconnect(_ subscriber: Subscriber) {
+		guard subscribers.removeValue(forKey: ObjectIdentifier(subscriber)) != nil else {
+			return
+		}
+		
+		subscriber.channel.close(flags: .stop)
+	}
+	
+	fileprivate func write(_ data: DispatchData, to subscriber: Subscriber) {
+		subscriber.pendingBytes += data.count
+		guard subscriber.pendingBytes <= RecordingStreamServer.maxPendingBytesPerSubscriber else {
+			log.info("Disconnecting a stream subscriber that is not keeping up")
+			disconnect(subscriber)
+			return
+		}
+		
+		pendingWrites.enter()
+		subscriber.channel.write(offset: 0, data: data, queue: queue) { [weak self] done, _, error in
+			guard done else {
+				return
+			}
+			
+			self?.pendingWrites.leave()
+			guard let self = self else {
+				return
+			}
+			
+			subscriber.pendingBytes -= data.count
+			if error != 0 {
+				self.disconnect(subscriber)
+			}
+		}
+	}
+	
+	fileprivate func replay(to subscriber: Subscriber) {
+		for (recording, events) in history[subscriber.mode!]! {
+			events.forEach { write($0, to: subscriber) }
+			
+			//Late subscribers never saw the original add of an updated action.
+			if subscriber.mode == .live, let lastAction = lastActions[recording] {
+				write(RecordingStreamServer.encode("add", recording: recording, command: lastAction), to: subscriber)
+			}
+		}
+	}
+	
+	/// Encoded once; every subscriber is handed the same buffer.
+	fileprivate static func encode(_ event: String, recording: String, command: String?) -> DispatchData {
+		var object = ["event": event, "recording": recording]
+		object["command"] = command
+		
+		var data = try! JSONSerialization.data(withJSONObject: object, options: [.sortedKeys])
+		data.append(UInt8(ascii: "\n"))
+		return data.withUnsafeBytes { DispatchData(bytes: $0) }
+	}
+	
+	fileprivate func broadcast(_ data: DispatchData, mode: Mode?) {
+		for subscriber in subscribers.values where subscriber.mode != nil && (mode == nil || subscriber.mode == mode) {
+			write(data, to: subscriber)
+		}
+	}
+	
+	/// Publishes a decoded recorder command of the recording; call in the order the commands were received.
+	func publish(recording: String, type: String, command: String?) {
+		queue.async {
+			switch type {
+			case "add":
+				self.commitLastAction(recording)
+				self.lastActions[recording] = command
+			case "update":
+				self.lastActions[recording] = command
+			case "remove":
+				self.lastActions[recording] = nil
+			default:
+				return
+			}
+			
+			self.broadcast(RecordingStreamServer.encode(type, recording: recording, command: command), mode: .live)
+		}
+	}
+	
+	fileprivate func commitLastAction(_ recording: String) {
+		guard let command = lastActions.removeValue(forKey: recording) else {
+			return
+		}
+		
+		history[.live]![recording]?.append(RecordingStreamServer.encode("add", recording: recording, command: command))
+		
+		let data = RecordingStreamServer.encode("commit", recording: recording, command: command)
+		history[.final]![recording]?.append(data)
+		broadcast(data, mode: .final)
+	}
+	
+	func beginRecording(_ recording: String) {
+		queue.async {
+			let data = RecordingStreamServer.encode("begin", recording: recording, command: nil)
+			self.history[.live]![recording] = History(begin: data)
+			self.history[.final]![recording] = History(begin: data)
+			self.lastActions[recording] = nil
+			self.broadcast(data, mode: nil)
+		}
+	}
+	
+	/// Commits the last action and ends the recording's stream; its events are no longer replayed.
+	func endRecording(_ recording: String) {
+		queue.async {
+			guard self.history[.final]![recording] != nil else {
+				return
+			}
+			
+			self.commitLastAction(recording)
+			self.broadcast(RecordingStreamServer.encode("end", recording: recording, command: nil), mode: nil)
+			
+			self.history[.live]![recording] = nil
+			self.history[.final]![recording] = nil
+			self.lastActions[recording] = nil
+		}
+	}
+	
+	/// Gives subscribers a chance to receive the last events before the process exits.
+	func waitUntilDelivered(timeout: DispatchTimeInterval = .seconds(1)) {
+		queue.sync {}
+		_ = pendingWrites.wait(timeout: .now() + timeout)
+	}
+}
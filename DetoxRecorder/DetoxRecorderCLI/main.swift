@@ -23,19 +23,31 @@ LNUsageSetIntroStrings([
 LNUsageSetExampleStrings([
 	"detox recorder --bundleId \"com.example.myApp\" --simulatorId booted --outputTestFile \"~/Desktop/RecordedTest.js\" --testName \"My Recorded Test\" --record",
 	"detox recorder --bundleId \"com.example.myApp\" --simulatorId \"69D91B05-64F4-497B-A2FC-9A109B310F38\" --outputTestFile \"~/Desktop/RecordedTest.js\" --testName \"My Recorded Test\" --record",
-	"detox recorder --configuration \"ios.sim.release\" --outputTestFile \"~/Desktop/RecordedTest.js\" --testName \"My Recorded Test\" --record"
+	"detox recorder --configuration \"ios.sim.release\" --outputTestFile \"~/Desktop/RecordedTest.js\" --testName \"My Recorded Test\" --record",
+	"detox recorder --configuration \"ios.sim.iphone,ios.sim.ipad\" --outputTestFile \"~/Desktop/RecordedTest.js\" --testName \"My Recorded Test\" --record",
+	"detox recorder --generate \"~/Desktop/RecordedTest.events\" --outputTestFile \"~/Desktop/RegeneratedTest.js\""
 ])
 
 LNUsageSetOptions([
 	LNUsageOption(name: "record", shortcut: "r", valueRequirement: .none, description: "Start recording"),
 	LNUsageOption(name: "outputTestFile", shortcut: "o", valueRequirement: .required, description: "The output file (required)"),
 	LNUsageOption(name: "testName", shortcut: "n", valueRequirement: .required, description: "The test name (optional)"),
+	LNUsageOption(name: "session", shortcut: "w", valueRequirement: .none, description: "Keep the simulator, app and recording service warm after each recording, and record successive tests on demand (optional)"),
+	LNUsageOption(name: "eventLog", shortcut: "e", valueRequirement: .none, description: "Also write a binary event log next to each recorded test, from which the test can later be regenerated (optional)"),
+	LNUsageOption(name: "video", shortcut: "m", valueRequirement: .none, description: "Also capture a video of the app next to each recorded test, with a chapter for every recorded action (optional)"),
+	LNUsageOption(name: "screenshots", shortcut: "i", valueRequirement: .none, description: "Also save a reference image for every recorded screenshot, in a directory next to each recorded test (optional)"),
+	LNUsageOption(name: "compact", shortcut: "f", valueRequirement: .none, description: "Fold repeated actions of each finished test into loops and helper functions; also applies when generating (optional)"),
+	LNUsageOption(name: "streamPort", shortcut: "p", valueRequirement: .required, description: "Stream recorded actions as newline delimited JSON to any number of local subscribers on this port; subscribers send “live” or “final” to choose a stream (optional)"),
 	LNUsageOption.empty(),
-	LNUsageOption(name: "configuration", shortcut: "c", valueRequirement: .required, description: "The Detox configuration to use (optional, required if either app or simulator information is not provided"),
+	LNUsageOption(name: "generate", shortcut: "g", valueRequirement: .required, description: "Generate the output file from a previously recorded event log, instead of recording"),
+	LNUsageOption(name: "rankMatchers", shortcut: "k", valueRequirement: .none, description: "When generating, choose the matchers that are unique most often across the whole recording, rather than those chosen while recording (optional)"),
+	LNUsageOption(name: "detoxVersion", shortcut: "d", valueRequirement: .required, description: "When generating, the Detox version to generate the test for, rather than the one recorded for (optional)"),
+	LNUsageOption.empty(),
+	LNUsageOption(name: "configuration", shortcut: "c", valueRequirement: .required, description: "The Detox configuration to use, or a comma separated list of configurations to record in parallel (optional, required if either app or simulator information is not provided"),
 	LNUsageOption.empty(),
 	LNUsageOption(name: "bundleId", shortcut: "b", valueRequirement: .required, description: "The app bundle identifier of an existing app to record (optional)"),
 	LNUsageOption.empty(),
-	LNUsageOption(name: "simulatorId", shortcut: "s", valueRequirement: .required, description: "The simulator identifier to use for recording or \"booted\" to use the currently booted simulator (optional)"),
+	LNUsageOption(name: "simulatorId", shortcut: "s", valueRequirement: .required, description: "The simulator identifier to use for recording or \"booted\" to use the currently booted simulator, or a comma separated list of simulator identifiers to record in parallel (optional)"),
 	LNUsageOption(name: "version", shortcut: "v", valueRequirement: .none, description: "Prints version")
 ])
 
@@ -162,6 +174,11 @@ class DetoxRecorderCLI
 		}
 		
 		let url = URL(fileURLWithPath: FileManager.default.currentDirectoryPath).appendingPathComponent("package.json")
+		if let cached = CLICache.cachedDetoxConfig(packageJsonUrl: url) {
+			log.info("Using cached Detox config from package.json")
+			return cached
+		}
+		
 		do {
 			let data = try Data(contentsOf: url)
 			let jsonObj = try JSONSerialization.jsonObject(with: data, options: [])
@@ -176,13 +193,25 @@ class DetoxRecorderCLI
 			
 			log.info("Using package.json as config file")
 			
+			CLICache.storeDetoxConfig(detox, packageJsonUrl: url)
+			
 			return detox
 		} catch {
 			LNUsagePrintMessageAndExit(prependMessage: error.localizedDescription, logLevel: .error)
 		}
 	}()
 	
+	fileprivate static var detoxConfigs: [String: [String: Any]] = [:]
+	fileprivate static let detoxConfigsLock = NSLock()
+	
 	static func detoxConfig(_ configName: String) -> [String: Any] {
+		detoxConfigsLock.lock()
+		let cached = detoxConfigs[configName]
+		detoxConfigsLock.unlock()
+		if let cached = cached {
+			return cached
+		}
+		
 		guard let configs = DetoxRecorderCLI.detoxPackageJson["configurations"] as? [String: Any] else {
 			LNUsagePrintMessageAndExit(prependMessage: "Key “configurations” is not found or unreadable in package.json.", logLevel: .error)
 		}
@@ -191,13 +220,21 @@ class DetoxRecorderCLI
 			LNUsagePrintMessageAndExit(prependMessage: "Configuration “\(configName)” is not found or unreadable in package.json.", logLevel: .error)
 		}
 		
+		detoxConfigsLock.lock()
+		detoxConfigs[configName] = config
+		detoxConfigsLock.unlock()
+		
 		return config
 	}
 }
 
 var whichCache: [String: URL] = [:]
+let whichCacheLock = NSLock()
 func whichURLFor(binaryName: String) throws -> URL {
-	if let url = whichCache[binaryName] {
+	whichCacheLock.lock()
+	let cachedUrl = whichCache[binaryName]
+	whichCacheLock.unlock()
+	if let url = cachedUrl {
 		return url
 	}
 	
@@ -215,7 +252,9 @@ func whichURLFor(binaryName: String) throws -> URL {
 	}
 	
 	let url = URL(fileURLWithPath: response)
+	whichCacheLock.lock()
 	whichCache[binaryName] = url
+	whichCacheLock.unlock()
 	return url
 }
 
@@ -253,6 +292,69 @@ func otoolProcess() -> Process {
 	return otoolProcess
 }
 
+/// Remembers which build of each app was last installed on each simulator, so unchanged builds are not reinstalled.
+struct AppInstallationCache {
+	fileprivate static let cacheUrl: URL = {
+		let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first!
+		return caches.appendingPathComponent("com.wix.DetoxRecorderCLI", isDirectory: true).appendingPathComponent("InstalledApps.plist", isDirectory: false)
+	}()
+	
+	fileprivate static func key(appPath: String, simulatorId: String) -> String {
+		return "\(simulatorId)|\(URL(fileURLWithPath: appPath).standardized.path)"
+	}
+	
+	/// Changes whenever the app's executable or Info.plist is rebuilt.
+	fileprivate static func buildStamp(_ bundle: Bundle) -> String? {
+		guard let executableURL = bundle.executableURL else {
+			return nil
+		}
+		
+		let infoPlistPath = bundle.bundleURL.appendingPathComponent("Info.plist").path
+		
+		guard let executableDate = try? FileManager.default.attributesOfItem(atPath: executableURL.path)[.modificationDate] as? Date,
+			  let infoPlistDate = try? FileManager.default.attributesOfItem(atPath: infoPlistPath)[.modificationDate] as? Date else {
+			return nil
+		}
+		
+		return "\(executableDate.timeIntervalSince1970)|\(infoPlistDate.timeIntervalSince1970)"
+	}
+	
+	//Parallel recordings may install at the same time.
+	fileprivate static let lock = NSLock()
+	
+	static func isInstalled(_ bundle: Bundle, appPath: String, simulatorId: String) -> Bool {
+		lock.lock()
+		let cache = NSDictionary(contentsOf: cacheUrl) as? [String: String]
+		lock.unlock()
+		
+		guard let stamp = buildStamp(bundle), let bundleId = bundle.bundleIdentifier, let cache = cache,
+			  cache[key(appPath: appPath, simulatorId: simulatorId)] == stamp else {
+			return false
+		}
+		
+		//The simulator might have been erased or the app uninstalled since.
+		let appContainerProcess = xcrunSimctlProcess()
+		appContainerProcess.simctlArguments = ["get_app_container", simulatorId, bundleId]
+		return (try? appContainerProcess.launchAndWaitUntilExitAndReturnOutput()) != nil
+	}
+	
+	static func recordInstallation(_ bundle: Bundle, appPath: String, simulatorId: String) {
+		guard let stamp = buildStamp(bundle) else {
+			return
+		}
+		
+		lock.lock()
+		defer {
+			lock.unlock()
+		}
+		
+		var cache = (NSDictionary(contentsOf: cacheUrl) as? [String: String]) ?? [:]
+		cache[key(appPath: appPath, simulatorId: simulatorId)] = stamp
+		try? FileManager.default.createDirectory(at: cacheUrl.deletingLastPathComponent(), withIntermediateDirectories: true, attributes: nil)
+		(cache as NSDictionary).write(to: cacheUrl, atomically: true)
+	}
+}
+
 func prepareappBundleId(bundleId: String?, config: String?, simulatorId: String) -> String {
 	if let bundleId = bundleId {
 		return bundleId
@@ -265,6 +367,15 @@ func prepareappBundleId(bundleId: String?, config: String?, simulatorId: String)
 			LNUsagePrintMessageAndExit(prependMessage: "Key “binaryPath” points to a path that does not exist.", logLevel: .error)
 		}
 		
+		guard let bundle = Bundle(path: appPath), let foundBundleId = bundle.bundleIdentifier else {
+			LNUsagePrintMessageAndExit(prependMessage: "Unable to read the app's Info.plist.", logLevel: .error)
+		}
+		
+		guard AppInstallationCache.isInstalled(bundle, appPath: appPath, simulatorId: simulatorId) == false else {
+			log.info("App build is already installed; skipping installation")
+			return foundBundleId
+		}
+		
 		let simctlInstall = xcrunSimctlProcess()
 		simctlInstall.simctlArguments = ["install", simulatorId, appPath]
 		do {
@@ -273,9 +384,7 @@ func prepareappBundleId(bundleId: String?, config: String?, simulatorId: String)
 			LNUsagePrintMessageAndExit(prependMessage: "Failed installing app: \(error.localizedDescription).", logLevel: .error)
 		}
 		
-		guard let bundle = Bundle(path: appPath), let foundBundleId = bundle.bundleIdentifier else {
-			LNUsagePrintMessageAndExit(prependMessage: "Unable to read the app's Info.plist.", logLevel: .error)
-		}
+		AppInstallationCache.recordInstallation(bundle, appPath: appPath, simulatorId: simulatorId)
 		
 		return foundBundleId
 	}
@@ -332,11 +441,17 @@ func prepareSimulatorId(simulatorId: String?, config: String?) -> String {
 	}
 	
 	var arguments: [String] = ["--list"]
-	deviceJson.forEach { key, value in
+	//Sorted, so the same query always produces the same cache key.
+	deviceJson.sorted { $0.key < $1.key }.forEach { key, value in
 		arguments.append("--by\(key.lowercased() == "os" ? "OS" : key.capitalizingFirstLetter())")
 		arguments.append(value)
 	}
 	
+	if let cachedSimId = CLICache.cachedSimulatorId(query: arguments) {
+		log.info("Using cached simulator lookup result for the “\(config!)” configuration")
+		return ensureSimulatorBooted(cachedSimId)
+	}
+	
 	let process = applesimutilsProcess()
 	process.arguments = arguments
 	let listResponseJson = (try? process.launchAndWaitUntilExitAndReturnOutput()) ?? ""
@@ -352,10 +467,17 @@ func prepareSimulatorId(simulatorId: String?, config: String?) -> String {
 		LNUsagePrintMessageAndExit(prependMessage: "Unabled to parse simulator data returned from applesimutils.", logLevel: .error)
 	}
 	
+	CLICache.storeSimulatorId(foundSimId, query: arguments)
+	
 	return ensureSimulatorBooted(foundSimId)
 }
 
 func executableContainsMagicSymbol(_ url: URL) -> Bool {
+	if let cached = FrameworkInjectionCache.cachedContainsDetoxRecorder(url) {
+		return cached
+	}
+	
+	//Fall back to the developer tools for executables the inspector does not understand.
 	let process = nmProcess()
 	process.arguments = ["-U", url.standardized.path]
 
@@ -379,21 +501,52 @@ guard parser.bool(forKey: "version") == false else {
 	LNUsagePrintMessageAndExit(prependMessage: "detox-recorder version \(__version)", logLevel: .stdOut)
 }
 
+//Offline generation needs no simulator or app.
+if let eventLogPath = parser.object(forKey: "generate") as? String {
+	guard let outputTestFile = parser.object(forKey: "outputTestFile") as? String else {
+		LNUsagePrintMessageAndExit(prependMessage: "You must provide an output test file path.", logLevel: .error)
+	}
+	
+	var outputUrl = URL(fileURLWithPath: (outputTestFile as NSString).expandingTildeInPath)
+	if outputUrl.hasDirectoryPath {
+		outputUrl.appendPathComponent("recorder_test.js", isDirectory: false)
+	}
+	
+	do {
+		var eventLog = try RecordingEventLog(url: URL(fileURLWithPath: (eventLogPath as NSString).expandingTildeInPath))
+		if parser.bool(forKey: "rankMatchers") {
+			eventLog = eventLog.rankingMatchers()
+		}
+		if let detoxVersion = parser.object(forKey: "detoxVersion") as? String {
+			eventLog = try eventLog.targetingDetoxVersion(detoxVersion)
+		}
+		let testName = parser.object(forKey: "testName") as? String
+		let test = parser.bool(forKey: "compact") ? eventLog.generateCompactTest(testName: testName) : eventLog.generateTest(testName: testName)
+		try test.write(to: outputUrl, atomically: true, encoding: .utf8)
+	} catch {
+		LNUsagePrintMessageAndExit(prependMessage: "Failed generating test: \(error.localizedDescription).", logLevel: .error)
+	}
+	
+	LNUsagePrintMessage(prependMessage: "Generated \(outputUrl.path)", logLevel: .stdOut)
+	exit(0)
+}
+
 guard parser.object(forKey: "record") != nil else {
 	LNUsagePrintMessageAndExit(prependMessage: "No command specified.", logLevel: .error)
 }
 
 let bundleId = parser.object(forKey: "bundleId") as? String
-let simId = parser.object(forKey: "simulatorId") as? String
+//Comma separated lists record several devices in parallel.
+let simIds = (parser.object(forKey: "simulatorId") as? String)?.split(separator: ",").map { String($0).trimmingCharacters(in: .whitespaces) }
 
-let config = parser.object(forKey: "configuration") as? String
+let configs = (parser.object(forKey: "configuration") as? String)?.split(separator: ",").map { String($0).trimmingCharacters(in: .whitespaces) }
 
-guard (bundleId != nil && simId != nil) || config != nil else {
-	if bundleId == nil && config == nil {
+guard (bundleId != nil && simIds != nil) || configs != nil else {
+	if bundleId == nil && configs == nil {
 		LNUsagePrintMessageAndExit(prependMessage: "You must either provide an app bundle identifier or a Detox configuration.", logLevel: .error)
 	}
 	
-	if simId == nil && config == nil {
+	if simIds == nil && configs == nil {
 		LNUsagePrintMessageAndExit(prependMessage: "You must either provide a simulator identifier or a Detox configuration.", logLevel: .error)
 	}
 	
@@ -404,72 +557,338 @@ guard let outputTestFile = parser.object(forKey: "outputTestFile") as? String el
 	LNUsagePrintMessageAndExit(prependMessage: "You must provide an output test file path.", logLevel: .error)
 }
 
-let simulatorId = prepareSimulatorId(simulatorId: simId, config: config)
-let appBundleId = prepareappBundleId(bundleId: bundleId, config: config, simulatorId: simulatorId)
+func appRequiresFrameworkInjection(simulatorId: String, appBundleId: String) -> Bool {
+	let appContainerProcess = xcrunSimctlProcess()
+	appContainerProcess.simctlArguments = ["get_app_container", simulatorId, appBundleId]
+	do {
+		let appInstalledPath = try appContainerProcess.launchAndWaitUntilExitAndReturnOutput()
+		guard let appBundle = Bundle(path: appInstalledPath), let executableURL = appBundle.executableURL else {
+			throw "err"
+		}
+		
+		let rv = executableContainsMagicSymbol(executableURL) == false
+		
+		log.info("App binary requires framework injection: \(String(describing: rv))")
+		
+		return rv
+	} catch {
+		return true
+	}
+}
+
+let testName = parser.object(forKey: "testName") as? String ?? "My Recorded Test"
+let outputTestUrl = URL(fileURLWithPath: (outputTestFile as NSString).expandingTildeInPath)
+let isSession = parser.bool(forKey: "session")
 
-let shouldInsertProcess = xcrunSimctlProcess()
-let shouldInsert: Bool
-shouldInsertProcess.simctlArguments = ["get_app_container", simulatorId, appBundleId]
-do {
-	let appInstalledPath = try shouldInsertProcess.launchAndWaitUntilExitAndReturnOutput()
-	guard let appBundle = Bundle(path: appInstalledPath), let executableURL = appBundle.executableURL else {
-		throw "err"
+/// One server for all targets, so subscribers see every parallel recording.
+let streamServer: RecordingStreamServer? = {
+	guard let portString = parser.object(forKey: "streamPort") as? String else {
+		return nil
+	}
+	
+	guard let port = UInt16(portString) else {
+		LNUsagePrintMessageAndExit(prependMessage: "Invalid stream port “\(portString)”.", logLevel: .error)
 	}
 	
-	shouldInsert = executableContainsMagicSymbol(executableURL) == false
+	do {
+		let rv = try RecordingStreamServer(port: port)
+		LNUsagePrintMessage(prependMessage: "Streaming recorded actions on 127.0.0.1:\(rv.port)", logLevel: .stdOut)
+		return rv
+	} catch {
+		LNUsagePrintMessageAndExit(prependMessage: "Unable to start streaming recorded actions: \(error.localizedDescription)", logLevel: .error)
+	}
+}()
+
+let startupQueue = DispatchQueue(label: "com.wix.DetoxRecorderCLI.startup", qos: .userInitiated, attributes: .concurrent)
+/// The resolved simulator and app of every target; only accessed on the main queue.
+var resolvedTargets = Set<String>()
+
+/// One simulator and app being recorded; several targets record in parallel, sharing the main run loop.
+class RecordingTarget {
+	let simId: String?
+	let config: String?
+	/// Distinguishes the output files of parallel targets; `nil` when recording a single target.
+	let outputSuffix: String?
+	
+	var simulatorId: String! = nil
+	var appBundleId: String! = nil
+	var shouldInsert = true
+	var setupFinished = false
+	var publishedRecordingHandler: RecordingHandler? = nil
+	var recordingHandler: RecordingHandler! = nil
+	
+	var recordingIndex = 1
+	var currentTestName = testName
 	
-	log.info("App binary requires framework injection: \(String(describing: shouldInsert))")
-} catch {
-	shouldInsert = true
+	init(simId: String?, config: String?, outputSuffix: String?) {
+		self.simId = simId
+		self.config = config
+		self.outputSuffix = outputSuffix
+	}
+	
+	/// Parallel targets get their own files, and successive session recordings are numbered, so no recording is ever overwritten.
+	func recordingUrl(_ index: Int) -> URL {
+		var suffixes: [String] = []
+		if let outputSuffix = outputSuffix {
+			suffixes.append(outputSuffix)
+		}
+		if index > 1 {
+			suffixes.append(String(index))
+		}
+		
+		guard suffixes.count > 0 else {
+			return outputTestUrl
+		}
+		
+		let suffix = suffixes.map { "-\($0)" }.joined()
+		
+		if outputTestUrl.hasDirectoryPath {
+			return outputTestUrl.appendingPathComponent("recorder_test\(suffix).js", isDirectory: false)
+		}
+		
+		let pathExtension = outputTestUrl.pathExtension
+		let baseName = outputTestUrl.deletingPathExtension().lastPathComponent
+		let fileName = pathExtension.count > 0 ? "\(baseName)\(suffix).\(pathExtension)" : "\(baseName)\(suffix)"
+		return outputTestUrl.deletingLastPathComponent().appendingPathComponent(fileName, isDirectory: false)
+	}
+	
+	/// Next to the recorded test, sharing its name.
+	func companionUrl(_ index: Int, pathExtension: String) -> URL {
+		let url = recordingUrl(index)
+		if url.hasDirectoryPath {
+			return url.appendingPathComponent("recorder_test.\(pathExtension)", isDirectory: false)
+		}
+		
+		return url.deletingPathExtension().appendingPathExtension(pathExtension)
+	}
+	
+	func eventLogUrl(_ index: Int) -> URL {
+		return companionUrl(index, pathExtension: "events")
+	}
+	
+	func videoUrl(_ index: Int) -> URL {
+		return companionUrl(index, pathExtension: "mov")
+	}
+	
+	/*
+		Startup pipeline; steps in the same stage run concurrently:
+		1. Tool lookup, Detox config parsing and publishing the recording service
+		2. Simulator lookup and boot
+		3. App installation
+		4. Framework injection detection and terminating the running app
+		The app is launched once both the setup and the recording service are ready.
+	*/
+	func start(prerequisitesGroup: DispatchGroup, recordingFinishedHandler: ((RecordingTarget) -> Void)?) {
+		let setupGroup = DispatchGroup()
+		startupQueue.async(group: setupGroup) {
+			prerequisitesGroup.wait()
+			
+			let preparedSimulatorId = prepareSimulatorId(simulatorId: self.simId, config: self.config)
+			let preparedAppBundleId = prepareappBundleId(bundleId: bundleId, config: self.config, simulatorId: preparedSimulatorId)
+			
+			//Checked before terminating the app, which would stop the recording of the other target.
+			DispatchQueue.main.sync {
+				guard resolvedTargets.insert("\(preparedSimulatorId)/\(preparedAppBundleId)").inserted else {
+					LNUsagePrintMessageAndExit(prependMessage: "The app “\(preparedAppBundleId)” on simulator “\(preparedSimulatorId)” is targeted more than once.", logLevel: .error)
+				}
+			}
+			
+			let finalStepsGroup = DispatchGroup()
+			var requiresInjection = true
+			startupQueue.async(group: finalStepsGroup) {
+				requiresInjection = appRequiresFrameworkInjection(simulatorId: preparedSimulatorId, appBundleId: preparedAppBundleId)
+			}
+			startupQueue.async(group: finalStepsGroup) {
+				self.terminateApp(simulatorId: preparedSimulatorId, appBundleId: preparedAppBundleId)
+			}
+			finalStepsGroup.wait()
+			
+			DispatchQueue.main.async {
+				self.simulatorId = preparedSimulatorId
+				self.appBundleId = preparedAppBundleId
+				self.shouldInsert = requiresInjection
+			}
+		}
+		
+		setupGroup.notify(queue: .main) {
+			self.setupFinished = true
+			self.launchRecordingIfReady()
+		}
+		
+		recordingHandler = RecordingHandler(recordingUrl: recordingUrl(recordingIndex), testName: currentTestName, streamServer: streamServer) { recordingHandler in
+			self.publishedRecordingHandler = recordingHandler
+			self.launchRecordingIfReady()
+		}
+		recordingHandler.compactsOutput = parser.bool(forKey: "compact")
+		if let recordingFinishedHandler = recordingFinishedHandler {
+			recordingHandler.recordingFinishedHandler = { _ in
+				recordingFinishedHandler(self)
+			}
+		}
+	}
+	
+	fileprivate func terminateApp(simulatorId: String, appBundleId: String) {
+		let terminateProcess = xcrunSimctlProcess()
+		terminateProcess.simctlArguments = ["terminate", simulatorId, appBundleId]
+		
+		_ = try? terminateProcess.launchAndWaitUntilExitAndReturnOutput()
+	}
+	
+	func launchRecordingIfReady() {
+		guard setupFinished, let recordingHandler = publishedRecordingHandler else {
+			return
+		}
+		
+		var args = ["launch", simulatorId!, appBundleId!, "-DTXRecStartRecording", "1", "-DTXRecTestName", currentTestName, "-DTXRecWireFormatVersion", String(RecordingHandler.wireFormatVersion), "-DTXRecWritesSummary", "1"]
+		
+		if parser.bool(forKey: "noExit") {
+			args.append(contentsOf: ["-DTXRecNoExit", "1"])
+		}
+		
+		if parser.bool(forKey: "eventLog") {
+			args.append(contentsOf: ["-DTXRecEventLogPath", eventLogUrl(recordingIndex).path])
+		}
+		
+		if parser.bool(forKey: "video") {
+			args.append(contentsOf: ["-DTXRecVideoPath", videoUrl(recordingIndex).path])
+		}
+		
+		if parser.bool(forKey: "screenshots") {
+			args.append(contentsOf: ["-DTXRecScreenshotsPath", companionUrl(recordingIndex, pathExtension: "screenshots").path])
+		}
+		
+		#if DEBUG
+		if parser.bool(forKey: "generateArtwork") {
+			args.append(contentsOf: ["-DTXGenerateArtwork", "1"])
+		}
+		#endif
+		
+		args.append(contentsOf: ["-DTXServiceName", recordingHandler.serviceName])
+		if let loopbackPort = recordingHandler.loopbackPort {
+			args.append(contentsOf: ["-DTXRecServiceHost", "127.0.0.1", "-DTXRecServicePort", String(loopbackPort)])
+		}
+		
+		let recordProcess = xcrunSimctlProcess()
+		recordProcess.simctlArguments = args
+		if shouldInsert == false || parser.bool(forKey: "noInsertLibraries") == true {
+			recordProcess.environment = [:]
+		} else {
+			let frameworkUrl : URL
+			if let frameworkOverridePath = parser.object(forKey: "recorderFrameworkPath") as? String {
+				frameworkUrl = URL(fileURLWithPath: frameworkOverridePath, isDirectory: true)
+			} else {
+				frameworkUrl = Bundle.main.executableURL!.deletingLastPathComponent().appendingPathComponent("DetoxRecorder.framework/")
+			}
+			recordProcess.environment = ["SIMCTL_CHILD_DYLD_INSERT_LIBRARIES": frameworkUrl.appendingPathComponent("DetoxRecorder").standardized.path]
+		}
+		
+		//Launching waits for the app to start, which must not hold up the other targets on the main queue.
+		startupQueue.async {
+			do {
+				try recordProcess.launchAndWaitUntilExitAndReturnOutput()
+			} catch {
+				LNUsagePrintMessageAndExit(prependMessage: "Failed starting recording: \(error.localizedDescription).", logLevel: .error)
+			}
+			
+			LNUsagePrintMessage(prependMessage: "Recording\(self.outputSuffix != nil ? " on \(self.outputSuffix!)" : "")… (CTRL+C to stop)", logLevel: .stdOut)
+		}
+	}
+	
+	/// Reuses the simulator, installed app, injection detection and published service; only the launch is repeated.
+	func startNextRecording() {
+		startupQueue.async {
+			self.terminateApp(simulatorId: self.simulatorId, appBundleId: self.appBundleId)
+			
+			DispatchQueue.main.async {
+				self.recordingIndex += 1
+				self.currentTestName = "\(testName) \(self.recordingIndex)"
+				self.recordingHandler.startNextRecording(recordingUrl: self.recordingUrl(self.recordingIndex), testName: self.currentTestName)
+				self.launchRecordingIfReady()
+			}
+		}
+	}
 }
 
-let testName = parser.object(forKey: "testName") as? String ?? "My Recorded Test"
-var args = ["launch", simulatorId, appBundleId, "-DTXRecStartRecording", "1", "-DTXRecTestName", testName]
-
-if parser.bool(forKey: "noExit") {
-	args.append(contentsOf: ["-DTXRecNoExit", "1"])
+//Every configuration is recorded on every listed simulator.
+var targetDescriptions: [(simId: String?, config: String?)] = []
+for config in configs ?? [nil] {
+	for simId in simIds ?? [nil] {
+		targetDescriptions.append((simId, config))
+	}
 }
 
-#if DEBUG
-if parser.bool(forKey: "generateArtwork") {
-	args.append(contentsOf: ["-DTXGenerateArtwork", "1"])
+let targets: [RecordingTarget] = targetDescriptions.map { description in
+	guard targetDescriptions.count > 1 else {
+		return RecordingTarget(simId: description.simId, config: description.config, outputSuffix: nil)
+	}
+	
+	let suffix = [description.config, description.simId].compactMap { $0 }.joined(separator: "-").replacingOccurrences(of: "/", with: "_")
+	return RecordingTarget(simId: description.simId, config: description.config, outputSuffix: suffix)
 }
-#endif
 
-let terminateProcess = xcrunSimctlProcess()
-terminateProcess.simctlArguments = ["terminate", simulatorId, appBundleId]
+let prerequisitesGroup = DispatchGroup()
+for binaryName in ["xcrun", "applesimutils"] {
+	startupQueue.async(group: prerequisitesGroup) {
+		_ = try? whichURLFor(binaryName: binaryName)
+	}
+}
+if configs != nil {
+	startupQueue.async(group: prerequisitesGroup) {
+		_ = DetoxRecorderCLI.detoxPackageJson
+	}
+}
 
-_ = try? terminateProcess.launchAndWaitUntilExitAndReturnOutput()
+var activeTargets = Set(targets.map { ObjectIdentifier($0) })
+var awaitingNextRecording: [RecordingTarget] = []
 
-let recordingHandler = RecordingHandler(recordingUrl: URL(fileURLWithPath: (outputTestFile as NSString).expandingTildeInPath), testName: testName) { recordingHandler in
-	args.append(contentsOf: ["-DTXServiceName", recordingHandler.serviceName])
+/// In session mode, Return starts the next recording on every target once they have all finished.
+func awaitNextRecording() {
+	LNUsagePrintMessage(prependMessage: "Press Return to record the next test (CTRL+C to quit)", logLevel: .stdOut)
 	
-	let recordProcess = xcrunSimctlProcess()
-	recordProcess.simctlArguments = args
-	if shouldInsert == false || parser.bool(forKey: "noInsertLibraries") == true {
-		recordProcess.environment = [:]
-	} else {
-		let frameworkUrl : URL
-		if let frameworkOverridePath = parser.object(forKey: "recorderFrameworkPath") as? String {
-			frameworkUrl = URL(fileURLWithPath: frameworkOverridePath, isDirectory: true)
-		} else {
-			frameworkUrl = Bundle.main.executableURL!.deletingLastPathComponent().appendingPathComponent("DetoxRecorder.framework/")
+	startupQueue.async {
+		guard readLine() != nil else {
+			exit(0)
 		}
-		recordProcess.environment = ["SIMCTL_CHILD_DYLD_INSERT_LIBRARIES": frameworkUrl.appendingPathComponent("DetoxRecorder").standardized.path]
+		
+		DispatchQueue.main.async {
+			let nextTargets = awaitingNextRecording
+			awaitingNextRecording.removeAll()
+			nextTargets.forEach {
+				activeTargets.insert(ObjectIdentifier($0))
+				$0.startNextRecording()
+			}
+		}
+	}
+}
+
+//A single non-session target keeps the original behavior of exiting as soon as its recording ends.
+let recordingFinishedHandler: ((RecordingTarget) -> Void)? = (isSession == false && targets.count == 1) ? nil : { target in
+	activeTargets.remove(ObjectIdentifier(target))
+	guard activeTargets.isEmpty else {
+		return
 	}
 	
-	do {
-		try recordProcess.launchAndWaitUntilExitAndReturnOutput()
-	} catch {
-		LNUsagePrintMessageAndExit(prependMessage: "Failed starting recording: \(error.localizedDescription).", logLevel: .error)
+	guard isSession else {
+		exit(0)
 	}
 	
-	LNUsagePrintMessage(prependMessage: "Recording… (CTRL+C to stop)", logLevel: .stdOut)
+	awaitingNextRecording = targets
+	awaitNextRecording()
 }
 
-signal(SIGINT) { _ in
-	signal(SIGINT, nil)
-	recordingHandler.printFinishAndExit(true)
+for target in targets {
+	target.start(prerequisitesGroup: prerequisitesGroup, recordingFinishedHandler: recordingFinishedHandler)
+}
+
+//Handled through a dispatch source, so the final checkpoint never runs in signal context.
+signal(SIGINT, SIG_IGN)
+let sigintSource = DispatchSource.makeSignalSource(signal: SIGINT, queue: .main)
+sigintSource.setEventHandler {
+	for (idx, target) in targets.enumerated() {
+		target.recordingHandler.finish(idx == 0)
+	}
+	exit(0)
 }
+sigintSource.resume()
 
 RunLoop.current.run(until: .distantFuture)
@@ -0,0 +1,22 @@
+//
+//  DTXCaptureHooks.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Registers event capture hooks that are only installed while recording; registering does no other work.
+/// Must be called on the main thread, typically from @c +load.
+void DTXCaptureHooksRegister(dispatch_block_t install, dispatch_block_t remove);
+
+/// Installs all registered hooks, unless already installed.
+void DTXCaptureHooksInstall(void);
+/// Removes all registered hooks, unless not installed.
+void DTXCaptureHooksRemove(void);
+
+NS_ASSUME_NONNULL_END
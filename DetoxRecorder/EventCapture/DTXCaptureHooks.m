@@ -0,0 +1,66 @@
+//
+//  DTXCaptureHooks.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXCaptureHooks.h"
+
+DTX_CREATE_LOG(CaptureHooks)
+
+static NSMutableArray<dispatch_block_t>* _installBlocks;
+static NSMutableArray<dispatch_block_t>* _removeBlocks;
+static BOOL _installed;
+
+void DTXCaptureHooksRegister(dispatch_block_t install, dispatch_block_t remove)
+{
+	if(_installBlocks == nil)
+	{
+		_installBlocks = [NSMutableArray new];
+		_removeBlocks = [NSMutableArray new];
+	}
+	
+	[_installBlocks addObject:install];
+	[_removeBlocks addObject:remove];
+	
+	//Hooks registered after recording started are installed right away.
+	if(_installed)
+	{
+		install();
+	}
+}
+
+void DTXCaptureHooksInstall(void)
+{
+	if(_installed)
+	{
+		return;
+	}
+	
+	dtx_log_info(@"Installing %@ capture hooks", @(_installBlocks.count));
+	
+	_installed = YES;
+	for(dispatch_block_t install in _installBlocks)
+	{
+		install();
+	}
+}
+
+void DTXCaptureHooksRemove(void)
+{
+	if(_installed == NO)
+	{
+		return;
+	}
+	
+	dtx_log_info(@"Removing %@ capture hooks", @(_removeBlocks.count));
+	
+	_installed = NO;
+	//Reverse order, in case hooks stack on the same methods.
+	for(dispatch_block_t remove in _removeBlocks.reverseObjectEnumerator)
+	{
+		remove();
+	}
+}
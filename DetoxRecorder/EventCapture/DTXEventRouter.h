@@ -0,0 +1,28 @@
+//
+//  DTXEventRouter.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSUInteger, DTXEventSource) {
+	DTXEventSourceControl = 1,
+	DTXEventSourceGestureRecognizer,
+	DTXEventSourceTableViewSelection,
+	DTXEventSourceReactNative,
+};
+
+/// A single touch can reach several capture sources (controls, gesture recognizers, table view selection, React Native).
+/// Each event is resolved once to the first source claiming it, which owns it; every other source must drop it before doing any work.
+/// Returns YES if the caller now owns the event. Events without a UIEvent are owned per run loop turn.
+extern BOOL DTXEventRouterClaimEvent(UIEvent* _Nullable event, DTXEventSource source);
+
+/// Returns YES the first time an event is recorded, whether or not a capture source owns it, and NO for any later attempt.
+extern BOOL DTXEventRouterShouldRecordEvent(UIEvent* event);
+
+NS_ASSUME_NONNULL_END
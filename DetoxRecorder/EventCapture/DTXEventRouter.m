@@ -0,0 +1,113 @@
+//
+//  DTXEventRouter.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXEventRouter.h"
+
+DTX_CREATE_LOG(EventRouter)
+
+static void* _DTXEventClaimKey = &_DTXEventClaimKey;
+
+@interface _DTXEventClaim : NSObject
+
+@property (nonatomic) DTXEventSource owner;
+@property (nonatomic) NSTimeInterval timestamp;
+@property (nonatomic) BOOL recorded;
+
+@end
+
+@implementation _DTXEventClaim @end
+
+static _DTXEventClaim* _nilEventClaim;
+
+//Touches are unique to their touch sequence, so the claim is tagged on the touches that end with the event.
+DTX_ALWAYS_INLINE
+static NSSet<UITouch*>* _DTXClaimedTouchesOfEvent(UIEvent* event)
+{
+	NSSet<UITouch*>* touches = event.allTouches;
+	NSSet<UITouch*>* ended = [touches objectsPassingTest:^BOOL(UITouch* touch, BOOL* stop) {
+		return touch.phase == UITouchPhaseEnded;
+	}];
+	
+	return ended.count > 0 ? ended : touches;
+}
+
+static _DTXEventClaim* _DTXClaimForEvent(UIEvent* event, BOOL create)
+{
+	if(event == nil)
+	{
+		if(_nilEventClaim == nil && create)
+		{
+			_nilEventClaim = [_DTXEventClaim new];
+			//Anything reported without an event during this run loop turn is the same interaction.
+			dispatch_async(dispatch_get_main_queue(), ^{
+				_nilEventClaim = nil;
+			});
+		}
+		
+		return _nilEventClaim;
+	}
+	
+	NSSet<UITouch*>* touches = _DTXClaimedTouchesOfEvent(event);
+	for(UITouch* touch in touches)
+	{
+		_DTXEventClaim* claim = [touch dtx_attachedObjectForKey:_DTXEventClaimKey];
+		if(claim != nil)
+		{
+			return claim;
+		}
+	}
+	
+	//UIKit reuses event objects, so a claim tagged on the event itself is only valid for its timestamp.
+	_DTXEventClaim* claim = [event dtx_attachedObjectForKey:_DTXEventClaimKey];
+	if(claim != nil && claim.timestamp == event.timestamp)
+	{
+		return claim;
+	}
+	
+	if(create == NO)
+	{
+		return nil;
+	}
+	
+	claim = [_DTXEventClaim new];
+	claim.timestamp = event.timestamp;
+	for(UITouch* touch in touches)
+	{
+		[touch dtx_attachObject:claim forKey:_DTXEventClaimKey];
+	}
+	[event dtx_attachObject:claim forKey:_DTXEventClaimKey];
+	
+	return claim;
+}
+
+BOOL DTXEventRouterClaimEvent(UIEvent* event, DTXEventSource source)
+{
+	_DTXEventClaim* claim = _DTXClaimForEvent(event, YES);
+	if(claim.owner != 0)
+	{
+		dtx_log_info(@"Dropping event from source %@, owned by source %@", @(source), @(claim.owner));
+		return NO;
+	}
+	
+	claim.owner = source;
+	
+	return YES;
+}
+
+BOOL DTXEventRouterShouldRecordEvent(UIEvent* event)
+{
+	_DTXEventClaim* claim = _DTXClaimForEvent(event, YES);
+	if(claim.recorded)
+	{
+		return NO;
+	}
+	
+	claim.recorded = YES;
+	
+	return YES;
+}
@@ -0,0 +1,31 @@
+//
+//  DTXScrollCompletionDispatcher.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+extern NSString* const DTXScrollCompletionDidEndSmoothScrolling;
+extern NSString* const DTXScrollCompletionAnimationEnded;
+extern NSString* const DTXScrollCompletionDidEndDecelerating;
+
+typedef void (^DTXScrollCompletionBlock)(UIScrollView* scrollView);
+
+/// Runs a block once a scroll view posts one of the completion notifications above.
+/// A single observer per notification serves all scroll views, and scroll views are held weakly,
+/// so completions that never arrive do not leak observers.
+@interface DTXScrollCompletionDispatcher : NSObject
+
+/// The block must not capture the scroll view strongly, or it will keep it alive; it is passed to the block instead.
+/// Replaces any pending completion of the same scroll view for the same notification.
++ (void)performWhenScrollView:(UIScrollView*)scrollView postsNotification:(NSString*)notificationName block:(DTXScrollCompletionBlock)block;
++ (void)cancelCompletionForScrollView:(UIScrollView*)scrollView notification:(NSString*)notificationName;
+
+@end
+
+NS_ASSUME_NONNULL_END
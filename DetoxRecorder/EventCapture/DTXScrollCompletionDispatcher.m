@@ -0,0 +1,66 @@
+//
+//  DTXScrollCompletionDispatcher.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXScrollCompletionDispatcher.h"
+
+NSString* const DTXScrollCompletionDidEndSmoothScrolling = @"DidEndSmoothScrolling";
+NSString* const DTXScrollCompletionAnimationEnded = @"_UIScrollViewAnimationEndedNotification";
+NSString* const DTXScrollCompletionDidEndDecelerating = @"_UIScrollViewDidEndDeceleratingNotification";
+
+//Notification name to pending completions, keyed by scroll view
+static NSMutableDictionary<NSString*, NSMapTable<UIScrollView*, DTXScrollCompletionBlock>*>* _pendingCompletions;
+
+DTX_DIRECT_MEMBERS
+@implementation DTXScrollCompletionDispatcher
+
++ (NSMapTable<UIScrollView*, DTXScrollCompletionBlock>*)_completionsForNotification:(NSString*)notificationName
+{
+	if(_pendingCompletions == nil)
+	{
+		_pendingCompletions = [NSMutableDictionary new];
+	}
+	
+	NSMapTable<UIScrollView*, DTXScrollCompletionBlock>* rv = _pendingCompletions[notificationName];
+	if(rv == nil)
+	{
+		rv = [NSMapTable weakToStrongObjectsMapTable];
+		_pendingCompletions[notificationName] = rv;
+		
+		//Installed once per notification name, and kept for the lifetime of the process.
+		[NSNotificationCenter.defaultCenter addObserverForName:notificationName object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+			if(rv.count == 0 || [note.object isKindOfClass:UIScrollView.class] == NO)
+			{
+				return;
+			}
+			
+			UIScrollView* scrollView = note.object;
+			DTXScrollCompletionBlock block = [rv objectForKey:scrollView];
+			if(block == nil)
+			{
+				return;
+			}
+			
+			[rv removeObjectForKey:scrollView];
+			block(scrollView);
+		}];
+	}
+	
+	return rv;
+}
+
++ (void)performWhenScrollView:(UIScrollView*)scrollView postsNotification:(NSString*)notificationName block:(DTXScrollCompletionBlock)block
+{
+	[[self _completionsForNotification:notificationName] setObject:[block copy] forKey:scrollView];
+}
+
++ (void)cancelCompletionForScrollView:(UIScrollView*)scrollView notification:(NSString*)notificationName
+{
+	[_pendingCompletions[notificationName] removeObjectForKey:scrollView];
+}
+
+@end
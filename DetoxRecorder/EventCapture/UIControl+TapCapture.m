@@ -10,6 +10,8 @@
 @import ObjectiveC;
 #import "DTXUIInteractionRecorder.h"
 #import "DTXCaptureControlWindow.h"
+#import "DTXEventRouter.h"
+#import "DTXCaptureHooks.h"
 
 @interface UIControl ()
 
@@ -163,7 +165,7 @@ __unused static NSString* translateControlEventsToString(UIControlEvents arg)
 	
 	if([self isKindOfClass:UISegmentedControl.class])
 	{
-		if(arg1 == UIControlEventValueChanged)
+		if(arg1 == UIControlEventValueChanged && DTXEventRouterClaimEvent(arg2, DTXEventSourceControl))
 		{
 			UISegmentedControl* segmented = (id)self;
 			UIView* tapped = [segmented accessibilityElementAtIndex:segmented.selectedSegmentIndex];
@@ -190,7 +192,7 @@ __unused static NSString* translateControlEventsToString(UIControlEvents arg)
 		{
 			[DTXUIInteractionRecorder addDatePickerDateChangeEvent:(id)self withEvent:arg2];
 		}
-		else
+		else if(DTXEventRouterClaimEvent(arg2, DTXEventSourceControl))
 		{
 			[DTXUIInteractionRecorder addControlTapWithControl:self withEvent:arg2];
 		}
@@ -200,7 +202,11 @@ __unused static NSString* translateControlEventsToString(UIControlEvents arg)
 + (void)load
 {
 	@autoreleasepool {
-		DTXSwizzleMethod(self, @selector(_sendActionsForEvents:withEvent:), @selector(_dtxrec_sendActionsForEvents:withEvent:), NULL);
+		//Swizzling again restores the original implementation.
+		dispatch_block_t toggle = ^{
+			DTXSwizzleMethod(self, @selector(_sendActionsForEvents:withEvent:), @selector(_dtxrec_sendActionsForEvents:withEvent:), NULL);
+		};
+		DTXCaptureHooksRegister(toggle, toggle);
 	}
 }
 
@@ -10,8 +10,46 @@
 #import "DTXUIInteractionRecorder.h"
 #import "UIPickerView+RecorderUtils.h"
 #import "DTXAppleInternals.h"
+#import "DTXEventRouter.h"
+#import "DTXScrollCompletionDispatcher.h"
+#import "DTXCaptureHooks.h"
+#import "UIWindow+RecorderUtils.h"
 @import ObjectiveC;
 
+//Capture state of a single gesture recognizer, allocated once and then updated in place
+@interface _DTXGestureCaptureState : NSObject
+{
+@public
+	BOOL _hasScrollOffsetAtBegin;
+	CGPoint _scrollOffsetAtBegin;
+	
+	BOOL _rnHasTapGesture;
+	//Zero when no long press is pending
+	NSTimeInterval _rnLongPressDeadline;
+	BOOL _rnLongPressQueued;
+	UITouch* _rnLongPressTouch;
+	UIEvent* _rnLongPressEvent;
+}
+
+@end
+
+@implementation _DTXGestureCaptureState @end
+
+static void* DTXGestureCaptureStateKey = &DTXGestureCaptureStateKey;
+
+DTX_ALWAYS_INLINE
+static _DTXGestureCaptureState* DTXGestureCaptureStateForRecognizer(UIGestureRecognizer* gr)
+{
+	_DTXGestureCaptureState* rv = objc_getAssociatedObject(gr, DTXGestureCaptureStateKey);
+	if(rv == nil)
+	{
+		rv = [_DTXGestureCaptureState new];
+		objc_setAssociatedObject(gr, DTXGestureCaptureStateKey, rv, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+	}
+	
+	return rv;
+}
+
 @implementation UIGestureRecognizer (GestureCapture)
 
 __unused static NSString* translateGestureRecognizerStateToString(UIGestureRecognizerState arg)
@@ -32,49 +70,22 @@ __unused static NSString* translateGestureRecognizerStateToString(UIGestureRecog
 	}
 }
 
-static void* DTXScrollViewOffsetAtBegin = &DTXScrollViewOffsetAtBegin;
-static void* DTXScrollViewDecelerationObserver = &DTXScrollViewDecelerationObserver;
-
-static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
+//Recognizers with capture targets, so the targets can be removed once recording stops
+static NSHashTable<UIGestureRecognizer*>* _capturingRecognizers;
 
-- (void)_dtxrec_setDecelerationObserver:(id)newObserver
+- (void)_dtxrec_setView:(UIView*)view
 {
-	id prevObserver = objc_getAssociatedObject(self, DTXScrollViewDecelerationObserver);
-	if(prevObserver)
-	{
-		[NSNotificationCenter.defaultCenter removeObserver:prevObserver];
-	}
+	[self _dtxrec_setView:view];
 	
-	objc_setAssociatedObject(self, DTXScrollViewDecelerationObserver, newObserver, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-}
-
-- (NSValue*)_dtxrec_scrollOffsetValueAtGestureBegin
-{
-	return objc_getAssociatedObject(self, DTXScrollViewOffsetAtBegin);
-}
-
-- (void)_dtxrec_setScrollOffsetValueAtGestureBegin:(NSValue*)value
-{
-	objc_setAssociatedObject(self, DTXScrollViewOffsetAtBegin, value, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-}
-
-- (NSDate*)_dtxrec_longPressDateAtGestureBegin
-{
-	return objc_getAssociatedObject(self, DTXLongPressDateAtBegin);
-}
-
-- (void)_dtxrec_setLongPressDateAtGestureBegin:(NSDate*)value
-{
-	objc_setAssociatedObject(self, DTXLongPressDateAtBegin, value, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+	[self _dtxrec_addCaptureTargetForView:view];
 }
 
-- (void)_dtxrec_setView:(UIView*)view
+- (void)_dtxrec_addCaptureTargetForView:(UIView*)view
 {
-	[self _dtxrec_setView:view];
-	
+	SEL action = NULL;
 	if([self isKindOfClass:UITapGestureRecognizer.class])
 	{
-		[self addTarget:self action:@selector(_dtxrec_tapAction:)];
+		action = @selector(_dtxrec_tapAction:);
 	}
 	else if([self isKindOfClass:UILongPressGestureRecognizer.class])
 	{
@@ -85,11 +96,32 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 			return;
 		}
 		
-		[self addTarget:self action:@selector(_dtxrec_longPressAction:)];
+		action = @selector(_dtxrec_longPressAction:);
 	}
 	else if([self isKindOfClass:UIPanGestureRecognizer.class])
 	{
-		[self addTarget:self action:@selector(_dtxrec_panAction:)];
+		action = @selector(_dtxrec_panAction:);
+	}
+	
+	if(action == NULL)
+	{
+		return;
+	}
+	
+	[self addTarget:self action:action];
+	[_capturingRecognizers addObject:self];
+}
+
++ (void)_dtxrec_addCaptureTargetsInHierarchy:(UIView*)view
+{
+	for(UIGestureRecognizer* gr in view.gestureRecognizers)
+	{
+		[gr _dtxrec_addCaptureTargetForView:view];
+	}
+	
+	for(UIView* subview in view.subviews)
+	{
+		[self _dtxrec_addCaptureTargetsInHierarchy:subview];
 	}
 }
 
@@ -109,12 +141,13 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 			NSInteger component = [pickerView dtxrec_componentForColumnView:self.view];
 			UITableView* tv = [pickerView tableViewForColumn:component];
 			
-			__block id observer;
-			observer = [NSNotificationCenter.defaultCenter addObserverForName:@"DidEndSmoothScrolling" object:tv queue:nil usingBlock:^(NSNotification * _Nonnull note) {
-				
-				[DTXUIInteractionRecorder addPickerViewValueChangeEvent:pickerView component:component withEvent:nil];
-				
-				[NSNotificationCenter.defaultCenter removeObserver:observer];
+			__weak UIPickerView* weakPickerView = pickerView;
+			[DTXScrollCompletionDispatcher performWhenScrollView:tv postsNotification:DTXScrollCompletionDidEndSmoothScrolling block:^(UIScrollView* scrollView) {
+				UIPickerView* strongPickerView = weakPickerView;
+				if(strongPickerView != nil)
+				{
+					[DTXUIInteractionRecorder addPickerViewValueChangeEvent:strongPickerView component:component withEvent:nil];
+				}
 			}];
 		}
 	}
@@ -125,7 +158,8 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 		{
 			UIScrollView* scrollView = (id)self.view;
 			
-			CGPoint contentOffsetAtBegin = [[self _dtxrec_scrollOffsetValueAtGestureBegin] CGPointValue];
+			_DTXGestureCaptureState* state = DTXGestureCaptureStateForRecognizer(self);
+			CGPoint contentOffsetAtBegin = state->_hasScrollOffsetAtBegin ? state->_scrollOffsetAtBegin : CGPointZero;
 			
 			if(scrollView.isDecelerating == NO)
 			{
@@ -133,16 +167,11 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 			}
 			else
 			{
-				id observer = [NSNotificationCenter.defaultCenter addObserverForName:@"_UIScrollViewDidEndDeceleratingNotification" object:scrollView queue:nil usingBlock:^(NSNotification * _Nonnull note) {
-					[self _dtxrec_setScrollOffsetValueAtGestureBegin:nil];
+				[DTXScrollCompletionDispatcher performWhenScrollView:scrollView postsNotification:DTXScrollCompletionDidEndDecelerating block:^(UIScrollView* scrollView) {
+					state->_hasScrollOffsetAtBegin = NO;
 					
 					[DTXUIInteractionRecorder addScrollEvent:scrollView fromOriginOffset:contentOffsetAtBegin withEvent:self._activeEvents.anyObject];
-					
-					
-					[self _dtxrec_setDecelerationObserver:nil];
 				}];
-				
-				[self _dtxrec_setDecelerationObserver:observer];
 			}
 		}
 	}
@@ -174,18 +203,23 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 				
 				NSInteger component = [pickerView dtxrec_componentForColumnView:tv._containerView];
 				
-				__block id observer;
-				observer = [NSNotificationCenter.defaultCenter addObserverForName:@"_UIScrollViewAnimationEndedNotification" object:tv queue:nil usingBlock:^(NSNotification * _Nonnull note) {
-					
-					[DTXUIInteractionRecorder addPickerViewValueChangeEvent:pickerView component:component withEvent:nil];
-					
-					[NSNotificationCenter.defaultCenter removeObserver:observer];
+				__weak UIPickerView* weakPickerView = pickerView;
+				[DTXScrollCompletionDispatcher performWhenScrollView:tv postsNotification:DTXScrollCompletionAnimationEnded block:^(UIScrollView* scrollView) {
+					UIPickerView* strongPickerView = weakPickerView;
+					if(strongPickerView != nil)
+					{
+						[DTXUIInteractionRecorder addPickerViewValueChangeEvent:strongPickerView component:component withEvent:nil];
+					}
 				}];
 			}
 		}
 		else if(self.view != nil) //User tapped on another view
 		{
-			[DTXUIInteractionRecorder addGestureRecognizerTap:(id)self withEvent:self._activeEvents.anyObject];
+			UIEvent* event = self._activeEvents.anyObject;
+			if(DTXEventRouterClaimEvent(event, DTXEventSourceGestureRecognizer))
+			{
+				[DTXUIInteractionRecorder addGestureRecognizerTap:(id)self withEvent:event];
+			}
 		}
 	}
 }
@@ -193,7 +227,28 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 + (void)load
 {
 	@autoreleasepool {
-		DTXSwizzleMethod(self, @selector(setView:), @selector(_dtxrec_setView:), NULL);
+		_capturingRecognizers = [NSHashTable weakObjectsHashTable];
+		
+		DTXCaptureHooksRegister(^{
+			DTXSwizzleMethod(self, @selector(setView:), @selector(_dtxrec_setView:), NULL);
+			
+			//Recognizers created before recording started never went through setView:.
+			for(UIWindow* window in UIWindow.dtxrec_allWindows)
+			{
+				[self _dtxrec_addCaptureTargetsInHierarchy:window];
+			}
+		}, ^{
+			//Swizzling again restores the original implementation.
+			DTXSwizzleMethod(self, @selector(setView:), @selector(_dtxrec_setView:), NULL);
+			
+			for(UIGestureRecognizer* gr in _capturingRecognizers.allObjects)
+			{
+				[gr removeTarget:gr action:@selector(_dtxrec_tapAction:)];
+				[gr removeTarget:gr action:@selector(_dtxrec_longPressAction:)];
+				[gr removeTarget:gr action:@selector(_dtxrec_panAction:)];
+			}
+			[_capturingRecognizers removeAllObjects];
+		});
 	}
 }
 
@@ -206,13 +261,16 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 {
 	if(self.panGestureRecognizer.state == UIGestureRecognizerStateBegan)
 	{
-		//Remove previous deceleration observer if user continued dragging while scroll view was decelerating.
-		[self.panGestureRecognizer _dtxrec_setDecelerationObserver:nil];
+		_DTXGestureCaptureState* state = DTXGestureCaptureStateForRecognizer(self.panGestureRecognizer);
+		
+		//Remove previous deceleration completion if user continued dragging while scroll view was decelerating.
+		[DTXScrollCompletionDispatcher cancelCompletionForScrollView:self notification:DTXScrollCompletionDidEndDecelerating];
 		
 		//For some reason UIGestureRecognizerStateBegan is called twice for scroll view pan gesture regonizers.
-		if([self.panGestureRecognizer _dtxrec_scrollOffsetValueAtGestureBegin] == nil)
+		if(state->_hasScrollOffsetAtBegin == NO)
 		{
-			[self.panGestureRecognizer _dtxrec_setScrollOffsetValueAtGestureBegin:@(self.contentOffset)];
+			state->_scrollOffsetAtBegin = self.contentOffset;
+			state->_hasScrollOffsetAtBegin = YES;
 		}
 	}
 	
@@ -222,73 +280,175 @@ static void* DTXLongPressDateAtBegin = &DTXLongPressDateAtBegin;
 + (void)load
 {
 	@autoreleasepool {
-		DTXSwizzleMethod(self, @selector(_updatePanGesture), @selector(_dtxrec_updatePanGesture), NULL);
+		//Swizzling again restores the original implementation.
+		dispatch_block_t toggle = ^{
+			DTXSwizzleMethod(self, @selector(_updatePanGesture), @selector(_dtxrec_updatePanGesture), NULL);
+		};
+		DTXCaptureHooksRegister(toggle, toggle);
 	}
 }
 
 @end
 
-static void* DTXRNGestureRecognizerHasTapGesture = &DTXRNGestureRecognizerHasTapGesture;
-static void* DTXRNGestureRecognizerLongPressTimer = &DTXRNGestureRecognizerLongPressTimer;
-
 @interface UIGestureRecognizer (RNGestureCapture) @end
 @implementation UIGestureRecognizer (RNGestureCapture)
 
-- (void)_dtxrec_clearTimer
+//Pending React Native long press candidates, serviced by a single shared timer.
+//Each state is queued at most once; a cancelled or postponed candidate is only dealt with once the timer fires.
+static NSMutableArray<_DTXGestureCaptureState*>* _rnLongPressQueue;
+static NSTimer* _rnLongPressQueueTimer;
+static NSTimeInterval _rnLongPressQueueArmedDeadline;
+
+static void DTXRNLongPressQueueService(void);
+
+static void DTXRNLongPressQueueArm(NSTimeInterval deadline)
+{
+	if(_rnLongPressQueueTimer == nil)
+	{
+		//Repeating, so that the timer stays valid after firing and only its fire date needs to change.
+		_rnLongPressQueueTimer = [[NSTimer alloc] initWithFireDate:NSDate.distantFuture interval:3600 repeats:YES block:^(NSTimer * _Nonnull timer) {
+			DTXRNLongPressQueueService();
+		}];
+		[NSRunLoop.mainRunLoop addTimer:_rnLongPressQueueTimer forMode:NSDefaultRunLoopMode];
+	}
+	
+	if(_rnLongPressQueueArmedDeadline != 0 && _rnLongPressQueueArmedDeadline <= deadline)
+	{
+		return;
+	}
+	
+	_rnLongPressQueueArmedDeadline = deadline;
+	_rnLongPressQueueTimer.fireDate = [NSDate dateWithTimeIntervalSinceReferenceDate:deadline];
+}
+
+DTX_ALWAYS_INLINE
+static void DTXRNLongPressQueueCancel(_DTXGestureCaptureState* state)
+{
+	state->_rnLongPressDeadline = 0;
+	state->_rnLongPressTouch = nil;
+	state->_rnLongPressEvent = nil;
+}
+
+DTX_ALWAYS_INLINE
+static void DTXRNLongPressQueueInsert(_DTXGestureCaptureState* state, UITouch* touch, UIEvent* event, NSTimeInterval delay)
+{
+	state->_rnLongPressDeadline = NSDate.timeIntervalSinceReferenceDate + delay;
+	state->_rnLongPressTouch = touch;
+	state->_rnLongPressEvent = event;
+	
+	if(state->_rnLongPressQueued == NO)
+	{
+		if(_rnLongPressQueue == nil)
+		{
+			_rnLongPressQueue = [NSMutableArray new];
+		}
+		
+		[_rnLongPressQueue addObject:state];
+		state->_rnLongPressQueued = YES;
+	}
+	
+	DTXRNLongPressQueueArm(state->_rnLongPressDeadline);
+}
+
+static void DTXRNLongPressQueueService(void)
 {
-	NSTimer* timer = objc_getAssociatedObject(self, DTXRNGestureRecognizerLongPressTimer);
-	[timer invalidate];
-	objc_setAssociatedObject(self, DTXRNGestureRecognizerLongPressTimer, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+	_rnLongPressQueueArmedDeadline = 0;
+	
+	NSTimeInterval now = NSDate.timeIntervalSinceReferenceDate;
+	NSTimeInterval nextDeadline = 0;
+	
+	NSUInteger count = _rnLongPressQueue.count;
+	for(NSUInteger idx = 0; idx < count; idx++)
+	{
+		_DTXGestureCaptureState* state = _rnLongPressQueue.firstObject;
+		[_rnLongPressQueue removeObjectAtIndex:0];
+		
+		NSTimeInterval deadline = state->_rnLongPressDeadline;
+		if(deadline > now)
+		{
+			//Touched again since it was queued
+			[_rnLongPressQueue addObject:state];
+			nextDeadline = nextDeadline == 0 ? deadline : MIN(nextDeadline, deadline);
+			
+			continue;
+		}
+		
+		state->_rnLongPressQueued = NO;
+		
+		if(deadline == 0)
+		{
+			continue;
+		}
+		
+		UITouch* touch = state->_rnLongPressTouch;
+		UIEvent* event = state->_rnLongPressEvent;
+		DTXRNLongPressQueueCancel(state);
+		state->_rnHasTapGesture = NO;
+		
+		[DTXUIInteractionRecorder addRNGestureRecognizerLongPressWithTouch:touch withEvent:event];
+	}
+	
+	if(nextDeadline != 0)
+	{
+		DTXRNLongPressQueueArm(nextDeadline);
+	}
+	else
+	{
+		_rnLongPressQueueTimer.fireDate = NSDate.distantFuture;
+	}
 }
 
 - (void)_dtxrec_rn_touchesBegan:(NSSet<UITouch *> *)touches withEvent:(UIEvent *)event
 {
 	UITouch* touch = touches.anyObject;
+	_DTXGestureCaptureState* state = DTXGestureCaptureStateForRecognizer(self);
 	
-	NSTimer* longPressTimer = [NSTimer scheduledTimerWithTimeInterval:NSUserDefaults.standardUserDefaults.dtxrec_rnLongPressDelay repeats:NO block:^(NSTimer * _Nonnull timer) {
-		[DTXUIInteractionRecorder addRNGestureRecognizerLongPressWithTouch:touch withEvent:event];
-		objc_setAssociatedObject(self, DTXRNGestureRecognizerHasTapGesture, @NO, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-		[self _dtxrec_clearTimer];
-	}];
+	DTXRNLongPressQueueInsert(state, touch, event, DTXRecorderSettingsCurrent->rnLongPressDelay);
+	state->_rnHasTapGesture = touches.count == 1;
 	
-	objc_setAssociatedObject(self, DTXRNGestureRecognizerLongPressTimer, longPressTimer, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-	objc_setAssociatedObject(self, DTXRNGestureRecognizerHasTapGesture, @(touches.count == 1), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
 	[self _dtxrec_rn_touchesBegan:touches withEvent:event];
 }
 
 - (void)_dtxrec_rn_touchesCancelled:(NSSet<UITouch *> *)touches withEvent:(UIEvent *)event
 {
 	[self _dtxrec_rn_touchesCancelled:touches withEvent:event];
-	objc_setAssociatedObject(self, DTXRNGestureRecognizerHasTapGesture, @NO, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-	[self _dtxrec_clearTimer];
+	
+	_DTXGestureCaptureState* state = DTXGestureCaptureStateForRecognizer(self);
+	state->_rnHasTapGesture = NO;
+	DTXRNLongPressQueueCancel(state);
 }
 
 - (void)_dtxrec_rn_touchesMoved:(NSSet<UITouch *> *)touches withEvent:(UIEvent *)event
 {
 	[self _dtxrec_rn_touchesMoved:touches withEvent:event];
-//	objc_setAssociatedObject(self, DTXRNGestureRecognizerHasTapGesture, @NO, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-//	[self _dtxrec_clearTimer];
+//	DTXGestureCaptureStateForRecognizer(self)->_rnHasTapGesture = NO;
+//	DTXRNLongPressQueueCancel(DTXGestureCaptureStateForRecognizer(self));
 }
 
 - (void)_dtxrec_rn_touchesEnded:(NSSet<UITouch *> *)touches withEvent:(UIEvent *)event
 {
 	[self _dtxrec_rn_touchesEnded:touches withEvent:event];
 	
-	BOOL hasTapGesture = [objc_getAssociatedObject(self, DTXRNGestureRecognizerHasTapGesture) boolValue];
-	if(hasTapGesture && touches.count == 1)
+	_DTXGestureCaptureState* state = DTXGestureCaptureStateForRecognizer(self);
+	if(state->_rnHasTapGesture && touches.count == 1 && DTXEventRouterClaimEvent(event, DTXEventSourceReactNative))
 	{
 		[DTXUIInteractionRecorder addRNGestureRecognizerTapWithTouch:touches.anyObject withEvent:event];
 	}
 	
-	[self _dtxrec_clearTimer];
+	DTXRNLongPressQueueCancel(state);
 }
 
 + (void)load
 {
 	@autoreleasepool {
 		Class RNGestureRecognizerClass = NSClassFromString(@"RCTTouchHandler");
-		if(RNGestureRecognizerClass != nil)
+		if(RNGestureRecognizerClass == nil)
 		{
+			return;
+		}
+		
+		//Exchanging again restores the original implementations.
+		dispatch_block_t toggle = ^{
 			Method m = class_getInstanceMethod(RNGestureRecognizerClass, @selector(touchesBegan:withEvent:));
 			Method m2 = class_getInstanceMethod(self, @selector(_dtxrec_rn_touchesBegan:withEvent:));
 			method_exchangeImplementations(m, m2);
@@ -304,7 +464,8 @@ static void* DTXRNGestureRecognizerLongPressTimer = &DTXRNGestureRecognizerLongP
 			m = class_getInstanceMethod(RNGestureRecognizerClass, @selector(touchesEnded:withEvent:));
 			m2 = class_getInstanceMethod(self, @selector(_dtxrec_rn_touchesEnded:withEvent:));
 			method_exchangeImplementations(m, m2);
-		}
+		};
+		DTXCaptureHooksRegister(toggle, toggle);
 	}
 }
 
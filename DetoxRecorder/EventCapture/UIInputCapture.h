@@ -10,4 +10,7 @@
 
 @interface UIInputCapture : NSObject
 
+/// Records the debounced text change, if any, immediately.
++ (void)flushPendingTextChange;
+
 @end
@@ -8,15 +8,116 @@
 
 #import "UIInputCapture.h"
 #import "DTXUIInteractionRecorder.h"
+#import "DTXCaptureHooks.h"
+#import "UIWindow+RecorderUtils.h"
 @import UIKit;
 
 static UIResponder* currentFirstResponder;
+static id<NSObject> firstResponderObserver;
+
+//Text changes are recorded once typing pauses, or when the responder changes
+static const NSTimeInterval DTXTextChangeDebounceInterval = 0.5;
+static UIView<UITextInput>* pendingTextChangeView;
+static NSTimer* pendingTextChangeTimer;
+
+//Text views may hold long documents; their text is mirrored from the ranges of text storage edits, rather than read in full on every change.
+static UITextView* trackedTextView;
+static NSMutableString* trackedText;
+static id<NSObject> textStorageObserver;
 
 @implementation UIInputCapture
 
++ (void)flushPendingTextChange
+{
+	[pendingTextChangeTimer invalidate];
+	pendingTextChangeTimer = nil;
+	
+	UIView<UITextInput>* view = pendingTextChangeView;
+	pendingTextChangeView = nil;
+	
+	if(view == nil)
+	{
+		return;
+	}
+	
+	if(view == trackedTextView && trackedText != nil)
+	{
+		//Only the final text is materialized, once per typing pause.
+		[DTXUIInteractionRecorder addTextChangeEvent:view text:trackedText.copy];
+	}
+	else
+	{
+		[DTXUIInteractionRecorder addTextChangeEvent:view];
+		
+		if(view == trackedTextView)
+		{
+			trackedText = trackedTextView.textStorage.string.mutableCopy;
+		}
+	}
+}
+
++ (void)_textStorageDidProcessEditing:(NSNotification*)note
+{
+	NSTextStorage* textStorage = note.object;
+	if((textStorage.editedMask & NSTextStorageEditedCharacters) == 0 || trackedText == nil)
+	{
+		return;
+	}
+	
+	NSRange editedRange = textStorage.editedRange;
+	NSRange replacedRange = NSMakeRange(editedRange.location, editedRange.length - textStorage.changeInLength);
+	if(NSMaxRange(replacedRange) > trackedText.length)
+	{
+		//Out of sync; the text is read in full when the change is recorded.
+		trackedText = nil;
+		return;
+	}
+	
+	[trackedText replaceCharactersInRange:replacedRange withString:[textStorage.string substringWithRange:editedRange]];
+	
+	if(trackedText.length != textStorage.length)
+	{
+		trackedText = nil;
+	}
+}
+
++ (void)_setTrackedTextView:(UITextView*)textView
+{
+	if(textStorageObserver != nil)
+	{
+		[NSNotificationCenter.defaultCenter removeObserver:textStorageObserver];
+		textStorageObserver = nil;
+	}
+	
+	trackedTextView = textView;
+	trackedText = textView.textStorage.string.mutableCopy;
+	
+	if(textView != nil)
+	{
+		textStorageObserver = [NSNotificationCenter.defaultCenter addObserverForName:NSTextStorageDidProcessEditingNotification object:textView.textStorage queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+			[UIInputCapture _textStorageDidProcessEditing:note];
+		}];
+	}
+}
+
 + (void)_handleTextChangeForView:(UIView<UITextInput>*)view
 {
-	[DTXUIInteractionRecorder addTextChangeEvent:view];
+	if(pendingTextChangeView != nil && pendingTextChangeView != view)
+	{
+		[self flushPendingTextChange];
+	}
+	
+	pendingTextChangeView = view;
+	
+	if(pendingTextChangeTimer != nil)
+	{
+		pendingTextChangeTimer.fireDate = [NSDate dateWithTimeIntervalSinceNow:DTXTextChangeDebounceInterval];
+		return;
+	}
+	
+	pendingTextChangeTimer = [NSTimer scheduledTimerWithTimeInterval:DTXTextChangeDebounceInterval repeats:NO block:^(NSTimer * _Nonnull timer) {
+		[UIInputCapture flushPendingTextChange];
+	}];
 }
 
 + (void)_textFieldContentDidChange:(UITextField*)textField
@@ -29,38 +130,57 @@ static UIResponder* currentFirstResponder;
 	[self _handleTextChangeForView:note.object];
 }
 
-+ (void)load
++ (void)_firstResponderDidChange:(UIResponder*)firstResponder
 {
-	[NSNotificationCenter.defaultCenter addObserverForName:@"UIWindowFirstResponderDidChangeNotification" object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
-		__kindof UIResponder* oldResponder = currentFirstResponder;
-		currentFirstResponder = note.userInfo[@"UIWindowFirstResponderUserInfoKey"];
-		
-		if([oldResponder isKindOfClass:UITextField.class])
-		{
-			UITextField* textField = (id)oldResponder;
-			[textField removeTarget:self action:@selector(_textFieldContentDidChange:) forControlEvents:UIControlEventEditingChanged];
-		}
+	[UIInputCapture flushPendingTextChange];
+	
+	__kindof UIResponder* oldResponder = currentFirstResponder;
+	currentFirstResponder = firstResponder;
+	
+	if([oldResponder isKindOfClass:UITextField.class])
+	{
+		UITextField* textField = (id)oldResponder;
+		[textField removeTarget:self action:@selector(_textFieldContentDidChange:) forControlEvents:UIControlEventEditingChanged];
+	}
+	
+	if([currentFirstResponder isKindOfClass:UITextField.class])
+	{
+		UITextField* textField = (id)currentFirstResponder;
+		[textField addTarget:self action:@selector(_textFieldContentDidChange:) forControlEvents:UIControlEventEditingChanged];
+	}
+	
+	if([oldResponder isKindOfClass:UITextView.class])
+	{
+		UITextView* textView = (id)oldResponder;
+		[NSNotificationCenter.defaultCenter removeObserver:self name:UITextViewTextDidChangeNotification object:textView];
+		[self _setTrackedTextView:nil];
+	}
+	
+	if([currentFirstResponder isKindOfClass:UITextView.class])
+	{
+		UITextView* textView = (id)currentFirstResponder;
+		[NSNotificationCenter.defaultCenter addObserver:self selector:@selector(_textViewContentDidChange:) name:UITextViewTextDidChangeNotification object:textView];
+		[self _setTrackedTextView:textView];
+	}
 
-		if([currentFirstResponder isKindOfClass:UITextField.class])
-		{
-			UITextField* textField = (id)currentFirstResponder;
-			[textField addTarget:self action:@selector(_textFieldContentDidChange:) forControlEvents:UIControlEventEditingChanged];
-		}
-		
-		if([oldResponder isKindOfClass:UITextView.class])
-		{
-			UITextView* textView = (id)oldResponder;
-			[NSNotificationCenter.defaultCenter removeObserver:self name:UITextViewTextDidChangeNotification object:textView];
-		}
+//	NSLog(@"🤦‍♂️ %@", currentFirstResponder);
+}
+
++ (void)load
+{
+	DTXCaptureHooksRegister(^{
+		firstResponderObserver = [NSNotificationCenter.defaultCenter addObserverForName:@"UIWindowFirstResponderDidChangeNotification" object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+			[UIInputCapture _firstResponderDidChange:note.userInfo[@"UIWindowFirstResponderUserInfoKey"]];
+		}];
 		
-		if([currentFirstResponder isKindOfClass:UITextView.class])
-		{
-			UITextView* textView = (id)currentFirstResponder;
-			[NSNotificationCenter.defaultCenter addObserver:self selector:@selector(_textViewContentDidChange:) name:UITextViewTextDidChangeNotification object:textView];
-		}
+		//Editing may already be in progress when recording starts.
+		[UIInputCapture _firstResponderDidChange:[UIWindow.dtxrec_keyWindow valueForKey:@"firstResponder"]];
+	}, ^{
+		[NSNotificationCenter.defaultCenter removeObserver:firstResponderObserver];
+		firstResponderObserver = nil;
 		
-//		NSLog(@"🤦‍♂️ %@", currentFirstResponder);
-	}];
+		[UIInputCapture _firstResponderDidChange:nil];
+	});
 }
 
 @end
@@ -8,6 +8,7 @@
 
 #import "UIScrollView+ScrollToTopCapture.h"
 #import "DTXUIInteractionRecorder.h"
+#import "DTXCaptureHooks.h"
 @import ObjectiveC;
 
 @interface UIScrollView ()
@@ -43,8 +44,12 @@ static CGPoint newContentOffset;
 
 + (void)load
 {
-	DTXSwizzleMethod(self, @selector(_scrollToTopIfPossible:), @selector(_dtxrec_scrollToTopIfPossible:), NULL);
-	DTXSwizzleMethod(self, @selector(_setContentOffset:animated:animationCurve:animationAdjustsForContentOffsetDelta:animation:), @selector(_dtxrec_setContentOffset:animated:animationCurve:animationAdjustsForContentOffsetDelta:animation:), NULL);
+	//Swizzling again restores the original implementations.
+	dispatch_block_t toggle = ^{
+		DTXSwizzleMethod(self, @selector(_scrollToTopIfPossible:), @selector(_dtxrec_scrollToTopIfPossible:), NULL);
+		DTXSwizzleMethod(self, @selector(_setContentOffset:animated:animationCurve:animationAdjustsForContentOffsetDelta:animation:), @selector(_dtxrec_setContentOffset:animated:animationCurve:animationAdjustsForContentOffsetDelta:animation:), NULL);
+	};
+	DTXCaptureHooksRegister(toggle, toggle);
 }
 
 @end
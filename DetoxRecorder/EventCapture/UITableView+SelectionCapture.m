@@ -8,6 +8,8 @@
 
 #import "UITableView+SelectionCapture.h"
 #import "DTXUIInteractionRecorder.h"
+#import "DTXEventRouter.h"
+#import "DTXCaptureHooks.h"
 @import ObjectiveC;
 
 static void* _DTXHighlightedCell = &_DTXHighlightedCell;
@@ -37,7 +39,10 @@ static void* _DTXCellTouchEvent = &_DTXCellTouchEvent;
 	if(cell)
 	{
 		UIEvent* event = [cell dtx_attachedObjectForKey:_DTXCellTouchEvent];
-		[DTXUIInteractionRecorder addTapWithView:cell withEvent:event];
+		if(DTXEventRouterClaimEvent(event, DTXEventSourceTableViewSelection))
+		{
+			[DTXUIInteractionRecorder addTapWithView:cell withEvent:event];
+		}
 	}
 	
 	[self _dtxrec_userSelectRowAtPendingSelectionIndexPath:arg1];
@@ -70,10 +75,14 @@ static void* _DTXCellTouchEvent = &_DTXCellTouchEvent;
 
 + (void)load
 {
-	DTXSwizzleMethod(self, @selector(_highlightRowAtIndexPath:animated:scrollPosition:usingPresentationValues:), @selector(_dtxrec_highlightRowAtIndexPath:animated:scrollPosition:usingPresentationValues:), NULL);
-	DTXSwizzleMethod(self, @selector(touchesBegan:withEvent:), @selector(_dtxrec_touchesBegan:withEvent:), NULL);
-	DTXSwizzleMethod(self, @selector(_userSelectRowAtPendingSelectionIndexPath:), @selector(_dtxrec_userSelectRowAtPendingSelectionIndexPath:), NULL);
-	DTXSwizzleMethod(self, @selector(unhighlightRowAtIndexPath:animated:), @selector(_dtxrec_unhighlightRowAtIndexPath:animated:), NULL);
+	//Swizzling again restores the original implementations.
+	dispatch_block_t toggle = ^{
+		DTXSwizzleMethod(self, @selector(_highlightRowAtIndexPath:animated:scrollPosition:usingPresentationValues:), @selector(_dtxrec_highlightRowAtIndexPath:animated:scrollPosition:usingPresentationValues:), NULL);
+		DTXSwizzleMethod(self, @selector(touchesBegan:withEvent:), @selector(_dtxrec_touchesBegan:withEvent:), NULL);
+		DTXSwizzleMethod(self, @selector(_userSelectRowAtPendingSelectionIndexPath:), @selector(_dtxrec_userSelectRowAtPendingSelectionIndexPath:), NULL);
+		DTXSwizzleMethod(self, @selector(unhighlightRowAtIndexPath:animated:), @selector(_dtxrec_unhighlightRowAtIndexPath:animated:), NULL);
+	};
+	DTXCaptureHooksRegister(toggle, toggle);
 }
 
 @end
@@ -207,6 +207,8 @@ typedef NS_ENUM(NSUInteger, _DTXRecSettingsCellStyle) {
 			@"Recording Settings",
 			(id)NSNull.null,
 			(id)NSNull.null,
+			(id)NSNull.null,
+			(id)NSNull.null,
 			@"Visualization & Animations",
 			(id)NSNull.null,
 			@"Compatibility",
@@ -225,6 +227,8 @@ typedef NS_ENUM(NSUInteger, _DTXRecSettingsCellStyle) {
 		_settingFooters = @[
 			@"When enabled, consecutive scroll actions will be coalesced into a single action.",
 			@"When enabled, actions performed on elements, immediately after scrolling the containing scroll view, will enhance the scroll action to waitfor for better accuracy.",
+			@"When enabled, hidden, transparent and offscreen views, and windows of other scenes, are ignored when choosing element matchers. This is faster in large apps, but may produce matchers that are not unique if the test runs with a different set of hidden views.",
+			@"When enabled, test IDs of React Native views are resolved through the React Native view registry, rather than by searching all windows. Native views with the same identifiers are not counted.",
 			@"The delay before a touch is categorized as a long press action in React Native.",
 			@"When enabled, there will be no visualization for recorded actions.",
 			@"When enabled, miscellaneous Detox Recorder animations will be minimized or disabled.",
@@ -254,6 +258,22 @@ typedef NS_ENUM(NSUInteger, _DTXRecSettingsCellStyle) {
 					  ],
 				}
 			],
+			@[
+				@{@"Ignore Hidden Views":
+					  @[
+						  NSStringFromSelector(@selector(dtxrec_pruneHiddenViews)),
+						  @(_DTXRecSettingsCellStyleBool)
+					  ],
+				}
+			],
+			@[
+				@{@"Use React Native View Registry":
+					  @[
+						  NSStringFromSelector(@selector(dtxrec_useReactNativeViewRegistry)),
+						  @(_DTXRecSettingsCellStyleBool)
+					  ],
+				}
+			],
 			@[
 				@{@"React Native Long Press Delay":
 					  @[
@@ -285,7 +305,7 @@ typedef NS_ENUM(NSUInteger, _DTXRecSettingsCellStyle) {
 					  @[
 						  NSStringFromSelector(@selector(dtxrec_detoxVersionCompatibility)),
 						  @(_DTXRecSettingsCellStyleMultiple),
-						  @[@"17.0"],
+						  NSUserDefaults.dtxrec_supportedDetoxVersions,
 					  ],
 				},
 			],
@@ -0,0 +1,27 @@
+//
+//  DTXReactNativeViewRegistry.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+@import UIKit;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Resolves test IDs through the React Native UI manager's view registry, instead of walking the UIKit hierarchy.
+/// Only available for apps using the React Native bridge; main thread only.
+@interface DTXReactNativeViewRegistry : NSObject
+
+/// @c nil if the setting is disabled, or the app has no bridge with a view registry.
++ (nullable instancetype)currentRegistry;
+
+/// The view's nearest React view, or its nearest React ancestor with a test ID or one of @c allowedLookupTraits; @c nil if the view is not part of a React hierarchy, or has its own accessibility identifier.
+- (nullable UIView*)testIDViewForView:(UIView*)view allowedLookupTraits:(UIAccessibilityTraits)allowedLookupTraits;
+/// The views in a window with the test ID, in React tag order.
+- (NSArray<UIView*>*)viewsWithTestID:(NSString*)testID;
+
+@end
+
+NS_ASSUME_NONNULL_END
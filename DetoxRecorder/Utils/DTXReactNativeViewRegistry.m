@@ -0,0 +1,155 @@
+//
+//  DTXReactNativeViewRegistry.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXReactNativeViewRegistry.h"
+#import "UIView+HierarchyMutationTracking.h"
+#import "DTXRecorderInstrumentation.h"
+@import ObjectiveC;
+
+//Implemented by React Native's UIView+React
+@interface UIView (DTXReactNative)
+
+@property (nonatomic, copy, readonly) NSNumber* reactTag;
+@property (nonatomic, weak, readonly) UIView* reactSuperview;
+
+@end
+
+DTX_ALWAYS_INLINE
+static NSDictionary<NSNumber*, UIView*>* _DTXCurrentViewRegistry(void)
+{
+	static Class bridgeClass;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		bridgeClass = NSClassFromString(@"RCTBridge");
+	});
+	
+	SEL currentBridge = NSSelectorFromString(@"currentBridge");
+	if(bridgeClass == nil || [bridgeClass respondsToSelector:currentBridge] == NO || [UIView instancesRespondToSelector:@selector(reactTag)] == NO)
+	{
+		return nil;
+	}
+	
+	id bridge = [bridgeClass valueForKey:NSStringFromSelector(currentBridge)];
+	if([bridge respondsToSelector:NSSelectorFromString(@"uiManager")] == NO)
+	{
+		return nil;
+	}
+	
+	//Apps using the new renderer have no view registry.
+	id uiManager = [bridge valueForKey:@"uiManager"];
+	Ivar registryIvar = uiManager != nil ? class_getInstanceVariable([uiManager class], "_viewRegistry") : NULL;
+	if(registryIvar == NULL)
+	{
+		return nil;
+	}
+	
+	id rv = object_getIvar(uiManager, registryIvar);
+	return [rv isKindOfClass:NSDictionary.class] ? rv : nil;
+}
+
+DTX_DIRECT_MEMBERS
+@implementation DTXReactNativeViewRegistry
+{
+	NSDictionary<NSNumber*, UIView*>* _registry;
+	NSUInteger _indexGeneration;
+	NSMutableDictionary<NSString*, NSMutableArray<UIView*>*>* _byTestID;
+}
+
++ (instancetype)currentRegistry
+{
+	if(DTXRecorderSettingsCurrent->useReactNativeViewRegistry == NO)
+	{
+		return nil;
+	}
+	
+	static DTXReactNativeViewRegistry* shared;
+	
+	NSDictionary* registry = _DTXCurrentViewRegistry();
+	if(registry == nil)
+	{
+		return nil;
+	}
+	
+	//Reloading the bridge replaces the UI manager, and with it the registry.
+	if(shared == nil || shared->_registry != registry)
+	{
+		shared = [DTXReactNativeViewRegistry new];
+		shared->_registry = registry;
+	}
+	
+	return shared;
+}
+
+- (UIView*)_reactViewForView:(UIView*)view
+{
+	//Views created internally by React views, such as RCTCustomScrollView, have no tag.
+	UIView* currView = view;
+	while(currView != nil && currView.reactTag == nil)
+	{
+		currView = currView.superview;
+	}
+	
+	return currView;
+}
+
+- (UIView*)testIDViewForView:(UIView*)view allowedLookupTraits:(UIAccessibilityTraits)allowedLookupTraits
+{
+	//Native views with identifiers are not registered, so they are left to the UIKit search.
+	if(view.reactTag == nil && view.accessibilityIdentifier.length > 0)
+	{
+		return nil;
+	}
+	
+	UIView* currView = [self _reactViewForView:view];
+	while(allowedLookupTraits != 0 && currView != nil && currView.accessibilityIdentifier.length == 0 && (currView.accessibilityTraits & allowedLookupTraits) == 0)
+	{
+		NSNumber* reactTag = currView.reactSuperview.reactTag;
+		currView = reactTag != nil ? _registry[reactTag] : nil;
+	}
+	
+	return currView;
+}
+
+- (NSArray<UIView*>*)viewsWithTestID:(NSString*)testID
+{
+	//Test IDs are set through setAccessibilityIdentifier:, which invalidates the generation.
+	NSUInteger generation = UIView.dtxrec_hierarchyGeneration;
+	if(_byTestID == nil || _indexGeneration != generation)
+	{
+		DTX_SIGNPOST_INTERVAL("React Native Registry Index");
+		
+		_byTestID = [NSMutableDictionary new];
+		_indexGeneration = generation;
+		
+		NSArray<NSNumber*>* tags = [_registry.allKeys sortedArrayUsingSelector:@selector(compare:)];
+		for(NSNumber* tag in tags)
+		{
+			UIView* view = _registry[tag];
+			NSString* identifier = view.accessibilityIdentifier;
+			//Views of unmounted or offscreen screens stay registered, but are not in the searched windows.
+			if(identifier.length == 0 || view.window == nil)
+			{
+				continue;
+			}
+			
+			NSMutableArray* bucket = _byTestID[identifier];
+			if(bucket == nil)
+			{
+				bucket = [NSMutableArray new];
+				_byTestID[identifier] = bucket;
+			}
+			[bucket addObject:view];
+		}
+		
+		DTXRecorderCounterAdd(DTXRecorderCounterViewsVisited, tags.count);
+	}
+	
+	return _byTestID[testID] ?: @[];
+}
+
+@end
@@ -0,0 +1,44 @@
+//
+//  DTXRecorderInstrumentation.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <os/signpost.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Signposts for the recorder's stages, shown under "Points of Interest" in Instruments.
+extern os_log_t DTXRecorderSignpostLog(void);
+
+/// Wraps the rest of the enclosing scope in a signpost interval; @c name must be a string literal.
+#define DTX_SIGNPOST_INTERVAL(name) \
+	os_log_t __dtx_signpost_log = DTXRecorderSignpostLog(); \
+	os_signpost_id_t __dtx_signpost_id = os_signpost_id_generate(__dtx_signpost_log); \
+	os_signpost_interval_begin(__dtx_signpost_log, __dtx_signpost_id, name); \
+	dtx_defer { \
+		os_signpost_interval_end(__dtx_signpost_log, __dtx_signpost_id, name); \
+	}
+
+/// Per-session counters, reset whenever recording starts.
+typedef NS_ENUM(NSUInteger, DTXRecorderCounter) {
+	DTXRecorderCounterActions,
+	DTXRecorderCounterUpdates,
+	DTXRecorderCounterCoalescedScrolls,
+	DTXRecorderCounterViewsVisited,
+	DTXRecorderCounterBytesSent,
+	DTXRecorderCounterCollapsedCommands,
+	DTXRecorderCounterDroppedCommands,
+	DTXRecorderCounterCount
+};
+
+/// Safe to call from any thread.
+extern void DTXRecorderCounterAdd(DTXRecorderCounter counter, uint64_t value);
+extern void DTXRecorderCountersReset(void);
+/// Keyed by counter name, e.g. "actions" or "bytesSent".
+extern NSDictionary<NSString*, NSNumber*>* DTXRecorderCountersSnapshot(void);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,58 @@
+//
+//  DTXRecorderInstrumentation.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXRecorderInstrumentation.h"
+#import <stdatomic.h>
+
+os_log_t DTXRecorderSignpostLog(void)
+{
+	static os_log_t log;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		log = os_log_create("com.wix.DetoxRecorder", OS_LOG_CATEGORY_POINTS_OF_INTEREST);
+	});
+	
+	return log;
+}
+
+static _Atomic uint64_t _counters[DTXRecorderCounterCount];
+
+void DTXRecorderCounterAdd(DTXRecorderCounter counter, uint64_t value)
+{
+	//Only totals matter, so no ordering is needed.
+	atomic_fetch_add_explicit(&_counters[counter], value, memory_order_relaxed);
+}
+
+void DTXRecorderCountersReset(void)
+{
+	for(NSUInteger idx = 0; idx < DTXRecorderCounterCount; idx++)
+	{
+		atomic_store_explicit(&_counters[idx], 0, memory_order_relaxed);
+	}
+}
+
+NSDictionary<NSString*, NSNumber*>* DTXRecorderCountersSnapshot(void)
+{
+	static NSString* const names[DTXRecorderCounterCount] = {
+		[DTXRecorderCounterActions] = @"actions",
+		[DTXRecorderCounterUpdates] = @"updates",
+		[DTXRecorderCounterCoalescedScrolls] = @"coalescedScrolls",
+		[DTXRecorderCounterViewsVisited] = @"viewsVisited",
+		[DTXRecorderCounterBytesSent] = @"bytesSent",
+		[DTXRecorderCounterCollapsedCommands] = @"collapsedCommands",
+		[DTXRecorderCounterDroppedCommands] = @"droppedCommands",
+	};
+	
+	NSMutableDictionary* rv = [NSMutableDictionary dictionaryWithCapacity:DTXRecorderCounterCount];
+	for(NSUInteger idx = 0; idx < DTXRecorderCounterCount; idx++)
+	{
+		rv[names[idx]] = @(atomic_load_explicit(&_counters[idx], memory_order_relaxed));
+	}
+	
+	return rv;
+}
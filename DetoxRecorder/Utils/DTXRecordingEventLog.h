@@ -0,0 +1,54 @@
+//
+//  DTXRecordingEventLog.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "DTXRecordingWireFormat.h"
+
+@class DTXRecordedAction;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+	Binary event log, from which the CLI regenerates tests offline (detox recorder --generate).
+	Must match the reader in the CLI's RecordingEventLog.swift.
+
+	All integers are little endian. The file starts with a 24 byte header:
+		char magic[8] = "DTXEVLOG", uint32 version, uint32 reserved, uint64 length of the valid records that follow
+	Each record is a uint16 kind, a uint16 reserved field and a uint32 payload length, followed by the payload, padded to 8 bytes.
+
+	Kinds:
+		1 Session: uint32 test name string, uint32 Detox version compatibility string, float64 start time (seconds since 1970),
+		           uint32 supported Detox versions string (JSON array), uint32 reserved (before version 3, the compatibility string is 0 and the last two fields are absent)
+		2 String:  uint32 string id, UTF-8 bytes
+		3 Element: uint32 element id, uint32 ancestor element id, int32 atIndex, uint16 matcher count, uint16 candidate count,
+		           then matcher and candidate entries of uint32 matcher type, uint32 value string, int32 atIndex, uint32 match count
+		           (the number of views the candidate matched when recorded; 0 for matchers)
+		4 Action:  uint32 operation (DTXRecordingCommandType add, update or remove), uint32 variant (DTXRecordedActionVariant),
+		           uint32 action type string, uint32 element id, uint32 arguments string (JSON array),
+		           uint32 secondary element id, uint32 secondary arguments string (JSON array), uint32 reserved, float64 time
+
+	Matcher types are 1 by.id, 2 by.type, 3 by.label and 4 by.text. Ids of 0 mean none; an atIndex of -1 means no index is needed. Strings and elements are written once, before their first use.
+	The supported Detox versions are those the framework can record for, any of which a test can be regenerated for.
+*/
+extern const uint32_t DTXRecordingEventLogVersion;
+
+/// Appends records to a memory mapped file, so recording an action is a few copies, with no serialization to Detox code.
+/// Not thread safe; all calls must happen on the same serial queue.
+@interface DTXRecordingEventLog : NSObject
+
+- (nullable instancetype)initWithURL:(NSURL*)URL testName:(NSString*)testName error:(NSError**)error;
+
+@property (nonatomic, strong, readonly) NSURL* URL;
+
+- (void)appendAction:(nullable DTXRecordedAction*)action operation:(DTXRecordingCommandType)operation;
+
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
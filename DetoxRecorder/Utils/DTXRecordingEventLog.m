@@ -0,0 +1,385 @@
+//
+//  DTXRecordingEventLog.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXRecordingEventLog.h"
+#import "DTXRecordedAction-Private.h"
+#import <sys/mman.h>
+
+DTX_CREATE_LOG(RecordingEventLog)
+
+const uint32_t DTXRecordingEventLogVersion = 3;
+
+typedef NS_ENUM(uint16_t, DTXEventLogRecordKind) {
+	DTXEventLogRecordKindSession = 1,
+	DTXEventLogRecordKindString = 2,
+	DTXEventLogRecordKindElement = 3,
+	DTXEventLogRecordKindAction = 4,
+};
+
+//All supported devices are little endian, so records are written as they are laid out in memory.
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t length;
+} DTXEventLogHeader;
+
+typedef struct {
+	uint16_t kind;
+	uint16_t reserved;
+	uint32_t length;
+} DTXEventLogRecordHeader;
+
+typedef struct {
+	uint32_t testName;
+	uint32_t detoxVersionCompatibility;
+	double startTime;
+	uint32_t supportedDetoxVersions;
+	uint32_t reserved;
+} DTXEventLogSessionRecord;
+
+typedef struct {
+	uint32_t element;
+	uint32_t ancestorElement;
+	int32_t atIndex;
+	uint16_t matcherCount;
+	uint16_t candidateCount;
+} DTXEventLogElementRecord;
+
+typedef struct {
+	uint32_t matcherType;
+	uint32_t value;
+	int32_t atIndex;
+	uint32_t matchCount;
+} DTXEventLogMatcherEntry;
+
+typedef struct {
+	uint32_t operation;
+	uint32_t variant;
+	uint32_t actionType;
+	uint32_t element;
+	uint32_t arguments;
+	uint32_t secondaryElement;
+	uint32_t secondaryArguments;
+	uint32_t reserved;
+	double time;
+} DTXEventLogActionRecord;
+
+_Static_assert(sizeof(DTXEventLogHeader) == 24, "Event log header layout changed");
+_Static_assert(sizeof(DTXEventLogSessionRecord) == 24, "Event log session record layout changed");
+_Static_assert(sizeof(DTXEventLogRecordHeader) == 8, "Event log record header layout changed");
+_Static_assert(sizeof(DTXEventLogElementRecord) == 16, "Event log element record layout changed");
+_Static_assert(sizeof(DTXEventLogMatcherEntry) == 16, "Event log matcher entry layout changed");
+_Static_assert(sizeof(DTXEventLogActionRecord) == 40, "Event log action record layout changed");
+
+static const size_t DTXEventLogInitialCapacity = 64 * 1024;
+
+DTX_ALWAYS_INLINE
+static size_t DTXEventLogPaddedLength(size_t length)
+{
+	return (length + 7) & ~(size_t)7;
+}
+
+static uint32_t DTXEventLogMatcherType(DTXRecordedElementMatcherType type)
+{
+	if([type isEqualToString:DTXRecordedElementMatcherTypeById])
+	{
+		return 1;
+	}
+	if([type isEqualToString:DTXRecordedElementMatcherTypeByType])
+	{
+		return 2;
+	}
+	if([type isEqualToString:DTXRecordedElementMatcherTypeByLabel])
+	{
+		return 3;
+	}
+	
+	return 4;
+}
+
+DTX_ALWAYS_INLINE
+static int32_t DTXEventLogIndex(BOOL hasIndex, NSInteger idx)
+{
+	return hasIndex && idx != NSNotFound ? (int32_t)idx : -1;
+}
+
+@implementation DTXRecordingEventLog
+{
+	int _fd;
+	uint8_t* _bytes;
+	size_t _capacity;
+	size_t _length;
+	
+	NSMutableDictionary<NSString*, NSNumber*>* _strings;
+	//Elements are immutable, so each is written once; weak keys keep a reused address from aliasing an old element.
+	NSMapTable<DTXRecordedElement*, NSNumber*>* _elements;
+	uint32_t _nextStringId;
+	uint32_t _nextElementId;
+}
+
+- (nullable instancetype)initWithURL:(NSURL*)URL testName:(NSString*)testName error:(NSError**)error
+{
+	self = [super init];
+	if(self)
+	{
+		_URL = URL;
+		_fd = -1;
+		
+		NSError* directoryError = nil;
+		if([NSFileManager.defaultManager createDirectoryAtURL:URL.URLByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:&directoryError] == NO)
+		{
+			if(error != NULL)
+			{
+				*error = directoryError;
+			}
+			return nil;
+		}
+		
+		_fd = open(URL.fileSystemRepresentation, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if(_fd < 0 || [self _mapWithCapacity:DTXEventLogInitialCapacity] == NO)
+		{
+			if(error != NULL)
+			{
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey: URL.path}];
+			}
+			[self close];
+			return nil;
+		}
+		
+		_strings = [NSMutableDictionary new];
+		_elements = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+		_nextStringId = 1;
+		_nextElementId = 1;
+		
+		DTXEventLogHeader* header = (DTXEventLogHeader*)_bytes;
+		memcpy(header->magic, "DTXEVLOG", 8);
+		header->version = DTXRecordingEventLogVersion;
+		_length = sizeof(DTXEventLogHeader);
+		
+		DTXEventLogSessionRecord session = {0};
+		session.testName = [self _idForString:testName];
+		session.detoxVersionCompatibility = [self _idForString:NSUserDefaults.standardUserDefaults.dtxrec_detoxVersionCompatibility];
+		session.supportedDetoxVersions = [self _idForArgs:NSUserDefaults.dtxrec_supportedDetoxVersions];
+		session.startTime = NSDate.date.timeIntervalSince1970;
+		[self _appendRecordOfKind:DTXEventLogRecordKindSession bytes:&session length:sizeof(session) extraBytes:NULL extraLength:0];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self close];
+}
+
+- (BOOL)_mapWithCapacity:(size_t)capacity
+{
+	if(_bytes != NULL)
+	{
+		munmap(_bytes, _capacity);
+		_bytes = NULL;
+	}
+	
+	if(ftruncate(_fd, capacity) != 0)
+	{
+		return NO;
+	}
+	
+	void* bytes = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+	if(bytes == MAP_FAILED)
+	{
+		return NO;
+	}
+	
+	_bytes = bytes;
+	_capacity = capacity;
+	
+	return YES;
+}
+
+- (BOOL)_ensureAvailableLength:(size_t)length
+{
+	if(_bytes == NULL)
+	{
+		return NO;
+	}
+	
+	if(_length + length <= _capacity)
+	{
+		return YES;
+	}
+	
+	size_t capacity = _capacity * 2;
+	while(capacity < _length + length)
+	{
+		capacity *= 2;
+	}
+	
+	if([self _mapWithCapacity:capacity] == NO)
+	{
+		dtx_log_error(@"Unable to grow the event log: %s", strerror(errno));
+		[self close];
+		return NO;
+	}
+	
+	return YES;
+}
+
+- (void)_appendRecordOfKind:(DTXEventLogRecordKind)kind bytes:(const void*)bytes length:(size_t)length extraBytes:(const void*)extraBytes extraLength:(size_t)extraLength
+{
+	size_t paddedLength = DTXEventLogPaddedLength(length + extraLength);
+	if([self _ensureAvailableLength:sizeof(DTXEventLogRecordHeader) + paddedLength] == NO)
+	{
+		return;
+	}
+	
+	DTXEventLogRecordHeader* recordHeader = (DTXEventLogRecordHeader*)(_bytes + _length);
+	recordHeader->kind = kind;
+	recordHeader->reserved = 0;
+	recordHeader->length = (uint32_t)(length + extraLength);
+	
+	uint8_t* payload = (uint8_t*)(recordHeader + 1);
+	memcpy(payload, bytes, length);
+	if(extraLength > 0)
+	{
+		memcpy(payload + length, extraBytes, extraLength);
+	}
+	memset(payload + length + extraLength, 0, paddedLength - length - extraLength);
+	
+	_length += sizeof(DTXEventLogRecordHeader) + paddedLength;
+	
+	//Readers only trust records covered by the header, so a crash mid-record leaves a valid log.
+	((DTXEventLogHeader*)_bytes)->length = _length - sizeof(DTXEventLogHeader);
+}
+
+- (uint32_t)_idForString:(NSString*)string
+{
+	if(string == nil)
+	{
+		return 0;
+	}
+	
+	NSNumber* existing = _strings[string];
+	if(existing != nil)
+	{
+		return existing.unsignedIntValue;
+	}
+	
+	uint32_t rv = _nextStringId++;
+	_strings[string] = @(rv);
+	
+	const char* utf8 = string.UTF8String;
+	[self _appendRecordOfKind:DTXEventLogRecordKindString bytes:&rv length:sizeof(rv) extraBytes:utf8 extraLength:strlen(utf8)];
+	
+	return rv;
+}
+
+- (uint32_t)_idForArgs:(NSArray*)args
+{
+	if(args.count == 0)
+	{
+		return 0;
+	}
+	
+	NSData* data = [NSJSONSerialization dataWithJSONObject:args options:NSJSONWritingSortedKeys error:NULL];
+	if(data == nil)
+	{
+		return 0;
+	}
+	
+	return [self _idForString:[[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding]];
+}
+
+- (uint32_t)_idForElement:(DTXRecordedElement*)element
+{
+	if(element == nil)
+	{
+		return 0;
+	}
+	
+	NSNumber* existing = [_elements objectForKey:element];
+	if(existing != nil)
+	{
+		return existing.unsignedIntValue;
+	}
+	
+	DTXEventLogElementRecord record = {0};
+	record.ancestorElement = [self _idForElement:element.ancestorElement];
+	record.atIndex = DTXEventLogIndex(element.requiresAtIndex, element.atIndex);
+	
+	DTXEventLogMatcherEntry entries[8];
+	DTXEventLogMatcherEntry* entriesPtr = entries;
+	__block NSUInteger entryCount = 0;
+	for(DTXRecordedElementMatcher* matcher in element.matchers)
+	{
+		if(entryCount == 4)
+		{
+			break;
+		}
+		
+		entries[entryCount++] = (DTXEventLogMatcherEntry){ DTXEventLogMatcherType(matcher.matcherType), [self _idForString:[matcher.matcherArgs.firstObject description]], -1, 0 };
+	}
+	record.matcherCount = entryCount;
+	
+	[element enumerateMatcherCandidatesUsingBlock:^(DTXRecordedElementMatcherType matcherType, NSString* value, NSInteger atIndex, NSUInteger matchCount) {
+		entriesPtr[entryCount++] = (DTXEventLogMatcherEntry){ DTXEventLogMatcherType(matcherType), [self _idForString:value], DTXEventLogIndex(YES, atIndex), (uint32_t)matchCount };
+	}];
+	record.candidateCount = entryCount - record.matcherCount;
+	
+	record.element = _nextElementId++;
+	[_elements setObject:@(record.element) forKey:element];
+	
+	[self _appendRecordOfKind:DTXEventLogRecordKindElement bytes:&record length:sizeof(record) extraBytes:entries extraLength:sizeof(DTXEventLogMatcherEntry) * entryCount];
+	
+	return record.element;
+}
+
+- (void)appendAction:(DTXRecordedAction*)action operation:(DTXRecordingCommandType)operation
+{
+	if(_bytes == NULL)
+	{
+		return;
+	}
+	
+	DTXEventLogActionRecord record = {0};
+	record.operation = operation;
+	record.time = NSDate.date.timeIntervalSince1970;
+	
+	if(action != nil)
+	{
+		record.variant = action.eventLogVariant;
+		record.actionType = [self _idForString:action.actionType];
+		record.element = [self _idForElement:action.element];
+		record.arguments = [self _idForArgs:action.actionArgs];
+		record.secondaryElement = [self _idForElement:action.eventLogSecondaryElement];
+		record.secondaryArguments = [self _idForArgs:action.eventLogSecondaryArgs];
+	}
+	
+	[self _appendRecordOfKind:DTXEventLogRecordKindAction bytes:&record length:sizeof(record) extraBytes:NULL extraLength:0];
+}
+
+- (void)close
+{
+	if(_bytes != NULL)
+	{
+		msync(_bytes, _length, MS_SYNC);
+		munmap(_bytes, _capacity);
+		_bytes = NULL;
+		
+		//Drops the unused tail of the mapping.
+		ftruncate(_fd, _length);
+	}
+	
+	if(_fd >= 0)
+	{
+		close(_fd);
+		_fd = -1;
+	}
+}
+
+@end
@@ -0,0 +1,33 @@
+//
+//  DTXRecordingFileWriter.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Streams a recorded test to disk as commands are recorded.
+/// Committed commands are appended once; only the last command and the suite's closing lines are rewritten,
+/// so the file is a complete test at all times.
+/// Not thread safe; all calls must happen on the same serial queue.
+@interface DTXRecordingFileWriter : NSObject
+
+- (instancetype)initWithURL:(NSURL*)URL testName:(NSString*)testName;
+
+/// The test file being written.
+@property (nonatomic, strong, readonly) NSURL* URL;
+
+- (void)addCommand:(NSString*)command;
+/// Passing nil removes the last command.
+- (void)updateLastCommand:(nullable NSString*)command;
+
+/// Returns the first error encountered while writing, if any.
+- (BOOL)closeAndReturnError:(NSError**)error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,168 @@
+//
+//  DTXRecordingFileWriter.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXRecordingFileWriter.h"
+
+DTX_CREATE_LOG(RecordingFileWriter)
+
+static NSString* const DTXRecordingFileOutro = @"\t})\n});";
+
+@implementation DTXRecordingFileWriter
+{
+	NSFileHandle* _file;
+	NSError* _error;
+	unsigned long long _committedOffset;
+	NSString* _lastCommand;
+}
+
+- (instancetype)initWithURL:(NSURL*)URL testName:(NSString*)testName
+{
+	self = [super init];
+	if(self)
+	{
+		NSURL* directoryURL;
+		if(URL.hasDirectoryPath)
+		{
+			directoryURL = URL;
+			URL = [URL URLByAppendingPathComponent:@"recorder_test.js" isDirectory:NO];
+		} else {
+			directoryURL = [URL URLByDeletingLastPathComponent];
+		}
+		_URL = URL;
+		
+		NSError* error = nil;
+		if([NSFileManager.defaultManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:&error] == NO ||
+		   [@"" writeToURL:URL atomically:YES encoding:NSUTF8StringEncoding error:&error] == NO ||
+		   (_file = [NSFileHandle fileHandleForWritingToURL:URL error:&error]) == nil)
+		{
+			[self _setError:error];
+			return self;
+		}
+		
+		NSString* intro = [NSString stringWithFormat:@"describe('Recorded suite', () => {\n\tit('%@', async () => {\n", testName];
+		[self _writeString:intro];
+		[self _fileOffset:&_committedOffset];
+		
+		[self _writeTail];
+	}
+	return self;
+}
+
+- (void)_setError:(NSError*)error
+{
+	if(_error != nil || error == nil)
+	{
+		return;
+	}
+	
+	_error = error;
+	dtx_log_error(@"Error writing to output file: %@", error.localizedDescription);
+}
+
+- (void)_writeString:(NSString*)string
+{
+	if(_error != nil)
+	{
+		return;
+	}
+	
+	NSError* error = nil;
+	[_file writeData:[string dataUsingEncoding:NSUTF8StringEncoding] error:&error];
+	[self _setError:error];
+}
+
+- (void)_fileOffset:(unsigned long long*)offset
+{
+	if(_error != nil)
+	{
+		return;
+	}
+	
+	NSError* error = nil;
+	[_file getOffset:offset error:&error];
+	[self _setError:error];
+}
+
+- (BOOL)_seekToCommittedOffset
+{
+	if(_error != nil)
+	{
+		return NO;
+	}
+	
+	NSError* error = nil;
+	BOOL rv = [_file seekToOffset:_committedOffset error:&error];
+	[self _setError:error];
+	
+	return rv;
+}
+
+- (void)_writeTail
+{
+	if([self _seekToCommittedOffset] == NO)
+	{
+		return;
+	}
+	
+	if(_lastCommand != nil)
+	{
+		[self _writeString:[NSString stringWithFormat:@"\t\t%@\n", _lastCommand]];
+	}
+	[self _writeString:DTXRecordingFileOutro];
+	
+	unsigned long long end = 0;
+	[self _fileOffset:&end];
+	
+	if(_error == nil)
+	{
+		NSError* error = nil;
+		[_file truncateAtOffset:end error:&error];
+		[self _setError:error];
+	}
+}
+
+- (void)addCommand:(NSString*)command
+{
+	if(_lastCommand != nil)
+	{
+		//The previous command can no longer change, so it is written once, in place of the old tail.
+		if([self _seekToCommittedOffset])
+		{
+			[self _writeString:[NSString stringWithFormat:@"\t\t%@\n", _lastCommand]];
+			[self _fileOffset:&_committedOffset];
+		}
+	}
+	
+	_lastCommand = command;
+	[self _writeTail];
+}
+
+- (void)updateLastCommand:(NSString*)command
+{
+	_lastCommand = command;
+	[self _writeTail];
+}
+
+- (BOOL)closeAndReturnError:(NSError**)error
+{
+	NSError* closeError = nil;
+	[_file synchronizeAndReturnError:&closeError];
+	[self _setError:closeError];
+	[_file closeAndReturnError:&closeError];
+	[self _setError:closeError];
+	_file = nil;
+	
+	if(error != NULL)
+	{
+		*error = _error;
+	}
+	
+	return _error == nil;
+}
+
+@end
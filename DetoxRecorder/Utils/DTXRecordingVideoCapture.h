@@ -0,0 +1,35 @@
+//
+//  DTXRecordingVideoCapture.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Captures the app's screen with ReplayKit into a QuickTime movie, encoded in hardware as HEVC (or H.264 where HEVC is unavailable).
+/// Every recorded action becomes a chapter titled with its line number and Detox command, so the movie can be navigated by test line.
+/// Frames are encoded on a background queue at up to 30 fps, and dropped rather than queued when the encoder is busy.
+/// Main thread only.
+@interface DTXRecordingVideoCapture : NSObject
+
+- (instancetype)initWithURL:(NSURL*)URL;
+
+@property (nonatomic, strong, readonly) NSURL* URL;
+
+- (void)start;
+
+/// Starts a chapter for the next recorded action.
+- (void)addChapterWithTitle:(NSString*)title;
+/// Passing nil removes the last chapter.
+- (void)updateLastChapterTitle:(nullable NSString*)title;
+
+/// The handler is called on an arbitrary queue, once the movie has been written or capturing failed.
+- (void)stopWithCompletionHandler:(dispatch_block_t)handler;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,332 @@
+//
+//  DTXRecordingVideoCapture.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXRecordingVideoCapture.h"
+@import AVFoundation;
+@import ReplayKit;
+
+DTX_CREATE_LOG(RecordingVideoCapture)
+
+//Half the display rate is plenty for reviewing, and halves the encoding work.
+static const double DTXVideoCaptureFrameRate = 30.0;
+
+static AVMutableMetadataItem* DTXChapterTitleItem(NSString* title)
+{
+	AVMutableMetadataItem* rv = [AVMutableMetadataItem metadataItem];
+	rv.identifier = AVMetadataCommonIdentifierTitle;
+	rv.dataType = (__bridge NSString*)kCMMetadataBaseDataType_UTF8;
+	rv.extendedLanguageTag = @"und";
+	rv.value = title;
+	return rv;
+}
+
+DTX_ALWAYS_INLINE
+static CMTime DTXHostTimeNow(void)
+{
+	//ReplayKit sample buffers are stamped with the host clock.
+	return CMClockGetTime(CMClockGetHostTimeClock());
+}
+
+@implementation DTXRecordingVideoCapture
+{
+	//Writer state is only touched on this queue.
+	dispatch_queue_t _queue;
+	AVAssetWriter* _writer;
+	AVAssetWriterInput* _videoInput;
+	AVAssetWriterInput* _chapterInput;
+	AVAssetWriterInputMetadataAdaptor* _chapterAdaptor;
+	BOOL _failed;
+	CMTime _sessionStartTime;
+	CMTime _lastFrameTime;
+	
+	NSUInteger _chapterCount;
+	NSString* _pendingChapterTitle;
+	CMTime _pendingChapterStartTime;
+	//Chapters that ended before the first frame arrived, appended once writing starts.
+	NSMutableArray<AVTimedMetadataGroup*>* _waitingChapters;
+}
+
+- (instancetype)initWithURL:(NSURL*)URL
+{
+	self = [super init];
+	if(self)
+	{
+		_URL = URL;
+		_queue = dispatch_queue_create("com.wix.DTXRecordingVideoCapture", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+		_sessionStartTime = kCMTimeInvalid;
+		_lastFrameTime = kCMTimeInvalid;
+		_waitingChapters = [NSMutableArray new];
+	}
+	return self;
+}
+
+- (void)start
+{
+	RPScreenRecorder* recorder = RPScreenRecorder.sharedRecorder;
+	if(recorder.isAvailable == NO)
+	{
+		dtx_log_error(@"Screen capture is not available; no video will be recorded");
+		_failed = YES;
+		return;
+	}
+	
+	[NSFileManager.defaultManager createDirectoryAtURL:_URL.URLByDeletingLastPathComponent withIntermediateDirectories:YES attributes:nil error:NULL];
+	[NSFileManager.defaultManager removeItemAtURL:_URL error:NULL];
+	
+	NSError* error = nil;
+	_writer = [AVAssetWriter assetWriterWithURL:_URL fileType:AVFileTypeQuickTimeMovie error:&error];
+	if(_writer == nil)
+	{
+		dtx_log_error(@"Unable to create video file: %@", error);
+		_failed = YES;
+		return;
+	}
+	
+	recorder.microphoneEnabled = NO;
+	[recorder startCaptureWithHandler:^(CMSampleBufferRef _Nonnull sampleBuffer, RPSampleBufferType bufferType, NSError * _Nullable error) {
+		if(bufferType != RPSampleBufferTypeVideo || error != nil)
+		{
+			return;
+		}
+		
+		CFRetain(sampleBuffer);
+		dispatch_async(self->_queue, ^{
+			[self _appendVideoSampleBuffer:sampleBuffer];
+			CFRelease(sampleBuffer);
+		});
+	} completionHandler:^(NSError * _Nullable error) {
+		if(error != nil)
+		{
+			dtx_log_error(@"Unable to start screen capture: %@", error);
+			dispatch_async(self->_queue, ^{
+				self->_failed = YES;
+			});
+		}
+	}];
+}
+
+//Must be called on _queue
+- (BOOL)_startWritingWithFirstSampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
+	CVImageBufferRef imageBuffer = CMSampleBufferGetImageBuffer(sampleBuffer);
+	if(imageBuffer == NULL)
+	{
+		return NO;
+	}
+	
+	//HEVC is only encoded in hardware on devices that can export it.
+	BOOL supportsHEVC = [AVAssetExportSession.allExportPresets containsObject:AVAssetExportPresetHEVCHighestQuality];
+	size_t width = CVPixelBufferGetWidth(imageBuffer);
+	size_t height = CVPixelBufferGetHeight(imageBuffer);
+	
+	NSDictionary* outputSettings = @{
+		AVVideoCodecKey: supportsHEVC ? AVVideoCodecTypeHEVC : AVVideoCodecTypeH264,
+		AVVideoWidthKey: @(width),
+		AVVideoHeightKey: @(height),
+		AVVideoCompressionPropertiesKey: @{
+			AVVideoAverageBitRateKey: @(width * height * 2),
+			AVVideoExpectedSourceFrameRateKey: @(DTXVideoCaptureFrameRate),
+			AVVideoMaxKeyFrameIntervalDurationKey: @2,
+			AVVideoAllowFrameReorderingKey: @NO,
+		},
+	};
+	
+	_videoInput = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeVideo outputSettings:outputSettings];
+	_videoInput.expectsMediaDataInRealTime = YES;
+	
+	AVTimedMetadataGroup* templateGroup = [[AVTimedMetadataGroup alloc] initWithItems:@[DTXChapterTitleItem(@"")] timeRange:kCMTimeRangeZero];
+	CMFormatDescriptionRef chapterFormat = [templateGroup copyFormatDescription];
+	_chapterInput = [AVAssetWriterInput assetWriterInputWithMediaType:AVMediaTypeMetadata outputSettings:nil sourceFormatHint:chapterFormat];
+	_chapterInput.marksOutputTrackAsEnabled = NO;
+	_chapterInput.expectsMediaDataInRealTime = YES;
+	if(chapterFormat != NULL)
+	{
+		CFRelease(chapterFormat);
+	}
+	_chapterAdaptor = [AVAssetWriterInputMetadataAdaptor assetWriterInputMetadataAdaptorWithAssetWriterInput:_chapterInput];
+	
+	if([_writer canAddInput:_videoInput] == NO || [_writer canAddInput:_chapterInput] == NO)
+	{
+		dtx_log_error(@"Unable to configure video encoding");
+		return NO;
+	}
+	
+	[_writer addInput:_videoInput];
+	[_writer addInput:_chapterInput];
+	if([_videoInput canAddTrackAssociationWithTrackOfInput:_chapterInput type:AVTrackAssociationTypeChapterList])
+	{
+		[_videoInput addTrackAssociationWithTrackOfInput:_chapterInput type:AVTrackAssociationTypeChapterList];
+	}
+	
+	if([_writer startWriting] == NO)
+	{
+		dtx_log_error(@"Unable to start writing video: %@", _writer.error);
+		return NO;
+	}
+	
+	_sessionStartTime = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
+	[_writer startSessionAtSourceTime:_sessionStartTime];
+	
+	for(AVTimedMetadataGroup* chapter in _waitingChapters)
+	{
+		[self _appendChapter:chapter];
+	}
+	[_waitingChapters removeAllObjects];
+	
+	return YES;
+}
+
+//Must be called on _queue
+- (void)_appendVideoSampleBuffer:(CMSampleBufferRef)sampleBuffer
+{
+	if(_failed || _writer == nil)
+	{
+		return;
+	}
+	
+	if(CMTIME_IS_INVALID(_sessionStartTime) && [self _startWritingWithFirstSampleBuffer:sampleBuffer] == NO)
+	{
+		_failed = YES;
+		return;
+	}
+	
+	CMTime time = CMSampleBufferGetPresentationTimeStamp(sampleBuffer);
+	if(CMTIME_IS_VALID(_lastFrameTime) && CMTimeGetSeconds(CMTimeSubtract(time, _lastFrameTime)) < 1.0 / DTXVideoCaptureFrameRate)
+	{
+		return;
+	}
+	
+	//A busy encoder drops frames instead of holding on to them.
+	if(_videoInput.isReadyForMoreMediaData == NO)
+	{
+		return;
+	}
+	
+	if([_videoInput appendSampleBuffer:sampleBuffer])
+	{
+		_lastFrameTime = time;
+	}
+}
+
+//Must be called on _queue
+- (void)_appendChapter:(AVTimedMetadataGroup*)chapter
+{
+	if(_chapterInput.isReadyForMoreMediaData == NO)
+	{
+		dtx_log_error(@"Dropping video chapter: %@", chapter.items.firstObject.value);
+		return;
+	}
+	
+	[_chapterAdaptor appendTimedMetadataGroup:chapter];
+}
+
+//Must be called on _queue
+- (void)_endPendingChapterAtTime:(CMTime)endTime
+{
+	if(_pendingChapterTitle == nil)
+	{
+		return;
+	}
+	
+	//Chapters cannot start before the movie does.
+	CMTime startTime = _pendingChapterStartTime;
+	if(CMTIME_IS_VALID(_sessionStartTime) && CMTimeCompare(startTime, _sessionStartTime) < 0)
+	{
+		startTime = _sessionStartTime;
+	}
+	if(CMTimeCompare(endTime, startTime) <= 0)
+	{
+		endTime = CMTimeAdd(startTime, CMTimeMake(1, 1000));
+	}
+	
+	AVTimedMetadataGroup* chapter = [[AVTimedMetadataGroup alloc] initWithItems:@[DTXChapterTitleItem(_pendingChapterTitle)] timeRange:CMTimeRangeFromTimeToTime(startTime, endTime)];
+	_pendingChapterTitle = nil;
+	
+	if(CMTIME_IS_INVALID(_sessionStartTime))
+	{
+		[_waitingChapters addObject:chapter];
+		return;
+	}
+	
+	[self _appendChapter:chapter];
+}
+
+- (void)addChapterWithTitle:(NSString*)title
+{
+	CMTime time = DTXHostTimeNow();
+	dispatch_async(_queue, ^{
+		[self _endPendingChapterAtTime:time];
+		
+		//Matches the test's line numbering, so a line points straight to its chapter.
+		self->_chapterCount += 1;
+		self->_pendingChapterTitle = [NSString stringWithFormat:@"%lu: %@", (unsigned long)self->_chapterCount, title];
+		self->_pendingChapterStartTime = time;
+	});
+}
+
+- (void)updateLastChapterTitle:(NSString*)title
+{
+	dispatch_async(_queue, ^{
+		if(self->_pendingChapterTitle == nil)
+		{
+			return;
+		}
+		
+		if(title == nil)
+		{
+			self->_pendingChapterTitle = nil;
+			self->_chapterCount -= 1;
+			return;
+		}
+		
+		self->_pendingChapterTitle = [NSString stringWithFormat:@"%lu: %@", (unsigned long)self->_chapterCount, title];
+	});
+}
+
+- (void)stopWithCompletionHandler:(dispatch_block_t)handler
+{
+	dispatch_block_t finishWriting = ^ {
+		dispatch_async(self->_queue, ^{
+			if(self->_writer.status != AVAssetWriterStatusWriting)
+			{
+				[self->_writer cancelWriting];
+				handler();
+				return;
+			}
+			
+			[self _endPendingChapterAtTime:CMTIME_IS_VALID(self->_lastFrameTime) ? self->_lastFrameTime : DTXHostTimeNow()];
+			[self->_videoInput markAsFinished];
+			[self->_chapterInput markAsFinished];
+			
+			[self->_writer finishWritingWithCompletionHandler:^{
+				if(self->_writer.status == AVAssetWriterStatusCompleted)
+				{
+					dtx_log_info(@"Wrote session video to %@", self->_URL.path);
+				}
+				else
+				{
+					dtx_log_error(@"Unable to write session video: %@", self->_writer.error);
+				}
+				
+				handler();
+			}];
+		});
+	};
+	
+	if(RPScreenRecorder.sharedRecorder.isRecording == NO)
+	{
+		finishWriting();
+		return;
+	}
+	
+	[RPScreenRecorder.sharedRecorder stopCaptureWithHandler:^(NSError * _Nullable error) {
+		finishWriting();
+	}];
+}
+
+@end
@@ -0,0 +1,33 @@
+//
+//  DTXRecordingWireFormat.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Compact recording frame: a version byte, followed by one or more commands.
+/// Each command is a type byte, a varint payload length and a UTF-8 payload.
+/// Must match the decoder in the CLI's RecordingHandler.swift.
+extern const uint8_t DTXRecordingWireFormatVersion;
+
+typedef NS_ENUM(uint8_t, DTXRecordingCommandType) {
+	DTXRecordingCommandTypeAdd = 1,
+	DTXRecordingCommandTypeUpdate = 2,
+	DTXRecordingCommandTypeRemove = 3,
+	DTXRecordingCommandTypeEnd = 4,
+	DTXRecordingCommandTypePing = 5,
+	/// Per-session statistics as JSON; only sent when the CLI asks for them with DTXRecWritesSummary.
+	DTXRecordingCommandTypeSummary = 6,
+};
+
+extern NSString* DTXRecordingCommandTypeName(DTXRecordingCommandType type);
+
+extern NSMutableData* DTXRecordingFrameCreate(void);
+extern void DTXRecordingFrameAppendCommand(NSMutableData* frame, DTXRecordingCommandType type, NSString* _Nullable payload);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,68 @@
+//
+//  DTXRecordingWireFormat.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXRecordingWireFormat.h"
+
+const uint8_t DTXRecordingWireFormatVersion = 1;
+
+NSString* DTXRecordingCommandTypeName(DTXRecordingCommandType type)
+{
+	switch(type)
+	{
+		case DTXRecordingCommandTypeAdd:
+			return @"add";
+		case DTXRecordingCommandTypeUpdate:
+			return @"update";
+		case DTXRecordingCommandTypeRemove:
+			return @"remove";
+		case DTXRecordingCommandTypeEnd:
+			return @"end";
+		case DTXRecordingCommandTypePing:
+			return @"ping";
+		case DTXRecordingCommandTypeSummary:
+			return @"summary";
+	}
+}
+
+NSMutableData* DTXRecordingFrameCreate(void)
+{
+	NSMutableData* rv = [NSMutableData dataWithCapacity:256];
+	[rv appendBytes:&DTXRecordingWireFormatVersion length:1];
+	return rv;
+}
+
+DTX_ALWAYS_INLINE
+static void _DTXAppendVarint(NSMutableData* data, uint64_t value)
+{
+	uint8_t buffer[10];
+	NSUInteger length = 0;
+	
+	do
+	{
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		buffer[length++] = value != 0 ? (byte | 0x80) : byte;
+	} while(value != 0);
+	
+	[data appendBytes:buffer length:length];
+}
+
+void DTXRecordingFrameAppendCommand(NSMutableData* frame, DTXRecordingCommandType type, NSString* payload)
+{
+	[frame appendBytes:&type length:1];
+	
+	NSUInteger length = [payload lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	_DTXAppendVarint(frame, length);
+	
+	if(length > 0)
+	{
+		NSUInteger offset = frame.length;
+		frame.length = offset + length;
+		[payload getBytes:(uint8_t*)frame.mutableBytes + offset maxLength:length usedLength:NULL encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, payload.length) remainingRange:NULL];
+	}
+}
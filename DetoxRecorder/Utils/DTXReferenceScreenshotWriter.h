@@ -0,0 +1,30 @@
+//
+//  DTXReferenceScreenshotWriter.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+@import UIKit;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Captures reference images for recorded screenshot actions, for visual diffing against the test's own screenshots.
+/// Windows are drawn on the main thread; encoding and writing happen on a background queue.
+@interface DTXReferenceScreenshotWriter : NSObject
+
+/// When @c usesHEIC is set and the device can encode it, images are written as HEIC; otherwise as PNG.
+- (instancetype)initWithDirectoryURL:(NSURL*)directoryURL usesHEIC:(BOOL)usesHEIC;
+
+@property (nonatomic, strong, readonly) NSURL* directoryURL;
+
+/// Main thread only. Windows are drawn back to front, as they are currently displayed.
+- (void)captureWindows:(NSArray<UIWindow*>*)windows name:(NSString*)name;
+
+/// Blocks until all captured images have been written.
+- (void)waitUntilFinished;
+
+@end
+
+NS_ASSUME_NONNULL_END
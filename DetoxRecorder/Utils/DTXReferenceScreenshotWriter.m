@@ -0,0 +1,107 @@
+//
+//  DTXReferenceScreenshotWriter.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXReferenceScreenshotWriter.h"
+#import "DTXRecorderInstrumentation.h"
+@import ImageIO;
+
+DTX_CREATE_LOG(ReferenceScreenshotWriter)
+
+static NSString* DTXReferenceScreenshotFileName(NSString* name)
+{
+	NSMutableCharacterSet* disallowed = [NSMutableCharacterSet characterSetWithCharactersInString:@"/\\:?%*|\"<>"];
+	[disallowed formUnionWithCharacterSet:NSCharacterSet.controlCharacterSet];
+	
+	return [[name componentsSeparatedByCharactersInSet:disallowed] componentsJoinedByString:@"_"];
+}
+
+DTX_DIRECT_MEMBERS
+@implementation DTXReferenceScreenshotWriter
+{
+	dispatch_queue_t _encodingQueue;
+	CFStringRef _imageType;
+	NSString* _pathExtension;
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL*)directoryURL usesHEIC:(BOOL)usesHEIC
+{
+	self = [super init];
+	if(self)
+	{
+		_directoryURL = directoryURL;
+		_encodingQueue = dispatch_queue_create("com.wix.DTXReferenceScreenshotWriter", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+		
+		NSArray* supportedTypes = CFBridgingRelease(CGImageDestinationCopyTypeIdentifiers());
+		BOOL supportsHEIC = [supportedTypes containsObject:@"public.heic"];
+		_imageType = usesHEIC && supportsHEIC ? CFSTR("public.heic") : CFSTR("public.png");
+		_pathExtension = usesHEIC && supportsHEIC ? @"heic" : @"png";
+		
+		NSError* error = nil;
+		if([NSFileManager.defaultManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:&error] == NO)
+		{
+			dtx_log_error(@"Unable to create screenshot directory: %@", error);
+		}
+	}
+	return self;
+}
+
+- (void)captureWindows:(NSArray<UIWindow*>*)windows name:(NSString*)name
+{
+	UIScreen* screen = windows.firstObject.screen ?: UIScreen.mainScreen;
+	
+	CGImageRef image;
+	{
+		DTX_SIGNPOST_INTERVAL("Screenshot Drawing");
+		
+		UIGraphicsImageRendererFormat* format = [UIGraphicsImageRendererFormat preferredFormat];
+		format.scale = screen.scale;
+		format.opaque = YES;
+		
+		//Only drawing the already committed frames touches the main thread; pending layout is not forced.
+		UIGraphicsImageRenderer* renderer = [[UIGraphicsImageRenderer alloc] initWithBounds:screen.bounds format:format];
+		UIImage* rendered = [renderer imageWithActions:^(UIGraphicsImageRendererContext * _Nonnull rendererContext) {
+			for(UIWindow* window in windows)
+			{
+				[window drawViewHierarchyInRect:window.frame afterScreenUpdates:NO];
+			}
+		}];
+		
+		image = CGImageRetain(rendered.CGImage);
+	}
+	
+	NSURL* URL = [_directoryURL URLByAppendingPathComponent:[DTXReferenceScreenshotFileName(name) stringByAppendingPathExtension:_pathExtension] isDirectory:NO];
+	CFStringRef imageType = _imageType;
+	
+	dispatch_async(_encodingQueue, ^{
+		DTX_SIGNPOST_INTERVAL("Screenshot Encoding");
+		
+		CGImageDestinationRef destination = CGImageDestinationCreateWithURL((__bridge CFURLRef)URL, imageType, 1, NULL);
+		if(destination == NULL)
+		{
+			dtx_log_error(@"Unable to create screenshot file at %@", URL.path);
+			CGImageRelease(image);
+			return;
+		}
+		
+		CGImageDestinationAddImage(destination, image, (__bridge CFDictionaryRef)@{(__bridge NSString*)kCGImageDestinationLossyCompressionQuality: @0.9});
+		if(CGImageDestinationFinalize(destination) == NO)
+		{
+			dtx_log_error(@"Unable to write screenshot to %@", URL.path);
+		}
+		
+		CFRelease(destination);
+		CGImageRelease(image);
+	});
+}
+
+- (void)waitUntilFinished
+{
+	dispatch_sync(_encodingQueue, ^{});
+}
+
+@end
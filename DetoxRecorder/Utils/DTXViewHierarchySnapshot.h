@@ -0,0 +1,38 @@
+//
+//  DTXViewHierarchySnapshot.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+@import UIKit;
+
+@class DTXViewMatcher;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A single-walk snapshot of the view hierarchy, indexed for element matching.
+/// Returned view lists are in hierarchy order; use @c dtxrec_coordinateIndexOfView:inViews: or @c dtxrec_sortViewsByCoords: for screen order.
+@interface DTXViewHierarchySnapshot : NSObject
+
++ (instancetype)snapshotOfAllWindows;
+/// The windows of a scene, or of the key window scene when @c nil; shared until the hierarchy changes, so callers must not keep it.
++ (instancetype)snapshotOfWindowsInScene:(nullable id /* UIWindowScene* */)scene;
+/// The windows in the view's scene, pruned when pruning hidden views is enabled.
++ (instancetype)snapshotForResolvingView:(UIView*)view;
+- (instancetype)initWithWindows:(NSArray<UIWindow*>*)windows;
+/// Skips the recorder's own windows, and hidden, transparent or fully clipped subtrees, except for those containing @c keptView.
+- (instancetype)initWithWindows:(NSArray<UIWindow*>*)windows prunedKeepingView:(nullable UIView*)keptView;
+
+@property (nonatomic, readonly, copy) NSArray<UIView*>* allViews;
+
+- (NSArray<UIView*>*)viewsPassingMatcher:(DTXViewMatcher*)matcher;
+- (NSArray<UIView*>*)viewsWithAccessibilityIdentifier:(NSString*)identifier;
+- (NSArray<UIView*>*)viewsWithAccessibilityLabel:(NSString*)label;
+- (NSArray<UIView*>*)viewsWithText:(NSString*)text;
+- (NSArray<UIView*>*)viewsOfKindOfClass:(Class)cls text:(nullable NSString*)text accessibilityLabel:(nullable NSString*)label;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,288 @@
+//
+//  DTXViewHierarchySnapshot.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXViewHierarchySnapshot.h"
+#import "UIView+RecorderUtils.h"
+#import "DTXViewMatcher.h"
+#import "DTXRecorderInstrumentation.h"
+#import "DTXCaptureControlWindow.h"
+#import "UIWindow+RecorderUtils.h"
+#import "UIView+HierarchyMutationTracking.h"
+#import "DTXCaptureHooks.h"
+
+typedef NSMutableDictionary<NSString*, NSMutableArray<UIView*>*> _DTXViewIndex;
+
+//Snapshots hold their views strongly, so the cache only lives while recording and drops disconnected scenes.
+static NSMapTable<id, DTXViewHierarchySnapshot*>* _sceneSnapshots;
+static NSUInteger _sceneSnapshotsGeneration;
+static id<NSObject> _sceneDisconnectObserver;
+
+DTX_ALWAYS_INLINE
+static _DTXViewIndex* _DTXBuildIndex(NSArray<UIView*>* views, id (^keyForView)(UIView* view))
+{
+	_DTXViewIndex* rv = [_DTXViewIndex new];
+	for(UIView* view in views)
+	{
+		NSString* key = keyForView(view);
+		if([key isKindOfClass:NSString.class] == NO || key.length == 0)
+		{
+			continue;
+		}
+		
+		NSMutableArray* bucket = rv[key];
+		if(bucket == nil)
+		{
+			bucket = [NSMutableArray new];
+			rv[key] = bucket;
+		}
+		[bucket addObject:view];
+	}
+	return rv;
+}
+
+DTX_ALWAYS_INLINE
+static BOOL _DTXIsSubtreeInvisible(UIView* view)
+{
+	if(view.isHidden || view.alpha < 0.01)
+	{
+		return YES;
+	}
+	
+	//Subviews may draw outside a view that does not clip, so only clipping views can hide their whole subtree.
+	if(view.clipsToBounds == NO || view.window == nil)
+	{
+		return NO;
+	}
+	
+	CGRect frame = [view convertRect:view.bounds toView:nil];
+	return CGRectIsEmpty(frame) || CGRectIntersectsRect(frame, view.window.bounds) == NO;
+}
+
+DTX_DIRECT_MEMBERS
+@implementation DTXViewHierarchySnapshot
+{
+	NSMutableArray<UIView*>* _views;
+	
+	_DTXViewIndex* _byIdentifier;
+	_DTXViewIndex* _byLabel;
+	_DTXViewIndex* _byText;
+	NSMutableDictionary<NSArray*, NSArray<UIView*>*>* _byClass;
+}
+
++ (void)load
+{
+	@autoreleasepool {
+		DTXCaptureHooksRegister(^{
+			if(@available(iOS 13.0, *))
+			{
+				_sceneDisconnectObserver = [NSNotificationCenter.defaultCenter addObserverForName:UISceneDidDisconnectNotification object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+					[_sceneSnapshots removeObjectForKey:note.object];
+				}];
+			}
+		}, ^{
+			if(_sceneDisconnectObserver != nil)
+			{
+				[NSNotificationCenter.defaultCenter removeObserver:_sceneDisconnectObserver];
+				_sceneDisconnectObserver = nil;
+			}
+			
+			_sceneSnapshots = nil;
+		});
+	}
+}
+
++ (instancetype)snapshotOfAllWindows
+{
+	return [[self alloc] initWithWindows:UIWindow.dtxrec_allWindowsFrontToBack];
+}
+
++ (instancetype)snapshotOfWindowsInScene:(id)scene
+{
+	//Unpruned snapshots depend only on the hierarchy, so each scene's is reused until the hierarchy changes.
+	NSUInteger generation = UIView.dtxrec_hierarchyGeneration;
+	if(_sceneSnapshots == nil || _sceneSnapshotsGeneration != generation)
+	{
+		_sceneSnapshots = [NSMapTable weakToStrongObjectsMapTable];
+		_sceneSnapshotsGeneration = generation;
+	}
+	
+	id key = scene ?: NSNull.null;
+	DTXViewHierarchySnapshot* rv = [_sceneSnapshots objectForKey:key];
+	if(rv == nil)
+	{
+		rv = [[self alloc] initWithWindows:[UIWindow dtxrec_allWindowsFrontToBackForScene:scene]];
+		[_sceneSnapshots setObject:rv forKey:key];
+	}
+	
+	return rv;
+}
+
++ (instancetype)snapshotForResolvingView:(UIView*)view
+{
+	//Detox matches in the windows of a single scene, so other scenes neither make elements ambiguous nor need to be walked.
+	id scene = nil;
+	if(@available(iOS 13.0, *))
+	{
+		scene = view.window.windowScene;
+	}
+	
+	if(DTXRecorderSettingsCurrent->pruneHiddenViews == NO)
+	{
+		return [self snapshotOfWindowsInScene:scene];
+	}
+	
+	return [[self alloc] initWithWindows:[UIWindow dtxrec_allWindowsFrontToBackForScene:scene] prunedKeepingView:view];
+}
+
+- (instancetype)initWithWindows:(NSArray<UIWindow*>*)windows
+{
+	return [self initWithWindows:windows pruned:NO keptView:nil];
+}
+
+- (instancetype)initWithWindows:(NSArray<UIWindow*>*)windows prunedKeepingView:(UIView*)keptView
+{
+	return [self initWithWindows:windows pruned:YES keptView:keptView];
+}
+
+- (instancetype)initWithWindows:(NSArray<UIWindow*>*)windows pruned:(BOOL)pruned keptView:(UIView*)keptView
+{
+	self = [super init];
+	
+	if(self)
+	{
+		DTX_SIGNPOST_INTERVAL("Hierarchy Snapshot");
+		
+		_views = [NSMutableArray new];
+		_byClass = [NSMutableDictionary new];
+		
+		//The kept view and its ancestors are never pruned, so the view can always be found in its own snapshot.
+		NSHashTable<UIView*>* keptViews = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsObjectPointerPersonality];
+		for(UIView* ancestor = keptView; ancestor != nil; ancestor = ancestor.superview)
+		{
+			[keptViews addObject:ancestor];
+		}
+		
+		//Same pre-order as the predicate-based search, so indices stay compatible.
+		NSMutableArray<UIView*>* stack = [windows.reverseObjectEnumerator.allObjects mutableCopy];
+		while(stack.count > 0)
+		{
+			UIView* view = stack.lastObject;
+			[stack removeLastObject];
+			
+			if(pruned && [keptViews containsObject:view] == NO && ([view isKindOfClass:DTXCaptureControlWindow.class] || _DTXIsSubtreeInvisible(view)))
+			{
+				continue;
+			}
+			
+			[_views addObject:view];
+			
+			for(UIView* subview in view.subviews.reverseObjectEnumerator)
+			{
+				[stack addObject:subview];
+			}
+		}
+		
+		DTXRecorderCounterAdd(DTXRecorderCounterViewsVisited, _views.count);
+	}
+	
+	return self;
+}
+
+- (NSArray<UIView *> *)allViews
+{
+	return _views;
+}
+
+- (NSArray<UIView*>*)viewsPassingMatcher:(DTXViewMatcher*)matcher
+{
+	NSMutableArray<UIView*>* rv = [NSMutableArray new];
+	for(UIView* view in _views)
+	{
+		if([matcher matchesView:view])
+		{
+			[rv addObject:view];
+		}
+	}
+	return rv;
+}
+
+- (NSArray<UIView*>*)viewsWithAccessibilityIdentifier:(NSString*)identifier
+{
+	if(_byIdentifier == nil)
+	{
+		_byIdentifier = _DTXBuildIndex(_views, ^id(UIView *view) {
+			return view.accessibilityIdentifier;
+		});
+	}
+	
+	return _byIdentifier[identifier] ?: @[];
+}
+
+- (NSArray<UIView*>*)viewsWithAccessibilityLabel:(NSString*)label
+{
+	if(_byLabel == nil)
+	{
+		_byLabel = _DTXBuildIndex(_views, ^id(UIView *view) {
+			return view.accessibilityLabel;
+		});
+	}
+	
+	return _byLabel[label] ?: @[];
+}
+
+- (NSArray<UIView*>*)viewsWithText:(NSString*)text
+{
+	if(_byText == nil)
+	{
+		_byText = _DTXBuildIndex(_views, ^id(UIView *view) {
+			return [view text];
+		});
+	}
+	
+	return _byText[text] ?: @[];
+}
+
+- (NSArray<UIView*>*)viewsOfKindOfClass:(Class)cls text:(NSString*)text accessibilityLabel:(NSString*)label
+{
+	NSArray* key = @[cls, text.length > 0 ? text : NSNull.null, text.length == 0 && label.length > 0 ? label : NSNull.null];
+	NSArray<UIView*>* rv = _byClass[key];
+	if(rv != nil)
+	{
+		return rv;
+	}
+	
+	NSArray<UIView*>* candidates;
+	if(text.length > 0)
+	{
+		candidates = [self viewsWithText:text];
+	}
+	else if(label.length > 0)
+	{
+		candidates = [self viewsWithAccessibilityLabel:label];
+	}
+	else
+	{
+		candidates = _views;
+	}
+	
+	DTXViewMatcher* matcher = [DTXViewMatcher matcherForKindOfClass:cls];
+	NSMutableArray<UIView*>* filtered = [NSMutableArray new];
+	for(UIView* view in candidates)
+	{
+		if([matcher matchesView:view])
+		{
+			[filtered addObject:view];
+		}
+	}
+	
+	_byClass[key] = filtered;
+	
+	return filtered;
+}
+
+@end
@@ -0,0 +1,26 @@
+//
+//  DTXViewMatcher.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+@import UIKit;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A precompiled view matcher, evaluated with direct property reads instead of predicate parsing and KVC.
+@interface DTXViewMatcher : NSObject
+
++ (instancetype)matcherForAccessibilityIdentifier:(NSString*)identifier;
++ (instancetype)matcherForAccessibilityLabel:(NSString*)label;
++ (instancetype)matcherForText:(NSString*)text;
++ (instancetype)matcherForKindOfClass:(Class)cls;
++ (instancetype)matcherMatchingAllOf:(NSArray<DTXViewMatcher*>*)matchers;
+
+- (BOOL)matchesView:(UIView*)view;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,101 @@
+//
+//  DTXViewMatcher.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "DTXViewMatcher.h"
+#import "UIView+RecorderUtils.h"
+
+typedef NS_ENUM(NSUInteger, _DTXViewMatcherKind) {
+	_DTXViewMatcherKindAccessibilityIdentifier,
+	_DTXViewMatcherKindAccessibilityLabel,
+	_DTXViewMatcherKindText,
+	_DTXViewMatcherKindKindOfClass,
+	_DTXViewMatcherKindAllOf,
+};
+
+DTX_ALWAYS_INLINE
+static BOOL _DTXStringValueEquals(id value, NSString* string)
+{
+	return [value isKindOfClass:NSString.class] && [value isEqualToString:string];
+}
+
+DTX_DIRECT_MEMBERS
+@implementation DTXViewMatcher
+{
+	_DTXViewMatcherKind _kind;
+	NSString* _string;
+	Class _cls;
+	NSArray<DTXViewMatcher*>* _matchers;
+}
+
++ (instancetype)_matcherWithKind:(_DTXViewMatcherKind)kind
+{
+	DTXViewMatcher* rv = [self new];
+	rv->_kind = kind;
+	return rv;
+}
+
++ (instancetype)matcherForAccessibilityIdentifier:(NSString*)identifier
+{
+	DTXViewMatcher* rv = [self _matcherWithKind:_DTXViewMatcherKindAccessibilityIdentifier];
+	rv->_string = [identifier copy];
+	return rv;
+}
+
++ (instancetype)matcherForAccessibilityLabel:(NSString*)label
+{
+	DTXViewMatcher* rv = [self _matcherWithKind:_DTXViewMatcherKindAccessibilityLabel];
+	rv->_string = [label copy];
+	return rv;
+}
+
++ (instancetype)matcherForText:(NSString*)text
+{
+	DTXViewMatcher* rv = [self _matcherWithKind:_DTXViewMatcherKindText];
+	rv->_string = [text copy];
+	return rv;
+}
+
++ (instancetype)matcherForKindOfClass:(Class)cls
+{
+	DTXViewMatcher* rv = [self _matcherWithKind:_DTXViewMatcherKindKindOfClass];
+	rv->_cls = cls;
+	return rv;
+}
+
++ (instancetype)matcherMatchingAllOf:(NSArray<DTXViewMatcher*>*)matchers
+{
+	DTXViewMatcher* rv = [self _matcherWithKind:_DTXViewMatcherKindAllOf];
+	rv->_matchers = [matchers copy];
+	return rv;
+}
+
+- (BOOL)matchesView:(UIView*)view
+{
+	switch(_kind)
+	{
+		case _DTXViewMatcherKindAccessibilityIdentifier:
+			return _DTXStringValueEquals(view.accessibilityIdentifier, _string);
+		case _DTXViewMatcherKindAccessibilityLabel:
+			return _DTXStringValueEquals(view.accessibilityLabel, _string);
+		case _DTXViewMatcherKindText:
+			return _DTXStringValueEquals([view text], _string);
+		case _DTXViewMatcherKindKindOfClass:
+			return [view isKindOfClass:_cls];
+		case _DTXViewMatcherKindAllOf:
+			for(DTXViewMatcher* matcher in _matchers)
+			{
+				if([matcher matchesView:view] == NO)
+				{
+					return NO;
+				}
+			}
+			return YES;
+	}
+}
+
+@end
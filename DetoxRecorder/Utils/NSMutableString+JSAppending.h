@@ -0,0 +1,20 @@
+//
+//  NSMutableString+JSAppending.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface NSMutableString (JSAppending)
+
+/// Appends the same quoted literal as dtx_quotedStringRepresentationForJS, escaping in a single pass over the UTF-16 code units, without intermediate strings.
+- (void)dtx_appendQuotedStringForJS:(NSString*)string;
+
+@end
+
+NS_ASSUME_NONNULL_END
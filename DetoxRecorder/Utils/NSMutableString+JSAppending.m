@@ -0,0 +1,148 @@
+//
+//  NSMutableString+JSAppending.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "NSMutableString+JSAppending.h"
+
+#define DTX_JS_ESCAPE_CHUNK_LENGTH 256
+
+//The same characters JSON serialization escapes, so the output does not change.
+DTX_ALWAYS_INLINE
+static BOOL _DTXJSCharacterNeedsEscaping(unichar c)
+{
+	return c < 0x20 || c == '"' || c == '\\' || c == '/';
+}
+
+static NSCharacterSet* _DTXJSEscapedCharacters(void)
+{
+	static NSCharacterSet* escapedCharacters;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSMutableCharacterSet* characters = [NSMutableCharacterSet characterSetWithRange:NSMakeRange(0, 0x20)];
+		[characters addCharactersInString:@"\"\\/"];
+		escapedCharacters = characters.copy;
+	});
+	return escapedCharacters;
+}
+
+static void _DTXAppendEscapedCharacters(CFMutableStringRef target, const unichar* characters, CFIndex length)
+{
+	static const unichar hexDigits[] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+	
+	CFIndex runStart = 0;
+	for(CFIndex idx = 0; idx < length; idx++)
+	{
+		unichar c = characters[idx];
+		if(_DTXJSCharacterNeedsEscaping(c) == NO)
+		{
+			continue;
+		}
+		
+		//Characters that need no escaping are appended in runs.
+		if(idx > runStart)
+		{
+			CFStringAppendCharacters(target, characters + runStart, idx - runStart);
+		}
+		runStart = idx + 1;
+		
+		unichar escape[6] = {'\\', c, 0, 0, 0, 0};
+		CFIndex escapeLength = 2;
+		switch(c)
+		{
+			case '\b':
+				escape[1] = 'b';
+				break;
+			case '\f':
+				escape[1] = 'f';
+				break;
+			case '\n':
+				escape[1] = 'n';
+				break;
+			case '\r':
+				escape[1] = 'r';
+				break;
+			case '\t':
+				escape[1] = 't';
+				break;
+			case '"':
+			case '\\':
+			case '/':
+				break;
+			default:
+				escape[1] = 'u';
+				escape[2] = '0';
+				escape[3] = '0';
+				escape[4] = hexDigits[c >> 4];
+				escape[5] = hexDigits[c & 0xF];
+				escapeLength = 6;
+				break;
+		}
+		CFStringAppendCharacters(target, escape, escapeLength);
+	}
+	
+	if(length > runStart)
+	{
+		CFStringAppendCharacters(target, characters + runStart, length - runStart);
+	}
+}
+
+static void _DTXAppendCharactersInRange(CFMutableStringRef target, CFStringRef source, CFRange range, BOOL escaping)
+{
+	//Splitting a surrogate pair between chunks is harmless, as only ASCII characters are escaped.
+	unichar buffer[DTX_JS_ESCAPE_CHUNK_LENGTH];
+	for(CFIndex location = range.location; location < range.location + range.length; location += DTX_JS_ESCAPE_CHUNK_LENGTH)
+	{
+		CFIndex chunkLength = MIN(DTX_JS_ESCAPE_CHUNK_LENGTH, range.location + range.length - location);
+		CFStringGetCharacters(source, CFRangeMake(location, chunkLength), buffer);
+		if(escaping)
+		{
+			_DTXAppendEscapedCharacters(target, buffer, chunkLength);
+		}
+		else
+		{
+			CFStringAppendCharacters(target, buffer, chunkLength);
+		}
+	}
+}
+
+@implementation NSMutableString (JSAppending)
+
+- (void)dtx_appendQuotedStringForJS:(NSString*)string
+{
+	CFMutableStringRef target = (__bridge CFMutableStringRef)self;
+	static const unichar quote = '"';
+	
+	CFStringAppendCharacters(target, &quote, 1);
+	
+	//Most matcher and text arguments need no escaping, and are appended as is.
+	NSRange firstEscaped = [string rangeOfCharacterFromSet:_DTXJSEscapedCharacters() options:NSLiteralSearch];
+	if(firstEscaped.location == NSNotFound)
+	{
+		CFStringAppend(target, (__bridge CFStringRef)string);
+	}
+	else
+	{
+		CFStringRef source = (__bridge CFStringRef)string;
+		CFIndex length = CFStringGetLength(source);
+		const unichar* characters = CFStringGetCharactersPtr(source);
+		if(characters != NULL)
+		{
+			CFStringAppendCharacters(target, characters, firstEscaped.location);
+			_DTXAppendEscapedCharacters(target, characters + firstEscaped.location, length - firstEscaped.location);
+		}
+		else
+		{
+			//The prefix before the first escaped character has already been scanned, so it is only copied.
+			_DTXAppendCharactersInRange(target, source, CFRangeMake(0, firstEscaped.location), NO);
+			_DTXAppendCharactersInRange(target, source, CFRangeMake(firstEscaped.location, length - firstEscaped.location), YES);
+		}
+	}
+	
+	CFStringAppendCharacters(target, &quote, 1);
+}
+
+@end
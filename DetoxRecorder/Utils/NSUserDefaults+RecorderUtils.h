@@ -10,18 +10,41 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// The settings read while capturing events, copied out of the defaults so capture paths only read fields.
+typedef struct {
+	BOOL attemptXYRecording;
+	BOOL coalesceScrollEvents;
+	BOOL convertScrollEventsToWaitfor;
+	BOOL disableVisualizations;
+	NSTimeInterval rnLongPressDelay;
+	BOOL pruneHiddenViews;
+	BOOL useReactNativeViewRegistry;
+} DTXRecorderSettings;
+
+/// Main thread only. Reloaded when recording starts and whenever the defaults change, such as from the settings screen.
+extern const DTXRecorderSettings* const DTXRecorderSettingsCurrent;
+
 @interface NSUserDefaults (RecorderUtils)
 
+/// Settings are also read through KVC, which bypasses the accessors; call before any such access.
++ (void)dtxrec_registerDefaultsIfNeeded;
+/// Registers the defaults if needed, and starts keeping DTXRecorderSettingsCurrent up to date.
++ (void)dtxrec_loadSettingsSnapshot;
+
 @property (nonatomic, assign, setter=dtxrec_setAttemptXYRecording:) BOOL dtxrec_attemptXYRecording;
 @property (nonatomic, assign, setter=dtxrec_setCoalesceScrollEvents:) BOOL dtxrec_coalesceScrollEvents;
 @property (nonatomic, assign, setter=dtxrec_setConvertScrollEventsToWaitfor:) BOOL dtxrec_convertScrollEventsToWaitfor;
 @property (nonatomic, assign, setter=dtxrec_setDisableVisualizations:) BOOL dtxrec_disableVisualizations;
 @property (nonatomic, assign, setter=dtxrec_setDisableAnimations:) BOOL dtxrec_disableAnimations;
 @property (nonatomic, assign, setter=dtxrec_setRNLongPressDelay:) NSTimeInterval dtxrec_rnLongPressDelay;
+@property (nonatomic, assign, setter=dtxrec_setPruneHiddenViews:) BOOL dtxrec_pruneHiddenViews;
+@property (nonatomic, assign, setter=dtxrec_setUseReactNativeViewRegistry:) BOOL dtxrec_useReactNativeViewRegistry;
 
 @property (nonatomic, assign, setter=dtxrec_setRecordingBarMinimized:) BOOL dtxrec_recordingBarMinimized;
 
 @property (nonatomic, copy, setter=dtxrec_setDetoxVersionCompatibility:) NSString* dtxrec_detoxVersionCompatibility;
+/// The values dtxrec_detoxVersionCompatibility can take.
+@property (nonatomic, copy, class, readonly) NSArray<NSString*>* dtxrec_supportedDetoxVersions;
 
 @end
 
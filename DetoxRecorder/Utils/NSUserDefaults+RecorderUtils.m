@@ -9,23 +9,76 @@
 #import "NSUserDefaults+RecorderUtils.h"
 @import Darwin;
 
+//Registered on first use rather than in +load, so apps that never record do not pay for it at launch.
+DTX_ALWAYS_INLINE
+static void _DTXRegisterDefaultsIfNeeded(void)
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		[NSUserDefaults.standardUserDefaults registerDefaults:@{
+			@"dtxrec_attemptXYRecording": @NO,
+			@"dtxrec_coalesceScrollEvents": @YES,
+			@"dtxrec_convertScrollEventsToWaitfor": @YES,
+			@"dtxrec_rnLongPressDelay": @0.5,
+			@"dtxrec_recordingBarMinimized": @YES,
+			@"dtxrec_detoxVersionCompatibility": @"17.0",
+		}];
+	});
+}
+
+//Starts out with the registered defaults, for events added before recording starts.
+static DTXRecorderSettings _DTXRecorderSettings = {
+	.attemptXYRecording = NO,
+	.coalesceScrollEvents = YES,
+	.convertScrollEventsToWaitfor = YES,
+	.disableVisualizations = NO,
+	.rnLongPressDelay = 0.5,
+	.pruneHiddenViews = NO,
+	.useReactNativeViewRegistry = NO,
+};
+const DTXRecorderSettings* const DTXRecorderSettingsCurrent = &_DTXRecorderSettings;
+
+static void _DTXReloadSettingsSnapshot(void)
+{
+	NSUserDefaults* defaults = NSUserDefaults.standardUserDefaults;
+	
+	//Replaced as a whole, so readers never see a mix of old and new values.
+	_DTXRecorderSettings = (DTXRecorderSettings){
+		.attemptXYRecording = defaults.dtxrec_attemptXYRecording,
+		.coalesceScrollEvents = defaults.dtxrec_coalesceScrollEvents,
+		.convertScrollEventsToWaitfor = defaults.dtxrec_convertScrollEventsToWaitfor,
+		.disableVisualizations = defaults.dtxrec_disableVisualizations,
+		.rnLongPressDelay = defaults.dtxrec_rnLongPressDelay,
+		.pruneHiddenViews = defaults.dtxrec_pruneHiddenViews,
+		.useReactNativeViewRegistry = defaults.dtxrec_useReactNativeViewRegistry,
+	};
+}
+
 DTX_DIRECT_MEMBERS
 @implementation NSUserDefaults (RecorderUtils)
 
-+ (void)load
++ (void)dtxrec_registerDefaultsIfNeeded
+{
+	_DTXRegisterDefaultsIfNeeded();
+}
+
++ (void)dtxrec_loadSettingsSnapshot
 {
-	@autoreleasepool {
-		[NSUserDefaults.standardUserDefaults registerDefaults:@{@"dtxrec_attemptXYRecording": @NO}];
-		[NSUserDefaults.standardUserDefaults registerDefaults:@{@"dtxrec_coalesceScrollEvents": @YES}];
-		[NSUserDefaults.standardUserDefaults registerDefaults:@{@"dtxrec_convertScrollEventsToWaitfor": @YES}];
-		[NSUserDefaults.standardUserDefaults registerDefaults:@{@"dtxrec_rnLongPressDelay": @0.5}];
-		[NSUserDefaults.standardUserDefaults registerDefaults:@{@"dtxrec_recordingBarMinimized": @YES}];
-		[NSUserDefaults.standardUserDefaults registerDefaults:@{@"dtxrec_detoxVersionCompatibility": @"17.0"}];
-	}
+	_DTXRegisterDefaultsIfNeeded();
+	
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		[NSNotificationCenter.defaultCenter addObserverForName:NSUserDefaultsDidChangeNotification object:nil queue:NSOperationQueue.mainQueue usingBlock:^(NSNotification * _Nonnull note) {
+			_DTXReloadSettingsSnapshot();
+		}];
+	});
+	
+	_DTXReloadSettingsSnapshot();
 }
 
 - (BOOL)dtxrec_attemptXYRecording
 {
+	_DTXRegisterDefaultsIfNeeded();
 	return [self boolForKey:@"dtxrec_attemptXYRecording"];
 }
 
@@ -36,6 +89,7 @@ DTX_DIRECT_MEMBERS
 
 - (BOOL)dtxrec_coalesceScrollEvents
 {
+	_DTXRegisterDefaultsIfNeeded();
 	return [self boolForKey:@"dtxrec_coalesceScrollEvents"];
 }
 
@@ -46,6 +100,7 @@ DTX_DIRECT_MEMBERS
 
 - (BOOL)dtxrec_convertScrollEventsToWaitfor
 {
+	_DTXRegisterDefaultsIfNeeded();
 	return [self boolForKey:@"dtxrec_convertScrollEventsToWaitfor"];
 }
 
@@ -76,6 +131,7 @@ DTX_DIRECT_MEMBERS
 
 - (NSTimeInterval)dtxrec_rnLongPressDelay
 {
+	_DTXRegisterDefaultsIfNeeded();
 	return [self doubleForKey:@"dtxrec_rnLongPressDelay"];
 }
 
@@ -84,8 +140,29 @@ DTX_DIRECT_MEMBERS
 	[self setDouble:dtxrec_rnLongPressDelay forKey:@"dtxrec_rnLongPressDelay"];
 }
 
+- (BOOL)dtxrec_pruneHiddenViews
+{
+	return [self boolForKey:@"dtxrec_pruneHiddenViews"];
+}
+
+- (void)dtxrec_setPruneHiddenViews:(BOOL)dtxrec_pruneHiddenViews
+{
+	[self setBool:dtxrec_pruneHiddenViews forKey:@"dtxrec_pruneHiddenViews"];
+}
+
+- (BOOL)dtxrec_useReactNativeViewRegistry
+{
+	return [self boolForKey:@"dtxrec_useReactNativeViewRegistry"];
+}
+
+- (void)dtxrec_setUseReactNativeViewRegistry:(BOOL)dtxrec_useReactNativeViewRegistry
+{
+	[self setBool:dtxrec_useReactNativeViewRegistry forKey:@"dtxrec_useReactNativeViewRegistry"];
+}
+
 - (BOOL)dtxrec_recordingBarMinimized
 {
+	_DTXRegisterDefaultsIfNeeded();
 	return [self boolForKey:@"dtxrec_recordingBarMinimized"];
 }
 
@@ -96,6 +173,7 @@ DTX_DIRECT_MEMBERS
 
 - (NSString *)dtxrec_detoxVersionCompatibility
 {
+	_DTXRegisterDefaultsIfNeeded();
 	return [self stringForKey:@"dtxrec_detoxVersionCompatibility"];
 }
 
@@ -104,4 +182,9 @@ DTX_DIRECT_MEMBERS
 	[self setObject:dtxrec_detoxVersionCompatibility forKey:@"dtxrec_detoxVersionCompatibility"];
 }
 
++ (NSArray<NSString*>*)dtxrec_supportedDetoxVersions
+{
+	return @[@"17.0"];
+}
+
 @end
@@ -8,6 +8,7 @@
 
 #import "UIPickerView+RecorderUtils.h"
 #import "UIView+RecorderUtils.h"
+#import "DTXViewMatcher.h"
 #import "DTXAppleInternals.h"
 
 DTX_DIRECT_MEMBERS
@@ -35,9 +36,7 @@ DTX_DIRECT_MEMBERS
 		}
 		else
 		{
-			UILabel* label = (id)[UIView dtxrec_findViewsInHierarchy:view passingPredicate:[NSPredicate predicateWithBlock:^BOOL(id  _Nullable evaluatedObject, NSDictionary<NSString *,id> * _Nullable bindings) {
-				return [evaluatedObject isKindOfClass:UILabel.class];
-			}]].firstObject;
+			UILabel* label = (id)[UIView dtxrec_findViewsInHierarchy:view includingRoot:YES passingMatcher:[DTXViewMatcher matcherForKindOfClass:UILabel.class]].firstObject;
 			value = label.text;
 		}
 	}
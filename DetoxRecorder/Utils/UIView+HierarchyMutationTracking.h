@@ -0,0 +1,22 @@
+//
+//  UIView+HierarchyMutationTracking.h
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface UIView (HierarchyMutationTracking)
+
+/// Changes whenever views are added or removed, or matchable identifiers, labels or text change.
+@property (class, nonatomic, readonly) NSUInteger dtxrec_hierarchyGeneration;
+
++ (void)dtxrec_invalidateHierarchyGeneration;
+
+@end
+
+NS_ASSUME_NONNULL_END
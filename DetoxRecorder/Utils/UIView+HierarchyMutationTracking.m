@@ -0,0 +1,193 @@
+//
+//  UIView+HierarchyMutationTracking.m
+//  DetoxRecorder
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "UIView+HierarchyMutationTracking.h"
+#import "DTXCaptureHooks.h"
+#import "DTXCaptureControlWindow.h"
+@import ObjectiveC;
+
+static NSUInteger _hierarchyGeneration;
+static NSMutableArray<id<NSObject>>* _observers;
+
+//Views outside of windows are never searched, and the recorder's own window, with its visualizers, is never matched against.
+DTX_ALWAYS_INLINE
+static void _DTXBumpGenerationForView(UIView* view)
+{
+	UIWindow* window = view.window;
+	if(window == nil || [window isKindOfClass:DTXCaptureControlWindow.class])
+	{
+		return;
+	}
+	
+	_hierarchyGeneration++;
+}
+
+#define BUMP_GENERATION _DTXBumpGenerationForView(self);
+
+@interface UIView (HierarchyMutationTrackingSwizzles) @end
+@implementation UIView (HierarchyMutationTrackingSwizzles)
+
+- (void)_dtxrec_addSubview:(UIView*)view
+{
+	BUMP_GENERATION
+	[self _dtxrec_addSubview:view];
+}
+
+- (void)_dtxrec_insertSubview:(UIView*)view atIndex:(NSInteger)index
+{
+	BUMP_GENERATION
+	[self _dtxrec_insertSubview:view atIndex:index];
+}
+
+- (void)_dtxrec_insertSubview:(UIView*)view aboveSubview:(UIView*)siblingSubview
+{
+	BUMP_GENERATION
+	[self _dtxrec_insertSubview:view aboveSubview:siblingSubview];
+}
+
+- (void)_dtxrec_insertSubview:(UIView*)view belowSubview:(UIView*)siblingSubview
+{
+	BUMP_GENERATION
+	[self _dtxrec_insertSubview:view belowSubview:siblingSubview];
+}
+
+- (void)_dtxrec_exchangeSubviewAtIndex:(NSInteger)index1 withSubviewAtIndex:(NSInteger)index2
+{
+	BUMP_GENERATION
+	[self _dtxrec_exchangeSubviewAtIndex:index1 withSubviewAtIndex:index2];
+}
+
+- (void)_dtxrec_removeFromSuperview
+{
+	BUMP_GENERATION
+	[self _dtxrec_removeFromSuperview];
+}
+
+- (void)_dtxrec_setAccessibilityIdentifier:(NSString*)accessibilityIdentifier
+{
+	BUMP_GENERATION
+	[self _dtxrec_setAccessibilityIdentifier:accessibilityIdentifier];
+}
+
+- (void)_dtxrec_setAccessibilityLabel:(NSString*)accessibilityLabel
+{
+	BUMP_GENERATION
+	[self _dtxrec_setAccessibilityLabel:accessibilityLabel];
+}
+
+- (void)_dtxrec_setText:(NSString*)text
+{
+	BUMP_GENERATION
+	[self _dtxrec_setText:text];
+}
+
+- (void)_dtxrec_setAttributedText:(NSAttributedString*)attributedText
+{
+	BUMP_GENERATION
+	[self _dtxrec_setAttributedText:attributedText];
+}
+
+- (void)_dtxrec_setTextStorage:(NSTextStorage*)textStorage contentFrame:(CGRect)contentFrame descendantViews:(NSArray<UIView*>*)descendantViews
+{
+	BUMP_GENERATION
+	[self _dtxrec_setTextStorage:textStorage contentFrame:contentFrame descendantViews:descendantViews];
+}
+
+@end
+
+@interface UIButton (HierarchyMutationTrackingSwizzles) @end
+@implementation UIButton (HierarchyMutationTrackingSwizzles)
+
+- (void)_dtxrec_setTitle:(NSString*)title forState:(UIControlState)state
+{
+	BUMP_GENERATION
+	[self _dtxrec_setTitle:title forState:state];
+}
+
+- (void)_dtxrec_setAttributedTitle:(NSAttributedString*)title forState:(UIControlState)state
+{
+	BUMP_GENERATION
+	[self _dtxrec_setAttributedTitle:title forState:state];
+}
+
+@end
+
+@implementation UIView (HierarchyMutationTracking)
+
++ (NSUInteger)dtxrec_hierarchyGeneration
+{
+	return _hierarchyGeneration;
+}
+
++ (void)dtxrec_invalidateHierarchyGeneration
+{
+	_hierarchyGeneration++;
+}
+
++ (void)_dtxrec_swizzleMutationMethods
+{
+	DTXSwizzleMethod(UIView.class, @selector(addSubview:), @selector(_dtxrec_addSubview:), NULL);
+	DTXSwizzleMethod(UIView.class, @selector(insertSubview:atIndex:), @selector(_dtxrec_insertSubview:atIndex:), NULL);
+	DTXSwizzleMethod(UIView.class, @selector(insertSubview:aboveSubview:), @selector(_dtxrec_insertSubview:aboveSubview:), NULL);
+	DTXSwizzleMethod(UIView.class, @selector(insertSubview:belowSubview:), @selector(_dtxrec_insertSubview:belowSubview:), NULL);
+	DTXSwizzleMethod(UIView.class, @selector(exchangeSubviewAtIndex:withSubviewAtIndex:), @selector(_dtxrec_exchangeSubviewAtIndex:withSubviewAtIndex:), NULL);
+	DTXSwizzleMethod(UIView.class, @selector(removeFromSuperview), @selector(_dtxrec_removeFromSuperview), NULL);
+	DTXSwizzleMethod(UIView.class, @selector(setAccessibilityIdentifier:), @selector(_dtxrec_setAccessibilityIdentifier:), NULL);
+	DTXSwizzleMethod(UIView.class, @selector(setAccessibilityLabel:), @selector(_dtxrec_setAccessibilityLabel:), NULL);
+	
+	for(Class cls in @[UILabel.class, UITextField.class, UITextView.class])
+	{
+		DTXSwizzleMethod(cls, @selector(setText:), @selector(_dtxrec_setText:), NULL);
+		DTXSwizzleMethod(cls, @selector(setAttributedText:), @selector(_dtxrec_setAttributedText:), NULL);
+	}
+	
+	//Button titles are matched by text and label, yet are shown by a label the button may only update later.
+	DTXSwizzleMethod(UIButton.class, @selector(setTitle:forState:), @selector(_dtxrec_setTitle:forState:), NULL);
+	DTXSwizzleMethod(UIButton.class, @selector(setAttributedTitle:forState:), @selector(_dtxrec_setAttributedTitle:forState:), NULL);
+	
+	Class rnTextViewClass = NSClassFromString(@"RCTTextView");
+	SEL rnSetTextStorage = NSSelectorFromString(@"setTextStorage:contentFrame:descendantViews:");
+	if(rnTextViewClass != nil && [rnTextViewClass instancesRespondToSelector:rnSetTextStorage])
+	{
+		DTXSwizzleMethod(rnTextViewClass, rnSetTextStorage, @selector(_dtxrec_setTextStorage:contentFrame:descendantViews:), NULL);
+	}
+}
+
++ (void)load
+{
+	@autoreleasepool {
+		DTXCaptureHooksRegister(^{
+			[self _dtxrec_swizzleMutationMethods];
+			
+			//Typing changes text without going through the setters above; window visibility changes the searched windows.
+			_observers = [NSMutableArray new];
+			for(NSNotificationName name in @[UITextFieldTextDidChangeNotification, UITextViewTextDidChangeNotification, UIWindowDidBecomeVisibleNotification, UIWindowDidBecomeHiddenNotification])
+			{
+				[_observers addObject:[NSNotificationCenter.defaultCenter addObserverForName:name object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+					_DTXBumpGenerationForView(note.object);
+				}]];
+			}
+			
+			//Nothing was tracked while not recording.
+			_hierarchyGeneration++;
+		}, ^{
+			//Swizzling again restores the original implementations.
+			[self _dtxrec_swizzleMutationMethods];
+			
+			for(id<NSObject> observer in _observers)
+			{
+				[NSNotificationCenter.defaultCenter removeObserver:observer];
+			}
+			_observers = nil;
+			
+			_hierarchyGeneration++;
+		});
+	}
+}
+
+@end
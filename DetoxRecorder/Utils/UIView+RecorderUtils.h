@@ -9,6 +9,8 @@
 #import <UIKit/UIKit.h>
 #import "UIWindow+RecorderUtils.h"
 
+@class DTXViewMatcher;
+
 @interface UIView (RecorderUtils)
 
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInAllWindowsPassingPredicate:(NSPredicate*)predicate;
@@ -18,6 +20,13 @@
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInHierarchy:(UIView*)hierarchy passingPredicate:(NSPredicate*)predicate;
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInHierarchy:(UIView*)hierarchy includingRoot:(BOOL)includingRoot passingPredicate:(NSPredicate*)predicate;
 
++ (NSMutableArray<UIView*>*)dtxrec_findViewsInAllWindowsPassingMatcher:(DTXViewMatcher*)matcher;
++ (NSMutableArray<UIView*>*)dtxrec_findViewsInWindows:(NSArray<UIWindow*>*)windows passingMatcher:(DTXViewMatcher*)matcher;
++ (NSMutableArray<UIView*>*)dtxrec_findViewsInHierarchy:(UIView*)hierarchy includingRoot:(BOOL)includingRoot passingMatcher:(DTXViewMatcher*)matcher;
+
++ (void)dtxrec_sortViewsByCoords:(NSMutableArray<UIView*>*)views;
++ (NSUInteger)dtxrec_coordinateIndexOfView:(UIView*)view inViews:(NSArray<UIView*>*)views;
+
 - (id)text;
 - (id)placeholder;
 
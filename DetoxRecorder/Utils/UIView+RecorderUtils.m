@@ -7,50 +7,73 @@
 //
 
 #import "UIView+RecorderUtils.h"
+#import "DTXViewMatcher.h"
+#import "DTXRecorderInstrumentation.h"
 
 DTX_DIRECT_MEMBERS
 @implementation UIView (RecorderUtils)
 
-+ (void)_dtxrec_appendViewsRecursivelyFromArray:(NSArray<UIView*>*)views passingPredicate:(NSPredicate*)predicate storage:(NSMutableArray<UIView*>*)storage
++ (void)_dtxrec_appendViewsRecursivelyFromArray:(NSArray<UIView*>*)views passingMatcher:(DTXViewMatcher*)matcher predicate:(NSPredicate*)predicate storage:(NSMutableArray<UIView*>*)storage
 {
-	if(views.count == 0)
-	{
-		return;
-	}
+	DTXRecorderCounterAdd(DTXRecorderCounterViewsVisited, views.count);
 	
-	[views enumerateObjectsUsingBlock:^(UIView * _Nonnull obj, NSUInteger idx, BOOL * _Nonnull stop) {
-		if(predicate == nil || [predicate evaluateWithObject:obj] == YES)
+	for(UIView* view in views)
+	{
+		if((matcher == nil || [matcher matchesView:view] == YES) && (predicate == nil || [predicate evaluateWithObject:view] == YES))
 		{
-			[storage addObject:obj];
+			[storage addObject:view];
 		}
 		
-		[self _dtxrec_appendViewsRecursivelyFromArray:obj.subviews passingPredicate:predicate storage:storage];
-	}];
+		NSArray<UIView*>* subviews = view.subviews;
+		if(subviews.count > 0)
+		{
+			[self _dtxrec_appendViewsRecursivelyFromArray:subviews passingMatcher:matcher predicate:predicate storage:storage];
+		}
+	}
 }
 
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInWindows:(NSArray<UIWindow*>*)windows passingPredicate:(NSPredicate*)predicate
 {
+	DTX_SIGNPOST_INTERVAL("Hierarchy Search");
+	
+	NSMutableArray<UIView*>* rv = [NSMutableArray new];
+	
+	[self _dtxrec_appendViewsRecursivelyFromArray:windows passingMatcher:nil predicate:predicate storage:rv];
+	[self dtxrec_sortViewsByCoords:rv];
+	
+	return rv;
+}
+
++ (NSMutableArray<UIView*>*)dtxrec_findViewsInWindows:(NSArray<UIWindow*>*)windows passingMatcher:(DTXViewMatcher*)matcher
+{
+	DTX_SIGNPOST_INTERVAL("Hierarchy Search");
+	
 	NSMutableArray<UIView*>* rv = [NSMutableArray new];
 	
-	[self _dtxrec_appendViewsRecursivelyFromArray:windows passingPredicate:predicate storage:rv];
-	[self _dtxrec_sortViewsByCoords:rv];
+	[self _dtxrec_appendViewsRecursivelyFromArray:windows passingMatcher:matcher predicate:nil storage:rv];
+	[self dtxrec_sortViewsByCoords:rv];
 	
 	return rv;
 }
 
++ (NSMutableArray<UIView*>*)dtxrec_findViewsInAllWindowsPassingMatcher:(DTXViewMatcher*)matcher
+{
+	return [self dtxrec_findViewsInWindows:UIWindow.dtxrec_allWindowsFrontToBack passingMatcher:matcher];
+}
+
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInAllWindowsPassingPredicate:(NSPredicate*)predicate
 {
-	return [self dtxrec_findViewsInWindows:UIWindow.dtxrec_allWindows.reverseObjectEnumerator.allObjects passingPredicate:predicate];
+	return [self dtxrec_findViewsInWindows:UIWindow.dtxrec_allWindowsFrontToBack passingPredicate:predicate];
 }
 
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInKeySceneWindowsPassingPredicate:(NSPredicate*)predicate
 {
-	return [self dtxrec_findViewsInWindows:UIWindow.dtxrec_allKeyWindowSceneWindows.reverseObjectEnumerator.allObjects passingPredicate:predicate];
+	return [self dtxrec_findViewsInWindows:[UIWindow dtxrec_allWindowsFrontToBackForScene:nil] passingPredicate:predicate];
 }
 
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInWindowScene:(id /*UIWindowScene**/)scene passingPredicate:(NSPredicate*)predicate
 {
-	return [self dtxrec_findViewsInWindows:[UIWindow dtxrec_allWindowsForScene:scene].reverseObjectEnumerator.allObjects passingPredicate:predicate];
+	return [self dtxrec_findViewsInWindows:[UIWindow dtxrec_allWindowsFrontToBackForScene:scene] passingPredicate:predicate];
 }
 
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInHierarchy:(UIView*)hierarchy passingPredicate:(NSPredicate*)predicate
@@ -60,27 +83,119 @@ DTX_DIRECT_MEMBERS
 
 + (NSMutableArray<UIView*>*)dtxrec_findViewsInHierarchy:(UIView*)hierarchy includingRoot:(BOOL)includingRoot passingPredicate:(NSPredicate*)predicate
 {
+	DTX_SIGNPOST_INTERVAL("Hierarchy Search");
+	
 	NSMutableArray<UIView*>* rv = [NSMutableArray new];
 	
-	[self _dtxrec_appendViewsRecursivelyFromArray:includingRoot ? @[hierarchy] : hierarchy.subviews passingPredicate:predicate storage:rv];
-	[self _dtxrec_sortViewsByCoords:rv];
+	[self _dtxrec_appendViewsRecursivelyFromArray:includingRoot ? @[hierarchy] : hierarchy.subviews passingMatcher:nil predicate:predicate storage:rv];
+	[self dtxrec_sortViewsByCoords:rv];
 	
 	return rv;
 }
 
-+ (void)_dtxrec_sortViewsByCoords:(NSMutableArray<UIView*>*)views
++ (NSMutableArray<UIView*>*)dtxrec_findViewsInHierarchy:(UIView*)hierarchy includingRoot:(BOOL)includingRoot passingMatcher:(DTXViewMatcher*)matcher
 {
-	[views sortUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:nil ascending:YES comparator:^NSComparisonResult(UIView* _Nonnull obj1, UIView* _Nonnull obj2) {
-		CGRect frame1 = obj1.dtxrec_accessibilityFrame;
-		CGRect frame2 = obj2.dtxrec_accessibilityFrame;
-		
-		return frame1.origin.y < frame2.origin.y ? NSOrderedAscending : frame1.origin.y > frame2.origin.y ? NSOrderedDescending : NSOrderedSame;
-	}], [NSSortDescriptor sortDescriptorWithKey:nil ascending:YES comparator:^NSComparisonResult(UIView* _Nonnull obj1, UIView* _Nonnull obj2) {
-		CGRect frame1 = obj1.dtxrec_accessibilityFrame;
-		CGRect frame2 = obj2.dtxrec_accessibilityFrame;
+	DTX_SIGNPOST_INTERVAL("Hierarchy Search");
+	
+	NSMutableArray<UIView*>* rv = [NSMutableArray new];
+	
+	[self _dtxrec_appendViewsRecursivelyFromArray:includingRoot ? @[hierarchy] : hierarchy.subviews passingMatcher:matcher predicate:nil storage:rv];
+	[self dtxrec_sortViewsByCoords:rv];
+	
+	return rv;
+}
+
+typedef struct
+{
+	CGFloat y;
+	CGFloat x;
+	NSUInteger index;
+} _DTXViewSortKey;
+
+DTX_ALWAYS_INLINE
+static _DTXViewSortKey _DTXSortKeyForView(UIView* view, NSUInteger index)
+{
+	CGRect frame = view.dtxrec_accessibilityFrame;
+	return (_DTXViewSortKey){ frame.origin.y, frame.origin.x, index };
+}
+
+DTX_ALWAYS_INLINE
+static int _DTXCompareSortKeys(const _DTXViewSortKey* key1, const _DTXViewSortKey* key2)
+{
+	if(key1->y != key2->y)
+	{
+		return key1->y < key2->y ? -1 : 1;
+	}
+	
+	if(key1->x != key2->x)
+	{
+		return key1->x < key2->x ? -1 : 1;
+	}
+	
+	//Keep hierarchy order for equal coordinates
+	return key1->index < key2->index ? -1 : key1->index > key2->index ? 1 : 0;
+}
+
+static int _DTXQSortCompareSortKeys(const void* key1, const void* key2)
+{
+	return _DTXCompareSortKeys(key1, key2);
+}
+
++ (void)dtxrec_sortViewsByCoords:(NSMutableArray<UIView*>*)views
+{
+	NSUInteger count = views.count;
+	if(count < 2)
+	{
+		return;
+	}
+	
+	//Each frame is computed exactly once, rather than on every comparison.
+	_DTXViewSortKey* keys = malloc(sizeof(_DTXViewSortKey) * count);
+	dtx_defer {
+		free(keys);
+	};
+	
+	NSUInteger idx = 0;
+	for(UIView* view in views)
+	{
+		keys[idx] = _DTXSortKeyForView(view, idx);
+		idx++;
+	}
+	
+	qsort(keys, count, sizeof(_DTXViewSortKey), _DTXQSortCompareSortKeys);
+	
+	NSArray<UIView*>* unsorted = [views copy];
+	for(idx = 0; idx < count; idx++)
+	{
+		views[idx] = unsorted[keys[idx].index];
+	}
+}
+
++ (NSUInteger)dtxrec_coordinateIndexOfView:(UIView*)view inViews:(NSArray<UIView*>*)views
+{
+	//The index the view would have after dtxrec_sortViewsByCoords:, in a single pass, without sorting.
+	//Views at equal coordinates keep hierarchy order, so they rank before the view only until it is reached.
+	_DTXViewSortKey viewKey = _DTXSortKeyForView(view, 0);
+	
+	BOOL found = NO;
+	NSUInteger rv = 0;
+	for(UIView* other in views)
+	{
+		if(other == view)
+		{
+			found = YES;
+			continue;
+		}
 		
-		return frame1.origin.x < frame2.origin.x ? NSOrderedAscending : frame1.origin.x > frame2.origin.x ? NSOrderedDescending : NSOrderedSame;
-	}]]];
+		_DTXViewSortKey otherKey = _DTXSortKeyForView(other, 0);
+		int result = _DTXCompareSortKeys(&otherKey, &viewKey);
+		if(result < 0 || (result == 0 && found == NO))
+		{
+			rv++;
+		}
+	}
+	
+	return found ? rv : NSNotFound;
 }
 
 - (CGRect)dtxrec_accessibilityFrame
@@ -95,7 +210,12 @@ DTX_DIRECT_MEMBERS
 
 - (id)text
 {
-	Class cls = NSClassFromString(@"RCTTextView");
+	static Class cls;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		cls = NSClassFromString(@"RCTTextView");
+	});
+	
 	if(cls != nil && [self isKindOfClass:cls])
 	{
 		return [(NSTextStorage*)[self valueForKey:@"textStorage"] string];
@@ -15,8 +15,12 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, strong, class, readonly, nullable) UIWindow* dtxrec_keyWindow NS_SWIFT_NAME(dtxrec_keyWindow);
 @property (nonatomic, strong, class, readonly) NSArray<UIWindow*>* dtxrec_allKeyWindowSceneWindows;
 
+/// Visible windows, back to front. Lists are cached until windows or scenes change, or the main run loop goes idle; main thread only.
 + (NSArray<UIWindow*>*)dtxrec_allWindows;
 + (NSArray<UIWindow*>*)dtxrec_allWindowsForScene:(nullable id /* UIWindowScene* */)scene;
+/// Visible windows, front to back.
++ (NSArray<UIWindow*>*)dtxrec_allWindowsFrontToBack;
++ (NSArray<UIWindow*>*)dtxrec_allWindowsFrontToBackForScene:(nullable id /* UIWindowScene* */)scene;
 + (void)dtxrec_enumerateAllWindowsUsingBlock:(void (NS_NOESCAPE ^)(UIWindow* obj, NSUInteger idx, BOOL *stop))block;
 + (void)dtxrec_enumerateKeyWindowSceneWindowsUsingBlock:(void (NS_NOESCAPE ^)(UIWindow* obj, NSUInteger idx, BOOL *stop))block;
 + (void)dtxrec_enumerateWindowsInScene:(nullable id /* UIWindowScene* */)scene usingBlock:(void (NS_NOESCAPE ^)(UIWindow* obj, NSUInteger idx, BOOL *stop))block;
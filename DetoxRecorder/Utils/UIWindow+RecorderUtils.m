@@ -24,6 +24,104 @@
 
 @end
 
+//Window lists are queried several times per recorded action; they are built once and reused until something changes.
+//Clearing them whenever the main run loop goes idle also keeps released windows from being retained here.
+static NSArray<UIWindow*>* _allWindows;
+static NSArray<UIWindow*>* _allWindowsFrontToBack;
+static NSMapTable<id, NSArray<UIWindow*>*>* _sceneWindows;
+static NSMapTable<id, NSArray<UIWindow*>*>* _sceneWindowsFrontToBack;
+
+static void _DTXInvalidateWindowCaches(void)
+{
+	_allWindows = nil;
+	_allWindowsFrontToBack = nil;
+	[_sceneWindows removeAllObjects];
+	[_sceneWindowsFrontToBack removeAllObjects];
+}
+
+static void _DTXInstallWindowCacheInvalidationIfNeeded(void)
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		_sceneWindows = [NSMapTable strongToStrongObjectsMapTable];
+		_sceneWindowsFrontToBack = [NSMapTable strongToStrongObjectsMapTable];
+		
+		NSMutableArray<NSNotificationName>* names = [@[UIWindowDidBecomeVisibleNotification, UIWindowDidBecomeHiddenNotification, UIWindowDidBecomeKeyNotification, UIWindowDidResignKeyNotification] mutableCopy];
+		if(@available(iOS 13.0, *))
+		{
+			[names addObjectsFromArray:@[UISceneWillConnectNotification, UISceneDidDisconnectNotification, UISceneDidActivateNotification, UISceneWillDeactivateNotification]];
+		}
+		
+		for(NSNotificationName name in names)
+		{
+			[NSNotificationCenter.defaultCenter addObserverForName:name object:nil queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+				_DTXInvalidateWindowCaches();
+			}];
+		}
+		
+		CFRunLoopObserverRef observer = CFRunLoopObserverCreateWithHandler(kCFAllocatorDefault, kCFRunLoopBeforeWaiting, true, 0, ^(CFRunLoopObserverRef observer, CFRunLoopActivity activity) {
+			_DTXInvalidateWindowCaches();
+		});
+		CFRunLoopAddObserver(CFRunLoopGetMain(), observer, kCFRunLoopCommonModes);
+		CFRelease(observer);
+	});
+}
+
+DTX_ALWAYS_INLINE
+static void _DTXBuildWindowCachesIfNeeded(void)
+{
+	if(_allWindows != nil)
+	{
+		return;
+	}
+	
+	_DTXInstallWindowCacheInvalidationIfNeeded();
+	
+	NSArray<UIWindow*>* windows = [UIWindow allWindowsIncludingInternalWindows:YES onlyVisibleWindows:NO];
+	NSMutableArray<UIWindow*>* visible = [NSMutableArray arrayWithCapacity:windows.count];
+	for(UIWindow* window in windows)
+	{
+		if(window.hidden == NO)
+		{
+			[visible addObject:window];
+		}
+	}
+	
+	_allWindows = [visible copy];
+	_allWindowsFrontToBack = visible.reverseObjectEnumerator.allObjects;
+}
+
+static NSArray<UIWindow*>* _DTXCachedWindowsForScene(id scene, BOOL frontToBack) API_AVAILABLE(ios(13.0))
+{
+	_DTXBuildWindowCachesIfNeeded();
+	
+	if(scene == nil)
+	{
+		return @[];
+	}
+	
+	NSMapTable<id, NSArray<UIWindow*>*>* cache = frontToBack ? _sceneWindowsFrontToBack : _sceneWindows;
+	NSArray<UIWindow*>* rv = [cache objectForKey:scene];
+	if(rv != nil)
+	{
+		return rv;
+	}
+	
+	NSMutableArray<UIWindow*>* windows = [NSMutableArray new];
+	for(UIWindow* window in frontToBack ? _allWindowsFrontToBack : _allWindows)
+	{
+		if(window.windowScene == scene)
+		{
+			[windows addObject:window];
+		}
+	}
+	
+	rv = [windows copy];
+	[cache setObject:rv forKey:scene];
+	
+	return rv;
+}
+
 DTX_DIRECT_MEMBERS
 @implementation UIWindow (RecorderUtils)
 
@@ -53,20 +151,36 @@ DTX_DIRECT_MEMBERS
 
 + (NSArray<UIWindow*>*)dtxrec_allWindowsForScene:(id)scene
 {
-	NSMutableArray<UIWindow*>* windows = [[self dtxrec_allWindows] mutableCopy];
+	if (@available(iOS 13.0, *))
+	{
+		return _DTXCachedWindowsForScene(scene ?: UIWindowScene._keyWindowScene, NO);
+	}
 	
+	return [self dtxrec_allWindows];
+}
+
++ (NSArray<UIWindow*>*)dtxrec_allWindowsFrontToBackForScene:(id)scene
+{
 	if (@available(iOS 13.0, *))
 	{
-		scene = scene ?: UIWindowScene._keyWindowScene;
-		[windows filterUsingPredicate:[NSPredicate predicateWithFormat:@"windowScene == %@", scene]];
+		return _DTXCachedWindowsForScene(scene ?: UIWindowScene._keyWindowScene, YES);
 	}
 	
-	return windows;
+	return [self dtxrec_allWindowsFrontToBack];
 }
 
 + (NSArray<UIWindow*>*)dtxrec_allWindows
 {
-	return [[UIWindow allWindowsIncludingInternalWindows:YES onlyVisibleWindows:NO] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"hidden == NO"]];
+	_DTXBuildWindowCachesIfNeeded();
+	
+	return _allWindows;
+}
+
++ (NSArray<UIWindow*>*)dtxrec_allWindowsFrontToBack
+{
+	_DTXBuildWindowCachesIfNeeded();
+	
+	return _allWindowsFrontToBack;
 }
 
 + (void)_dtxrec_enumerateWindows:(NSArray<UIWindow*>*)windows usingBlock:(void (NS_NOESCAPE ^)(UIWindow* obj, NSUInteger idx, BOOL *stop))block
@@ -8,6 +8,7 @@
 
 #import "AppDelegate.h"
 #import <DetoxRecorder/DTXUIInteractionRecorder.h>
+#import "RecorderBenchmark.h"
 
 @interface AppDelegate () <DTXUIInteractionRecorderDelegate>
 
@@ -53,6 +54,13 @@
 //		}
 	}];
 	
+	if(RecorderBenchmark.isRequested)
+	{
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[RecorderBenchmark run];
+		});
+	}
+	
 	return YES;
 }
 
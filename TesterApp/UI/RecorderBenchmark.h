@@ -0,0 +1,23 @@
+//
+//  RecorderBenchmark.h
+//  UI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import <UIKit/UIKit.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Replays synthetic interactions through the recorder's entry points and reports their main thread cost.
+/// Enabled with the "DTXRecBenchmark" launch argument; see RecorderBenchmark.m for the other options.
+@interface RecorderBenchmark : NSObject
+
+@property (class, nonatomic, readonly) BOOL isRequested;
+
++ (void)run;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,333 @@
+//
+//  RecorderBenchmark.m
+//  UI
+//
+//  Created by Leo Natan (Wix) on 10/14/26.
+//  Copyright © 2019-2021 Wix. All rights reserved.
+//
+
+#import "RecorderBenchmark.h"
+#import <DetoxRecorder/DTXUIInteractionRecorder.h>
+#import <malloc/malloc.h>
+
+/*
+	Launch arguments:
+	-DTXRecBenchmark 1                     Run the benchmark instead of the normal app flow
+	-DTXRecBenchmarkViewCount <n>          Approximate number of views in the synthetic hierarchy (default 2000)
+	-DTXRecBenchmarkDepth <n>              Maximum nesting depth (default 12)
+	-DTXRecBenchmarkDuplicates <n>         Number of distinct identifiers, labels and texts; lower means more duplicates (default 10)
+	-DTXRecBenchmarkIterations <n>         Replays per interaction kind (default 200)
+	-DTXRecBenchmarkOutputPath <path>      Where the JSON report is written (default: temporary directory)
+*/
+
+typedef struct {
+	uint64_t nanoseconds;
+	int64_t blocks;
+	int64_t bytes;
+} _RecorderBenchmarkSample;
+
+@interface RecorderBenchmark () <UITableViewDataSource, UIPickerViewDataSource, UIPickerViewDelegate> @end
+
+@implementation RecorderBenchmark
+{
+	UIWindow* _window;
+	NSUInteger _duplicates;
+	NSUInteger _remainingViews;
+	NSUInteger _maxDepth;
+	
+	NSMutableArray<UIView*>* _tappableViews;
+	NSMutableArray<UIScrollView*>* _scrollViews;
+	UITextField* _textField;
+	UIPickerView* _pickerView;
+}
+
++ (BOOL)isRequested
+{
+	return [NSUserDefaults.standardUserDefaults boolForKey:@"DTXRecBenchmark"];
+}
+
+static NSUInteger _RecorderBenchmarkSetting(NSString* key, NSUInteger defaultValue)
+{
+	NSInteger value = [NSUserDefaults.standardUserDefaults integerForKey:key];
+	return value > 0 ? value : defaultValue;
+}
+
++ (void)run
+{
+	static RecorderBenchmark* benchmark;
+	benchmark = [RecorderBenchmark new];
+	[benchmark _run];
+}
+
+#pragma mark Hierarchy
+
+- (void)_buildHierarchy
+{
+	_window = [[UIWindow alloc] initWithFrame:UIScreen.mainScreen.bounds];
+	_window.rootViewController = [UIViewController new];
+	_window.windowLevel = UIWindowLevelNormal + 1;
+	[_window makeKeyAndVisible];
+	
+	_tappableViews = [NSMutableArray new];
+	_scrollViews = [NSMutableArray new];
+	
+	UIView* root = _window.rootViewController.view;
+	root.backgroundColor = UIColor.systemBackgroundColor;
+	
+	_textField = [[UITextField alloc] initWithFrame:CGRectMake(20, 60, 200, 30)];
+	_textField.accessibilityIdentifier = @"BenchmarkTextField";
+	[root addSubview:_textField];
+	
+	_pickerView = [[UIPickerView alloc] initWithFrame:CGRectMake(0, 100, CGRectGetWidth(root.bounds), 160)];
+	_pickerView.dataSource = self;
+	_pickerView.delegate = self;
+	[root addSubview:_pickerView];
+	
+	UIScrollView* outerScrollView = [[UIScrollView alloc] initWithFrame:CGRectMake(0, 270, CGRectGetWidth(root.bounds), CGRectGetHeight(root.bounds) - 270)];
+	outerScrollView.contentSize = CGSizeMake(CGRectGetWidth(root.bounds) * 2, CGRectGetHeight(root.bounds) * 4);
+	[root addSubview:outerScrollView];
+	[_scrollViews addObject:outerScrollView];
+	
+	//A table nested inside a scroll view, as is common in real apps.
+	UITableView* tableView = [[UITableView alloc] initWithFrame:CGRectMake(0, 0, CGRectGetWidth(root.bounds), 400) style:UITableViewStylePlain];
+	tableView.dataSource = self;
+	[tableView registerClass:UITableViewCell.class forCellReuseIdentifier:@"Cell"];
+	[outerScrollView addSubview:tableView];
+	[tableView layoutIfNeeded];
+	[_scrollViews addObject:tableView];
+	
+	UIView* subtreeContainer = [[UIView alloc] initWithFrame:CGRectMake(0, 400, outerScrollView.contentSize.width, outerScrollView.contentSize.height - 400)];
+	[outerScrollView addSubview:subtreeContainer];
+	[self _addSubtreeToView:subtreeContainer depth:0];
+	
+	[_window layoutIfNeeded];
+}
+
+- (void)_addSubtreeToView:(UIView*)view depth:(NSUInteger)depth
+{
+	if(_remainingViews == 0 || depth >= _maxDepth)
+	{
+		return;
+	}
+	
+	CGRect bounds = view.bounds;
+	CGFloat childHeight = MAX(CGRectGetHeight(bounds) / 4, 8);
+	
+	for(NSUInteger idx = 0; idx < 4 && _remainingViews > 0; idx++)
+	{
+		NSUInteger variant = (NSUInteger)(drand48() * _duplicates);
+		CGRect frame = CGRectMake(4, idx * childHeight, MAX(CGRectGetWidth(bounds) - 8, 8), childHeight);
+		
+		UIView* child;
+		switch(idx)
+		{
+			case 0:
+			{
+				UILabel* label = [[UILabel alloc] initWithFrame:frame];
+				label.text = [NSString stringWithFormat:@"Text %@", @(variant)];
+				child = label;
+			}	break;
+			case 1:
+			{
+				UIButton* button = [UIButton buttonWithType:UIButtonTypeSystem];
+				button.frame = frame;
+				[button setTitle:[NSString stringWithFormat:@"Button %@", @(variant)] forState:UIControlStateNormal];
+				button.accessibilityIdentifier = [NSString stringWithFormat:@"Identifier%@", @(variant)];
+				child = button;
+				[_tappableViews addObject:button];
+			}	break;
+			case 2:
+			{
+				//Every few levels, nest a scroll view
+				if(depth % 4 == 3)
+				{
+					UIScrollView* scrollView = [[UIScrollView alloc] initWithFrame:frame];
+					scrollView.contentSize = CGSizeMake(CGRectGetWidth(frame) * 2, CGRectGetHeight(frame) * 2);
+					child = scrollView;
+					[_scrollViews addObject:scrollView];
+				}
+				else
+				{
+					child = [[UIView alloc] initWithFrame:frame];
+					child.accessibilityLabel = [NSString stringWithFormat:@"Label %@", @(variant)];
+					child.isAccessibilityElement = YES;
+					[_tappableViews addObject:child];
+				}
+			}	break;
+			default:
+				child = [[UIView alloc] initWithFrame:frame];
+				break;
+		}
+		
+		[view addSubview:child];
+		_remainingViews -= 1;
+		
+		[self _addSubtreeToView:child depth:depth + 1];
+	}
+}
+
+#pragma mark UITableViewDataSource
+
+- (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section
+{
+	return 200;
+}
+
+- (UITableViewCell *)tableView:(UITableView *)tableView cellForRowAtIndexPath:(NSIndexPath *)indexPath
+{
+	UITableViewCell* cell = [tableView dequeueReusableCellWithIdentifier:@"Cell" forIndexPath:indexPath];
+	cell.textLabel.text = [NSString stringWithFormat:@"Row %@", @(indexPath.row % _duplicates)];
+	return cell;
+}
+
+#pragma mark UIPickerViewDataSource
+
+- (NSInteger)numberOfComponentsInPickerView:(UIPickerView *)pickerView
+{
+	return 2;
+}
+
+- (NSInteger)pickerView:(UIPickerView *)pickerView numberOfRowsInComponent:(NSInteger)component
+{
+	return 50;
+}
+
+- (NSString *)pickerView:(UIPickerView *)pickerView titleForRow:(NSInteger)row forComponent:(NSInteger)component
+{
+	return [NSString stringWithFormat:@"Value %@", @(row)];
+}
+
+#pragma mark Measurement
+
+static _RecorderBenchmarkSample _RecorderBenchmarkMeasure(dispatch_block_t block)
+{
+	malloc_statistics_t before, after;
+	malloc_zone_statistics(NULL, &before);
+	uint64_t start = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+	
+	block();
+	
+	uint64_t end = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+	malloc_zone_statistics(NULL, &after);
+	
+	return (_RecorderBenchmarkSample){ end - start, (int64_t)after.blocks_in_use - (int64_t)before.blocks_in_use, (int64_t)after.size_in_use - (int64_t)before.size_in_use };
+}
+
+static int _RecorderBenchmarkCompareNanoseconds(const void* a, const void* b)
+{
+	uint64_t lhs = ((const _RecorderBenchmarkSample*)a)->nanoseconds;
+	uint64_t rhs = ((const _RecorderBenchmarkSample*)b)->nanoseconds;
+	return lhs < rhs ? -1 : lhs > rhs ? 1 : 0;
+}
+
+static NSDictionary* _RecorderBenchmarkReport(_RecorderBenchmarkSample* samples, NSUInteger count)
+{
+	qsort(samples, count, sizeof(_RecorderBenchmarkSample), _RecorderBenchmarkCompareNanoseconds);
+	
+	double totalBlocks = 0;
+	double totalBytes = 0;
+	for(NSUInteger idx = 0; idx < count; idx++)
+	{
+		totalBlocks += samples[idx].blocks;
+		totalBytes += samples[idx].bytes;
+	}
+	
+	double (^percentile)(double) = ^ (double p) {
+		NSUInteger idx = MIN((NSUInteger)(p * count), count - 1);
+		return samples[idx].nanoseconds / 1000.0;
+	};
+	
+	return @{
+		@"count": @(count),
+		@"p50_us": @(percentile(0.5)),
+		@"p90_us": @(percentile(0.9)),
+		@"p99_us": @(percentile(0.99)),
+		@"max_us": @(samples[count - 1].nanoseconds / 1000.0),
+		@"mean_live_allocations": @(totalBlocks / count),
+		@"mean_live_bytes": @(totalBytes / count),
+	};
+}
+
+- (NSDictionary*)_replay:(NSString*)name iterations:(NSUInteger)iterations block:(void(^)(NSUInteger idx))block
+{
+	_RecorderBenchmarkSample* samples = malloc(sizeof(_RecorderBenchmarkSample) * iterations);
+	
+	for(NSUInteger idx = 0; idx < iterations; idx++)
+	{
+		samples[idx] = _RecorderBenchmarkMeasure(^{
+			block(idx);
+		});
+		
+		//Lets deferred recorder work, such as coalescing timers and visualizations, run outside of the measurement.
+		[NSRunLoop.currentRunLoop runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.001]];
+	}
+	
+	NSDictionary* rv = _RecorderBenchmarkReport(samples, iterations);
+	free(samples);
+	
+	NSLog(@"⏱ %@: %@", name, rv);
+	
+	return rv;
+}
+
+#pragma mark Run
+
+- (void)_run
+{
+	//Deterministic hierarchies and replays, so runs are comparable.
+	srand48(0);
+	
+	_duplicates = _RecorderBenchmarkSetting(@"DTXRecBenchmarkDuplicates", 10);
+	NSUInteger requestedViews = _RecorderBenchmarkSetting(@"DTXRecBenchmarkViewCount", 2000);
+	_remainingViews = requestedViews;
+	_maxDepth = _RecorderBenchmarkSetting(@"DTXRecBenchmarkDepth", 12);
+	NSUInteger iterations = _RecorderBenchmarkSetting(@"DTXRecBenchmarkIterations", 200);
+	
+	NSString* outputPath = [NSUserDefaults.standardUserDefaults stringForKey:@"DTXRecBenchmarkOutputPath"] ?: [NSTemporaryDirectory() stringByAppendingPathComponent:@"recorder_benchmark.json"];
+	[NSUserDefaults.standardUserDefaults registerDefaults:@{@"DTXRecTestOutputPath": [NSTemporaryDirectory() stringByAppendingPathComponent:@"recorder_benchmark_test.js"]}];
+	
+	[self _buildHierarchy];
+	
+	[DTXUIInteractionRecorder startRecording];
+	
+	NSMutableDictionary* results = [NSMutableDictionary new];
+	results[@"configuration"] = @{
+		@"views": @(requestedViews - _remainingViews),
+		@"depth": @(_maxDepth),
+		@"duplicates": @(_duplicates),
+		@"iterations": @(iterations),
+	};
+	
+	results[@"tap"] = [self _replay:@"tap" iterations:iterations block:^(NSUInteger idx) {
+		UIView* view = self->_tappableViews[(NSUInteger)(drand48() * self->_tappableViews.count)];
+		[DTXUIInteractionRecorder addTapWithView:view withEvent:nil];
+	}];
+	
+	results[@"scroll"] = [self _replay:@"scroll" iterations:iterations block:^(NSUInteger idx) {
+		UIScrollView* scrollView = self->_scrollViews[(NSUInteger)(drand48() * self->_scrollViews.count)];
+		CGPoint origin = scrollView.contentOffset;
+		CGFloat maxY = MAX(scrollView.contentSize.height - CGRectGetHeight(scrollView.bounds), 0);
+		CGPoint newOffset = CGPointMake(origin.x, drand48() * maxY);
+		scrollView.contentOffset = newOffset;
+		[DTXUIInteractionRecorder addScrollEvent:scrollView fromOriginOffset:origin toNewOffset:newOffset withEvent:nil];
+	}];
+	
+	results[@"text"] = [self _replay:@"text" iterations:iterations block:^(NSUInteger idx) {
+		self->_textField.text = [NSString stringWithFormat:@"Typed text %@", @(idx)];
+		[DTXUIInteractionRecorder addTextChangeEvent:self->_textField];
+	}];
+	
+	results[@"picker"] = [self _replay:@"picker" iterations:iterations block:^(NSUInteger idx) {
+		NSInteger component = idx % 2;
+		[self->_pickerView selectRow:(NSInteger)(drand48() * 50) inComponent:component animated:NO];
+		[DTXUIInteractionRecorder addPickerViewValueChangeEvent:self->_pickerView component:component withEvent:nil];
+	}];
+	
+	NSData* data = [NSJSONSerialization dataWithJSONObject:results options:NSJSONWritingPrettyPrinted | NSJSONWritingSortedKeys error:NULL];
+	[data writeToFile:outputPath atomically:YES];
+	NSLog(@"⏱ Benchmark results written to %@", outputPath);
+	
+	[DTXUIInteractionRecorder stopRecording];
+}
+
+@end